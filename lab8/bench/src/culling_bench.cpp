@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "instance_bvh.hpp"
+#include "instance_store.hpp"
+#include "simulation.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr std::size_t kInstanceCount { 100000 };
+
+// Камера, приближающая сцену в zoom раз: видна примерно 1 / zoom^2 часть.
+Frustum CreateFrustum(float zoom) {
+  const glm::mat4 kViewProjection {
+    glm::scale(glm::mat4(1.0f), glm::vec3(zoom, zoom, 1.0f))
+  };
+  return ExtractFrustumPlanes(glm::value_ptr(kViewProjection));
+}
+
+// Сцена с положениями экземпляров, растянутыми в spread раз: при spread 1
+// крупные фигуры перекрывают друг друга, и узлы иерархии почти не
+// отсекаются; при spread 10 сцена похожа на большой мир, виденный частично.
+InstanceStore CreateScene(float spread) {
+  InstanceStore store { CreateInstanceStore(kInstanceCount, 0) };
+  for (std::size_t i { 0 }; i < store.GetCount(); i++) {
+    store.x_offsets[i] *= spread;
+    store.y_offsets[i] *= spread;
+  }
+  return store;
+}
+
+void ComputeBounds(const InstanceStore& store, InstanceBounds& bounds) {
+  std::vector<float> transforms(store.GetCount() * kInstanceTransformSize);
+  BuildInstanceTransforms(store, transforms.data());
+  ComputeCylinderBounds(transforms.data(), store.GetCount(), kCylinderRadius,
+                        kCylinderHalfHeight, bounds);
+}
+
+void CullLinear(const Frustum& frustum, const InstanceBounds& bounds,
+                std::vector<std::uint32_t>& visible) {
+  visible.clear();
+  for (std::size_t i { 0 }; i < bounds.GetCount(); i++) {
+    const float kMin[3] { bounds.min_x[i], bounds.min_y[i], bounds.min_z[i] };
+    const float kMax[3] { bounds.max_x[i], bounds.max_y[i], bounds.max_z[i] };
+    if (IsBoxVisible(frustum, kMin, kMax)) {
+      visible.push_back(static_cast<std::uint32_t>(i));
+    }
+  }
+}
+
+// Совпадает ли результат иерархии с проверкой каждого экземпляра.
+bool IsCullingExact(const InstanceBvh& bvh, const Frustum& frustum,
+                    const InstanceBounds& bounds) {
+  std::vector<std::uint32_t> expected { };
+  std::vector<std::uint32_t> visible { };
+  CullLinear(frustum, bounds, expected);
+  bvh.Cull(frustum, bounds, visible);
+  std::sort(visible.begin(), visible.end());
+  return visible == expected;
+}
+
+// Проверка каждого экземпляра при приближении state.range(0) и растяжении
+// сцены state.range(1).
+void BM_CullLinear(benchmark::State& state) {
+  InstanceBounds bounds { };
+  ComputeBounds(CreateScene(static_cast<float>(state.range(1))), bounds);
+  const Frustum kFrustum { CreateFrustum(static_cast<float>(state.range(0))) };
+
+  std::vector<std::uint32_t> visible { };
+  for (auto _ : state) {
+    CullLinear(kFrustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+
+  state.counters["visible"] =
+      static_cast<double>(visible.size()) / kInstanceCount;
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_CullLinear)
+    ->ArgsProduct({ { 1, 4, 16 }, { 1, 10 } })
+    ->ArgNames({ "zoom", "spread" });
+
+// Отсечение иерархией; результат сверяется с BM_CullLinear.
+void BM_CullBvh(benchmark::State& state) {
+  InstanceBounds bounds { };
+  ComputeBounds(CreateScene(static_cast<float>(state.range(1))), bounds);
+  const Frustum kFrustum { CreateFrustum(static_cast<float>(state.range(0))) };
+
+  InstanceBvh bvh { };
+  bvh.Build(bounds);
+
+  std::vector<std::uint32_t> visible { };
+  for (auto _ : state) {
+    bvh.Cull(kFrustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+
+  if (!IsCullingExact(bvh, kFrustum, bounds)) {
+    state.SkipWithError("BVH culling differs from the linear test");
+    return;
+  }
+  state.counters["visible"] =
+      static_cast<double>(visible.size()) / kInstanceCount;
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_CullBvh)
+    ->ArgsProduct({ { 1, 4, 16 }, { 1, 10 } })
+    ->ArgNames({ "zoom", "spread" });
+
+void BM_BvhBuild(benchmark::State& state) {
+  InstanceBounds bounds { };
+  ComputeBounds(CreateInstanceStore(kInstanceCount, 0), bounds);
+
+  InstanceBvh bvh { };
+  for (auto _ : state) {
+    bvh.Build(bounds);
+  }
+
+  state.counters["nodes"] = static_cast<double>(bvh.GetNodeCount());
+  state.counters["cost"] = bvh.GetCost();
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_BvhBuild)->Unit(benchmark::kMillisecond);
+
+// Пересчёт границ после state.range(0) шагов моделирования без
+// перестроения. Счётчик cost_growth показывает, во сколько раз выросла
+// стоимость обхода; отсечение после пересчёта сверяется с перебором.
+void BM_BvhRefit(benchmark::State& state) {
+  InstanceStore store { CreateInstanceStore(kInstanceCount, 0) };
+  InstanceBounds bounds { };
+  ComputeBounds(store, bounds);
+
+  InstanceBvh bvh { };
+  bvh.Build(bounds);
+  const float kBuildCost { bvh.GetCost() };
+
+  for (int tick { 0 }; tick < state.range(0); tick++) {
+    StepSimulation(store, kAlphaChanging, kBetaChanging);
+  }
+  ComputeBounds(store, bounds);
+
+  for (auto _ : state) {
+    bvh.Refit(bounds);
+  }
+
+  if (!IsCullingExact(bvh, CreateFrustum(4.0f), bounds)) {
+    state.SkipWithError("Refitted BVH culling differs from the linear test");
+    return;
+  }
+  state.counters["cost_growth"] = bvh.GetCost() / kBuildCost;
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_BvhRefit)
+    ->Arg(1)
+    ->Arg(60)
+    ->Arg(600)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,196 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "gl_state.hpp"
+#include "uniform_ring.hpp"
+
+namespace {
+
+// Подставная реализация OpenGL: считает вызовы и ничего не делает.
+// Отображение буфера выдаёт обычную память.
+struct MockGl {
+  std::size_t call_count;
+  std::size_t map_count;
+  std::vector<unsigned char> memory;
+};
+
+MockGl mock_gl { };
+
+void APIENTRY MockUseProgram(GLuint) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockBindVertexArray(GLuint) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockActiveTexture(GLenum) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockBindTexture(GLenum, GLuint) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockBindBuffer(GLenum, GLuint) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockBindBufferRange(GLenum, GLuint, GLuint, GLintptr,
+                                  GLsizeiptr) {
+  mock_gl.call_count++;
+}
+
+void APIENTRY MockGenBuffers(GLsizei count, GLuint* buffers) {
+  for (GLsizei i { 0 }; i < count; i++) {
+    buffers[i] = 1;
+  }
+}
+
+void APIENTRY MockDeleteBuffers(GLsizei, const GLuint*) { }
+
+void APIENTRY MockBufferData(GLenum, GLsizeiptr size, const void*, GLenum) {
+  mock_gl.memory.resize(static_cast<std::size_t>(size));
+}
+
+void APIENTRY MockBufferStorage(GLenum, GLsizeiptr size, const void*,
+                                GLbitfield) {
+  mock_gl.memory.resize(static_cast<std::size_t>(size));
+}
+
+void* APIENTRY MockMapBufferRange(GLenum, GLintptr offset, GLsizeiptr,
+                                  GLbitfield) {
+  mock_gl.map_count++;
+  return mock_gl.memory.data() + offset;
+}
+
+GLboolean APIENTRY MockUnmapBuffer(GLenum) {
+  return GL_TRUE;
+}
+
+GLsync APIENTRY MockFenceSync(GLenum, GLbitfield) {
+  static int fence { 0 };
+  return reinterpret_cast<GLsync>(&fence);
+}
+
+GLenum APIENTRY MockClientWaitSync(GLsync, GLbitfield, GLuint64) {
+  return GL_ALREADY_SIGNALED;
+}
+
+void APIENTRY MockDeleteSync(GLsync) { }
+
+void APIENTRY MockGetIntegerv(GLenum, GLint* data) {
+  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  *data = 256;
+}
+
+GlDispatch CreateMockDispatch(bool persistent) {
+  mock_gl = MockGl { };
+
+  return GlDispatch {
+    MockUseProgram, MockBindVertexArray, MockActiveTexture, MockBindTexture,
+    MockBindBuffer, MockBindBufferRange, MockGenBuffers, MockDeleteBuffers,
+    MockBufferData, persistent ? MockBufferStorage : nullptr,
+    MockMapBufferRange, MockUnmapBuffer, MockFenceSync, MockClientWaitSync,
+    MockDeleteSync, MockGetIntegerv
+  };
+}
+
+// Привязки, которые выполняет цикл отрисовки object_count объектов с
+// общими программой, массивом вершин и текстурой и своими матрицами.
+template <typename Bind>
+void DrawObjects(std::size_t object_count, Bind bind) {
+  for (std::size_t i { 0 }; i < object_count; i++) {
+    bind(static_cast<GLintptr>(i * 256));
+  }
+}
+
+// Все привязки передаются драйверу: четыре вызова на объект.
+void BM_GlDirectBinds(benchmark::State& state) {
+  const GlDispatch kGl { CreateMockDispatch(true) };
+  const std::size_t kObjectCount { static_cast<std::size_t>(state.range(0)) };
+
+  for (auto _ : state) {
+    DrawObjects(kObjectCount, [&kGl](GLintptr offset) {
+      kGl.use_program(1);
+      kGl.bind_vertex_array(1);
+      kGl.bind_texture(GL_TEXTURE_2D, 1);
+      kGl.bind_buffer_range(GL_UNIFORM_BUFFER, 0, 1, offset, 64);
+    });
+  }
+
+  state.counters["driver_calls_per_draw"] = benchmark::Counter(
+      static_cast<double>(mock_gl.call_count) / kObjectCount,
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GlDirectBinds)->Arg(1000);
+
+// Те же привязки через GlStateCache: после первого кадра драйверу
+// передаётся только смена диапазона буфера матриц.
+void BM_GlStateCacheBinds(benchmark::State& state) {
+  GlStateCache cache { CreateMockDispatch(true) };
+  const std::size_t kObjectCount { static_cast<std::size_t>(state.range(0)) };
+
+  auto draw = [&cache](GLintptr offset) {
+    cache.UseProgram(1);
+    cache.BindVertexArray(1);
+    cache.BindTexture(0, GL_TEXTURE_2D, 1);
+    cache.BindBufferRange(GL_UNIFORM_BUFFER, 0, 1, offset, 64);
+  };
+
+  // первый кадр задаёт всё состояние
+  DrawObjects(kObjectCount, draw);
+  mock_gl.call_count = 0;
+
+  for (auto _ : state) {
+    DrawObjects(kObjectCount, draw);
+  }
+
+  if (mock_gl.call_count != state.iterations() * kObjectCount) {
+    state.SkipWithError("Redundant binds reached the driver");
+    return;
+  }
+
+  state.counters["driver_calls_per_draw"] = benchmark::Counter(
+      static_cast<double>(mock_gl.call_count) / kObjectCount,
+      benchmark::Counter::kAvgIterations);
+  state.counters["elided"] = static_cast<double>(cache.GetElidedCount()) /
+                             cache.GetRequestCount();
+}
+BENCHMARK(BM_GlStateCacheBinds)->Arg(1000);
+
+// Кадр UniformRing: state.range(0) участков по одной матрице. С постоянным
+// отображением буфер не отображается заново ни в одном кадре.
+void BM_UniformRing(benchmark::State& state) {
+  const bool kPersistent { state.range(1) != 0 };
+  GlStateCache cache { CreateMockDispatch(kPersistent) };
+  const std::size_t kObjectCount { static_cast<std::size_t>(state.range(0)) };
+  UniformRing ring { cache, kObjectCount * 256 };
+  const std::size_t kInitialMapCount { mock_gl.map_count };
+
+  for (auto _ : state) {
+    ring.BeginFrame();
+    for (std::size_t i { 0 }; i < kObjectCount; i++) {
+      const UniformAllocation kAllocation { ring.Allocate(64) };
+      static_cast<float*>(kAllocation.data)[0] = 1.0f;
+      ring.Bind(0, kAllocation, 0, 64);
+    }
+    ring.Flush();
+    ring.EndFrame();
+  }
+
+  if (kPersistent && mock_gl.map_count != kInitialMapCount) {
+    state.SkipWithError("Persistent ring was mapped again");
+    return;
+  }
+
+  state.counters["maps_per_frame"] = benchmark::Counter(
+      static_cast<double>(mock_gl.map_count - kInitialMapCount),
+      benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * kObjectCount);
+}
+BENCHMARK(BM_UniformRing)->Args({ 1000, 1 })->Args({ 1000, 0 });
+
+}  // namespace
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <stb/stb_image.h>
+
+#include "image_writer.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Кадр размера окна с плавными переходами, похожий на отрисованный, из
+// первых channels каналов RGBA.
+Image CreateFrame(int channels = 4) {
+  Image image { kViewportWidth, kViewportHeight, channels, { } };
+  image.pixels.resize(static_cast<std::size_t>(image.width) * image.height *
+                      image.channels);
+
+  for (int y { 0 }; y < image.height; y++) {
+    for (int x { 0 }; x < image.width; x++) {
+      unsigned char* pixel {
+        image.pixels.data() + (static_cast<std::size_t>(y) * image.width + x) *
+                                  image.channels
+      };
+      const unsigned char kRgba[] {
+        static_cast<unsigned char>(x), static_cast<unsigned char>(y),
+        static_cast<unsigned char>((x * y) >> 8), 255
+      };
+      std::copy(kRgba, kRgba + channels, pixel);
+    }
+  }
+
+  return image;
+}
+
+// Декодирует png и сравнивает с изображением, из которого он получен.
+bool DecodesTo(const std::vector<unsigned char>& png, const Image& image) {
+  int width { 0 }, height { 0 }, channels { 0 };
+  unsigned char* data {
+    stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &width,
+                          &height, &channels, 0)
+  };
+  if (!data) {
+    return false;
+  }
+
+  const bool kEqual {
+    width == image.width && height == image.height &&
+    channels == image.channels &&
+    std::equal(image.pixels.begin(), image.pixels.end(), data)
+  };
+  stbi_image_free(data);
+  return kEqual;
+}
+
+// Кодирование одного кадра в PNG с уровнем сжатия state.range(0).
+// Сначала кадры из 1-4 каналов кодируются и декодируются stb_image.
+void BM_EncodePng(benchmark::State& state) {
+  const int kLevel { static_cast<int>(state.range(0)) };
+  for (int channels { 1 }; channels <= 4; channels++) {
+    const Image kImage { CreateFrame(channels) };
+    const ImageView kImageView {
+      kImage.width, kImage.height, kImage.channels, kImage.pixels.data()
+    };
+    if (!DecodesTo(EncodePng(kImageView, kLevel), kImage)) {
+      state.SkipWithError("Decoded PNG differs from the image");
+      return;
+    }
+  }
+
+  const Image kFrame { CreateFrame() };
+  const ImageView kView {
+    kFrame.width, kFrame.height, kFrame.channels, kFrame.pixels.data()
+  };
+
+  std::size_t size { 0 };
+  for (auto _ : state) {
+    size = EncodePng(kView, kLevel).size();
+    benchmark::DoNotOptimize(size);
+  }
+
+  state.counters["ratio"] =
+      static_cast<double>(kFrame.pixels.size()) / size;
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodePng)->Arg(1)->Arg(6)->Unit(benchmark::kMillisecond);
+
+// Запись 16 кадров в PNG пулом из state.range(0) потоков.
+void BM_ImageWriter(benchmark::State& state) {
+  constexpr int kFrameCount { 16 };
+  const Image kFrame { CreateFrame() };
+  const std::filesystem::path kDirectory {
+    std::filesystem::temp_directory_path() / "lab8_image_writer_bench"
+  };
+  std::filesystem::create_directories(kDirectory);
+  const std::string kPattern { (kDirectory / "frame_##.png").string() };
+
+  ImageWriter writer { static_cast<unsigned int>(state.range(0)) };
+
+  for (auto _ : state) {
+    for (int i { 0 }; i < kFrameCount; i++) {
+      writer.Submit(GetSequencePath(kPattern, i), kFrame);
+    }
+    writer.Wait();
+  }
+
+  std::filesystem::remove_all(kDirectory);
+
+  if (writer.GetFailureCount() > 0) {
+    state.SkipWithError("Failed to write the frames");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+BENCHMARK(BM_ImageWriter)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,71 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "index_buffer.hpp"
+#include "mesh_generator.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Вариант построения индексного буфера: исходный список, список после
+// оптимизации для кэша вершин, полосы с сохранением обхода и без него.
+IndexBufferOptions GetOptions(long variant) {
+  IndexBufferOptions options { };
+  options.optimize_vertex_cache = variant >= 1;
+  options.use_triangle_strips = variant >= 2;
+  options.preserve_winding = variant != 3;
+  return options;
+}
+
+// Время построения буфера и счётчики ACMR, ATVR и размера буфера в байтах
+// для сравнения вариантов между собой.
+void RunIndexBufferBenchmark(benchmark::State& state,
+                             const std::vector<unsigned int>& indices,
+                             std::size_t vertex_count) {
+  const IndexBufferOptions kOptions { GetOptions(state.range(1)) };
+
+  IndexBuffer buffer { };
+  for (auto _ : state) {
+    buffer = CreateIndexBuffer(indices, vertex_count, kOptions);
+    benchmark::DoNotOptimize(buffer.data.data());
+  }
+
+  const VertexCacheStatistics kStatistics {
+    AnalyzeVertexCache(buffer, vertex_count)
+  };
+  state.counters["acmr"] = kStatistics.acmr;
+  state.counters["atvr"] = kStatistics.atvr;
+  state.counters["bytes"] = buffer.data.size();
+  state.counters["strip"] = buffer.mode == GL_TRIANGLE_STRIP;
+}
+
+void BM_CylinderIndexBuffer(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+  const MeshSize kSize { GetCylinderMeshSize(kSectorCount) };
+
+  RunIndexBufferBenchmark(state, CreateCylinderIndices(kSectorCount),
+                          kSize.coordinate_count / 5);
+}
+BENCHMARK(BM_CylinderIndexBuffer)
+    ->ArgNames({ "sectors", "variant" })
+    ->ArgsProduct({ { 30, 4096, 65536 }, { 0, 1, 2, 3 } })
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_SphereIndexBuffer(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+  const unsigned int kStackCount { kSectorCount / 2 };
+  const MeshSize kSize { GetSphereMeshSize(kSectorCount, kStackCount) };
+
+  std::vector<unsigned int> indices(kSize.index_count);
+  GenerateSphereIndices(kSectorCount, kStackCount, indices.data(),
+                        indices.size());
+
+  RunIndexBufferBenchmark(state, indices, kSize.coordinate_count / 5);
+}
+BENCHMARK(BM_SphereIndexBuffer)
+    ->ArgNames({ "sectors", "variant" })
+    ->ArgsProduct({ { 32, 256, 512 }, { 0, 1, 2, 3 } })
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
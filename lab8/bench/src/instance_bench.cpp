@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/matrix.hpp>
+
+#include "instance_store.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Покадровое обновление state.range(0) фигур по одной: UpdatePosition и
+// CreateTransform для каждой, как для одиночной фигуры в main.cpp.
+void BM_InstancesGlm(benchmark::State& state) {
+  const std::size_t kCount { static_cast<std::size_t>(state.range(0)) };
+  const InstanceStore kStore { CreateInstanceStore(kCount, 0) };
+
+  std::vector<float> x_offsets { kStore.x_offsets };
+  std::vector<float> y_offsets { kStore.y_offsets };
+  std::vector<int> x_directions(kCount);
+  std::vector<int> y_directions(kCount);
+  std::vector<float> alphas { kStore.alphas };
+  std::vector<float> betas { kStore.betas };
+  for (std::size_t i { 0 }; i < kCount; i++) {
+    x_directions[i] = static_cast<int>(kStore.x_directions[i]);
+    y_directions[i] = static_cast<int>(kStore.y_directions[i]);
+  }
+
+  std::vector<glm::mat4> transforms(kCount);
+
+  for (auto _ : state) {
+    for (std::size_t i { 0 }; i < kCount; i++) {
+      alphas[i] += kAlphaChanging;
+      betas[i] += kBetaChanging;
+      UpdatePosition(x_offsets[i], y_offsets[i], x_directions[i],
+                     y_directions[i]);
+      transforms[i] = CreateTransform(x_offsets[i], y_offsets[i], alphas[i],
+                                      betas[i]);
+    }
+    benchmark::DoNotOptimize(transforms.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kCount);
+}
+BENCHMARK(BM_InstancesGlm)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// То же для структуры массивов и векторных ядер.
+void BM_InstancesSoA(benchmark::State& state) {
+  const std::size_t kCount { static_cast<std::size_t>(state.range(0)) };
+  InstanceStore store { CreateInstanceStore(kCount, 0) };
+  std::vector<float> transforms(kCount * kInstanceTransformSize);
+
+  for (auto _ : state) {
+    UpdateInstancePositions(store);
+    RotateInstances(store, kAlphaChanging, kBetaChanging);
+    BuildInstanceTransforms(store, transforms.data());
+    benchmark::DoNotOptimize(transforms.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kCount);
+}
+BENCHMARK(BM_InstancesSoA)->RangeMultiplier(10)->Range(1000, 1000000);
+
+}  // namespace
@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cylinder_lod.hpp"
+#include "instance_bvh.hpp"
+#include "instance_store.hpp"
+#include "job_system.hpp"
+#include "simulation.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr std::size_t kInstanceCount { 100000 };
+constexpr std::size_t kGrainSize { 1024 };
+
+// Данные подготовки кадра: два шага моделирования и результаты стадий.
+struct FrameData {
+  InstanceStore previous;
+  InstanceStore current;
+  InstanceStore instances;
+  std::vector<float> transforms;
+  InstanceBounds bounds;
+  std::vector<unsigned char> levels;
+};
+
+FrameData CreateFrameData() {
+  FrameData data { };
+  data.previous = CreateInstanceStore(kInstanceCount, 0);
+  data.current = data.previous;
+  StepSimulation(data.current, kAlphaChanging, kBetaChanging);
+  data.instances.Resize(kInstanceCount);
+  data.transforms.resize(kInstanceCount * kInstanceTransformSize);
+  data.bounds.Resize(kInstanceCount);
+  data.levels.resize(kInstanceCount, 0);
+  return data;
+}
+
+// Стадии кадра, которые main выполняет заданиями: интерполяция, матрицы,
+// границы для отсечения и выбор уровней детализации.
+void PrepareFrame(JobSystem& jobs, const CylinderLod& lod, FrameData& data) {
+  jobs.ParallelFor(
+      kInstanceCount, kGrainSize, [&](std::size_t first, std::size_t end) {
+        InterpolateInstances(data.previous, data.current, 0.5f, first,
+                             end - first, data.instances);
+      });
+  jobs.ParallelFor(
+      kInstanceCount, kGrainSize, [&](std::size_t first, std::size_t end) {
+        BuildInstanceTransforms(data.instances, first, end - first,
+                                data.transforms.data());
+        ComputeCylinderBounds(data.transforms.data(), first, end - first,
+                              kCylinderRadius, kCylinderHalfHeight,
+                              data.bounds);
+      });
+  jobs.ParallelFor(
+      kInstanceCount, kGrainSize, [&](std::size_t first, std::size_t end) {
+        std::vector<std::uint32_t> indices(end - first);
+        for (std::size_t i { first }; i < end; i++) {
+          indices[i - first] = static_cast<std::uint32_t>(i);
+        }
+        lod.SelectLevels(
+            data.transforms.data() + first * kInstanceTransformSize,
+            indices.data(), end - first, static_cast<float>(kViewportWidth),
+            static_cast<float>(kViewportHeight), data.levels);
+      });
+}
+
+bool IsEqual(const FrameData& a, const FrameData& b) {
+  return a.transforms == b.transforms && a.bounds.min_x == b.bounds.min_x &&
+         a.bounds.max_z == b.bounds.max_z && a.levels == b.levels;
+}
+
+// Подготовка кадра из kInstanceCount экземпляров в state.range(0) потоках.
+// Результат сверяется с подготовкой в одном потоке.
+void BM_FramePrepare(benchmark::State& state) {
+  const CylinderLod kLod {
+    CreateLodSectorCounts(2 * kCylinderSectorCount), kCylinderRadius, 0.5f
+  };
+  JobSystem jobs { static_cast<unsigned int>(state.range(0)) };
+  FrameData data { CreateFrameData() };
+
+  for (auto _ : state) {
+    PrepareFrame(jobs, kLod, data);
+    benchmark::DoNotOptimize(data.levels.data());
+  }
+
+  JobSystem serial_jobs { 1 };
+  FrameData expected { CreateFrameData() };
+  expected.levels = data.levels;
+  PrepareFrame(serial_jobs, kLod, expected);
+  PrepareFrame(jobs, kLod, data);
+  if (!IsEqual(data, expected)) {
+    state.SkipWithError("Parallel frame preparation differs from serial");
+    return;
+  }
+  state.counters["steals"] = benchmark::Counter(
+      static_cast<double>(jobs.GetStealCount()),
+      benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_FramePrepare)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Постановка и ожидание state.range(0) пустых заданий.
+void BM_JobSpawn(benchmark::State& state) {
+  JobSystem jobs { 4 };
+  std::atomic<std::int64_t> done_count { 0 };
+
+  for (auto _ : state) {
+    JobCounter counter { };
+    for (std::int64_t i { 0 }; i < state.range(0); i++) {
+      jobs.Run([&done_count] { done_count.fetch_add(1); }, &counter);
+    }
+    jobs.Wait(counter);
+  }
+
+  if (done_count != state.iterations() * state.range(0)) {
+    state.SkipWithError("Not every job was executed");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_JobSpawn)->Arg(1000)->UseRealTime();
+
+// Цепочка из восьми стадий по 64 задания, каждая из которых зависит от
+// счётчика предыдущей. Задание проверяет, что предыдущая стадия
+// завершилась целиком.
+void BM_JobDependencies(benchmark::State& state) {
+  constexpr std::size_t kStageCount { 8 };
+  constexpr std::size_t kStageSize { 64 };
+  JobSystem jobs { 4 };
+  bool is_ordered { true };
+
+  for (auto _ : state) {
+    std::vector<std::atomic<std::size_t>> done_counts(kStageCount);
+    std::vector<JobCounter> counters(kStageCount);
+    std::atomic<bool> stage_started_early { false };
+
+    for (std::size_t stage { 0 }; stage < kStageCount; stage++) {
+      for (std::size_t i { 0 }; i < kStageSize; i++) {
+        jobs.Run(
+            [&done_counts, &stage_started_early, stage] {
+              if (stage > 0 && done_counts[stage - 1] != kStageSize) {
+                stage_started_early = true;
+              }
+              done_counts[stage].fetch_add(1);
+            },
+            &counters[stage], stage > 0 ? &counters[stage - 1] : nullptr);
+      }
+    }
+    jobs.Wait(counters.back());
+
+    is_ordered = is_ordered && !stage_started_early &&
+                 done_counts.back() == kStageSize;
+  }
+
+  if (!is_ordered) {
+    state.SkipWithError("A stage started before its dependency finished");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * kStageCount * kStageSize);
+}
+BENCHMARK(BM_JobDependencies)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "cylinder_lod.hpp"
+#include "instance_store.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr float kMaxError { 0.5f };
+
+CylinderLod CreateLod() {
+  return CylinderLod {
+    CreateLodSectorCounts(2 * kCylinderSectorCount), kCylinderRadius,
+    kMaxError
+  };
+}
+
+std::vector<float> CreateTransforms(std::size_t count) {
+  std::vector<float> transforms(count * kInstanceTransformSize);
+  BuildInstanceTransforms(CreateInstanceStore(count, 0), transforms.data());
+
+  return transforms;
+}
+
+// Выбор уровней для state.range(0) фигур. Счётчик triangles -- доля
+// треугольников относительно отрисовки всех фигур с kCylinderSectorCount
+// секторами; проверяется, что погрешность силуэта не превышает kMaxError.
+void BM_CylinderLodSelect(benchmark::State& state) {
+  const std::size_t kCount { static_cast<std::size_t>(state.range(0)) };
+  const CylinderLod kLod { CreateLod() };
+  const std::vector<float> kTransforms { CreateTransforms(kCount) };
+  const float kWidth { static_cast<float>(kViewportWidth) };
+  const float kHeight { static_cast<float>(kViewportHeight) };
+
+  std::vector<unsigned char> levels { };
+  for (auto _ : state) {
+    kLod.SelectLevels(kTransforms.data(), kCount, kWidth, kHeight, levels);
+    benchmark::DoNotOptimize(levels.data());
+  }
+
+  std::size_t sector_count { 0 };
+  for (std::size_t i { 0 }; i < kCount; i++) {
+    const float kProjectedRadius {
+      kLod.GetProjectedRadius(kTransforms.data() + i * kInstanceTransformSize,
+                              kWidth, kHeight)
+    };
+    if (kLod.GetError(levels[i], kProjectedRadius) > kMaxError) {
+      state.SkipWithError("Silhouette error exceeds the bound");
+      return;
+    }
+    sector_count += kLod.GetSectorCount(levels[i]);
+  }
+
+  state.counters["triangles"] =
+      static_cast<double>(sector_count) / (kCount * kCylinderSectorCount);
+  state.SetItemsProcessed(state.iterations() * kCount);
+}
+BENCHMARK(BM_CylinderLodSelect)->Arg(1000)->Arg(100000);
+
+// Смены уровня за кадр при колебании размера фигур на 2% для гистерезиса
+// state.range(0) процентов. С гистерезисом фигура может один раз перейти на
+// соседний уровень, но не должна переключаться туда и обратно.
+void BM_CylinderLodHysteresis(benchmark::State& state) {
+  constexpr std::size_t kCount { 10000 };
+  constexpr int kFrameCount { 64 };
+  const float kHysteresis { static_cast<float>(state.range(0)) / 100.0f };
+  const CylinderLod kLod {
+    CreateLodSectorCounts(2 * kCylinderSectorCount), kCylinderRadius,
+    kMaxError, kHysteresis
+  };
+  const std::vector<float> kTransforms { CreateTransforms(kCount) };
+
+  std::vector<float> radii(kCount);
+  for (std::size_t i { 0 }; i < kCount; i++) {
+    radii[i] = kLod.GetProjectedRadius(
+        kTransforms.data() + i * kInstanceTransformSize,
+        static_cast<float>(kViewportWidth),
+        static_cast<float>(kViewportHeight));
+  }
+
+  std::size_t switch_count { 0 };
+  std::size_t flicker_count { 0 };
+  for (auto _ : state) {
+    std::mt19937 generator { 0 };
+    std::uniform_real_distribution<float> jitter { 0.98f, 1.02f };
+    std::vector<std::size_t> levels(kCount, 0);
+    std::vector<int> switches(kCount, 0);
+
+    for (int frame { 0 }; frame < kFrameCount; frame++) {
+      for (std::size_t i { 0 }; i < kCount; i++) {
+        const std::size_t kLevel {
+          kLod.SelectLevel(radii[i] * jitter(generator), levels[i])
+        };
+        // первый кадр только устанавливает уровни
+        if (frame > 0 && kLevel != levels[i]) {
+          switches[i]++;
+        }
+        levels[i] = kLevel;
+      }
+    }
+
+    switch_count = 0;
+    flicker_count = 0;
+    for (int count : switches) {
+      switch_count += count;
+      flicker_count += count > 1 ? 1 : 0;
+    }
+  }
+
+  state.counters["switches"] =
+      static_cast<double>(switch_count) / (kFrameCount - 1);
+  state.counters["flickering"] = static_cast<double>(flicker_count);
+  if (kHysteresis < 1.0f && flicker_count > 0) {
+    state.SkipWithError("Levels flicker under a 2% size jitter");
+  }
+}
+BENCHMARK(BM_CylinderLodHysteresis)
+    ->Arg(100)
+    ->Arg(75)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,322 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "draw_commands.hpp"
+#include "tlsf_allocator.hpp"
+
+namespace {
+
+constexpr std::size_t kCapacity { 1 << 25 };
+constexpr std::size_t kLiveCount { 4096 };
+
+// Простейший распределитель с первым подходящим участком: свободные
+// участки упорядочены по смещению и просматриваются подряд.
+class FirstFitAllocator {
+ public:
+  explicit FirstFitAllocator(std::size_t capacity) {
+    free_[0] = capacity;
+  }
+
+  std::size_t Allocate(std::size_t size) {
+    for (auto iterator { free_.begin() }; iterator != free_.end();
+         ++iterator) {
+      if (iterator->second >= size) {
+        const std::size_t kOffset { iterator->first };
+        const std::size_t kRest { iterator->second - size };
+        free_.erase(iterator);
+        if (kRest > 0) {
+          free_[kOffset + size] = kRest;
+        }
+        return kOffset;
+      }
+    }
+    return kCapacity;
+  }
+
+  void Free(std::size_t offset, std::size_t size) {
+    auto iterator { free_.emplace(offset, size).first };
+    auto next { std::next(iterator) };
+    if (next != free_.end() && offset + size == next->first) {
+      iterator->second += next->second;
+      free_.erase(next);
+    }
+    if (iterator != free_.begin()) {
+      auto previous { std::prev(iterator) };
+      if (previous->first + previous->second == offset) {
+        previous->second += iterator->second;
+        free_.erase(iterator);
+      }
+    }
+  }
+
+ private:
+  std::map<std::size_t, std::size_t> free_;
+};
+
+// Размеры сеток: от десятков до десятков тысяч вершин.
+std::vector<std::size_t> CreateSizes(std::size_t count) {
+  std::mt19937 generator { 0 };
+  std::uniform_real_distribution<double> exponent { 4.0, 15.0 };
+
+  std::vector<std::size_t> sizes(count);
+  for (std::size_t& size : sizes) {
+    size = static_cast<std::size_t>(std::exp2(exponent(generator)));
+  }
+  return sizes;
+}
+
+// Проверяет, что занятые участки не пересекаются и лежат в диапазоне.
+bool IsConsistent(const TlsfAllocator& allocator,
+                  const std::vector<TlsfHandle>& handles) {
+  std::vector<std::pair<std::size_t, std::size_t>> blocks { };
+  std::size_t used_size { 0 };
+  for (TlsfHandle handle : handles) {
+    if (handle != kInvalidTlsfHandle) {
+      blocks.emplace_back(allocator.GetOffset(handle),
+                          allocator.GetSize(handle));
+      used_size += allocator.GetSize(handle);
+    }
+  }
+  std::sort(blocks.begin(), blocks.end());
+
+  for (std::size_t i { 0 }; i < blocks.size(); i++) {
+    const std::size_t kEnd { blocks[i].first + blocks[i].second };
+    if (kEnd > allocator.GetCapacity() ||
+        (i + 1 < blocks.size() && kEnd > blocks[i + 1].first)) {
+      return false;
+    }
+  }
+  return used_size == allocator.GetUsedSize() &&
+         blocks.size() == allocator.GetAllocationCount();
+}
+
+// Замена случайной сетки из kLiveCount живых новой сеткой другого размера.
+void BM_TlsfAllocator(benchmark::State& state) {
+  TlsfAllocator allocator { kCapacity };
+  const std::vector<std::size_t> kSizes { CreateSizes(1 << 16) };
+  std::vector<TlsfHandle> handles(kLiveCount, kInvalidTlsfHandle);
+  for (std::size_t i { 0 }; i < kLiveCount; i++) {
+    handles[i] = allocator.Allocate(kSizes[i]);
+  }
+
+  std::size_t next { 0 };
+  std::size_t failure_count { 0 };
+  for (auto _ : state) {
+    TlsfHandle& handle { handles[next % kLiveCount] };
+    if (handle != kInvalidTlsfHandle) {
+      allocator.Free(handle);
+    }
+    handle = allocator.Allocate(kSizes[next % kSizes.size()]);
+    failure_count += handle == kInvalidTlsfHandle ? 1 : 0;
+    next = next * 7 + 3;
+  }
+
+  if (!IsConsistent(allocator, handles)) {
+    state.SkipWithError("Allocations overlap");
+    return;
+  }
+  state.counters["failures"] = static_cast<double>(failure_count);
+  state.counters["fragmentation"] =
+      1.0 - static_cast<double>(allocator.GetLargestFreeSize()) /
+                (allocator.GetCapacity() - allocator.GetUsedSize());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TlsfAllocator);
+
+// То же с распределителем первого подходящего участка.
+void BM_FirstFitAllocator(benchmark::State& state) {
+  FirstFitAllocator allocator { kCapacity };
+  const std::vector<std::size_t> kSizes { CreateSizes(1 << 16) };
+  std::vector<std::pair<std::size_t, std::size_t>> blocks(kLiveCount);
+  for (std::size_t i { 0 }; i < kLiveCount; i++) {
+    blocks[i] = { allocator.Allocate(kSizes[i]), kSizes[i] };
+  }
+
+  std::size_t next { 0 };
+  for (auto _ : state) {
+    std::pair<std::size_t, std::size_t>& block { blocks[next % kLiveCount] };
+    if (block.first != kCapacity) {
+      allocator.Free(block.first, block.second);
+    }
+    block.second = kSizes[next % kSizes.size()];
+    block.first = allocator.Allocate(block.second);
+    next = next * 7 + 3;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FirstFitAllocator);
+
+// Дефрагментация после освобождения половины сеток. Данные участков
+// переносятся в копию диапазона по перемещениям и проверяются.
+void BM_TlsfDefragment(benchmark::State& state) {
+  const std::vector<std::size_t> kSizes { CreateSizes(kLiveCount) };
+  TlsfAllocator allocator { kCapacity };
+  std::vector<TlsfHandle> handles(kLiveCount);
+  std::vector<TlsfHandle> memory(kCapacity);
+  std::vector<TlsfMove> moves { };
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    allocator = TlsfAllocator { kCapacity };
+    for (std::size_t i { 0 }; i < kLiveCount; i++) {
+      handles[i] = allocator.Allocate(kSizes[i]);
+    }
+    for (std::size_t i { 0 }; i < kLiveCount; i += 2) {
+      allocator.Free(handles[i]);
+      handles[i] = kInvalidTlsfHandle;
+    }
+
+    // в каждой единице участка записан его номер
+    for (TlsfHandle handle : handles) {
+      if (handle != kInvalidTlsfHandle) {
+        std::fill_n(memory.begin() + allocator.GetOffset(handle),
+                    allocator.GetSize(handle), handle);
+      }
+    }
+    state.ResumeTiming();
+
+    allocator.Defragment(moves);
+
+    state.PauseTiming();
+    for (const TlsfMove& kMove : moves) {
+      std::memmove(memory.data() + kMove.destination,
+                   memory.data() + kMove.source,
+                   kMove.size * sizeof(TlsfHandle));
+    }
+    for (TlsfHandle handle : handles) {
+      if (handle == kInvalidTlsfHandle) {
+        continue;
+      }
+      const auto kBegin { memory.begin() + allocator.GetOffset(handle) };
+      if (std::count(kBegin, kBegin + allocator.GetSize(handle), handle) !=
+          static_cast<std::ptrdiff_t>(allocator.GetSize(handle))) {
+        state.SkipWithError("Defragmentation lost data");
+        return;
+      }
+    }
+    if (!IsConsistent(allocator, handles) ||
+        allocator.GetLargestFreeSize() !=
+            allocator.GetCapacity() - allocator.GetUsedSize()) {
+      state.SkipWithError("Free space is still fragmented");
+      return;
+    }
+    state.counters["moves"] = static_cast<double>(moves.size());
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_TlsfDefragment)
+    ->Iterations(20)
+    ->Unit(benchmark::kMicrosecond);
+
+// Выделение в свободный участок ровно из TlsfAllocator::GetFitSize(size)
+// единиц, которым MeshArena::AddMesh дополняет занятое место при
+// увеличении буферов. Проверяется и пустой распределитель, и
+// дефрагментированный с чередующимися занятыми участками.
+bool AllocateExactFit(std::size_t size) {
+  const std::size_t kFitSize { TlsfAllocator::GetFitSize(size) };
+  TlsfAllocator empty { kFitSize };
+  if (empty.Allocate(size) == kInvalidTlsfHandle) {
+    return false;
+  }
+
+  TlsfAllocator allocator { 1 << 10 };
+  std::vector<TlsfHandle> handles { };
+  for (TlsfHandle handle { allocator.Allocate(100) };
+       handle != kInvalidTlsfHandle; handle = allocator.Allocate(100)) {
+    handles.push_back(handle);
+  }
+  for (std::size_t i { 0 }; i < handles.size(); i += 2) {
+    allocator.Free(handles[i]);
+    handles[i] = kInvalidTlsfHandle;
+  }
+
+  std::vector<TlsfMove> moves { };
+  allocator.Defragment(moves);
+  allocator.Grow(std::max(allocator.GetCapacity(),
+                          allocator.GetUsedSize() + kFitSize));
+  handles.push_back(allocator.Allocate(size));
+  return handles.back() != kInvalidTlsfHandle &&
+         IsConsistent(allocator, handles);
+}
+
+void BM_TlsfExactFit(benchmark::State& state) {
+  const std::size_t kSizes[] {
+    1, 15, 16, 17, 101, 1000, 4097, 65535, 65537, 3 * 65536 + 1
+  };
+
+  for (auto _ : state) {
+    for (std::size_t size : kSizes) {
+      if (!AllocateExactFit(size)) {
+        state.SkipWithError("Allocation does not fit into GetFitSize");
+        return;
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * std::size(kSizes));
+}
+BENCHMARK(BM_TlsfExactFit);
+
+// Команды кадра: state.range(0) экземпляров по 5 уровням детализации,
+// порциями по 256. Соседние экземпляры одной сетки сливаются в команду.
+void BM_DrawCommandBuilder(benchmark::State& state) {
+  constexpr std::size_t kMeshCount { 5 };
+  constexpr std::size_t kBatchSize { 256 };
+  const std::size_t kInstanceCount {
+    static_cast<std::size_t>(state.range(0))
+  };
+
+  std::mt19937 generator { 0 };
+  std::uniform_int_distribution<std::size_t> mesh { 0, kMeshCount - 1 };
+  std::vector<std::size_t> meshes(kInstanceCount);
+  for (std::size_t& instance_mesh : meshes) {
+    instance_mesh = mesh(generator);
+  }
+  std::sort(meshes.begin(), meshes.end());
+
+  DrawCommandBuilder builder { };
+  std::size_t command_count { 0 };
+  for (auto _ : state) {
+    command_count = 0;
+    for (std::size_t first { 0 }; first < kInstanceCount;
+         first += kBatchSize) {
+      builder.Clear();
+      const std::size_t kEnd { std::min(first + kBatchSize, kInstanceCount) };
+      for (std::size_t i { first }; i < kEnd; i++) {
+        const GLuint kMesh { static_cast<GLuint>(meshes[i]) };
+        builder.Add(GL_TRIANGLE_STRIP,
+                    DrawElementsIndirectCommand {
+                      100 * kMesh, 1, 1000 * kMesh,
+                      static_cast<GLint>(500 * kMesh),
+                      static_cast<GLuint>(i - first)
+                    });
+      }
+      command_count += builder.GetCommands().size();
+      benchmark::DoNotOptimize(builder.GetCommands().data());
+    }
+  }
+
+  // в каждой порции не больше одной команды на сетку
+  const std::size_t kBatchCount {
+    (kInstanceCount + kBatchSize - 1) / kBatchSize
+  };
+  if (command_count > kBatchCount + kMeshCount - 1) {
+    state.SkipWithError("Adjacent instances were not merged");
+    return;
+  }
+  state.counters["commands"] = static_cast<double>(command_count);
+  state.SetItemsProcessed(state.iterations() * kInstanceCount);
+}
+BENCHMARK(BM_DrawCommandBuilder)->Arg(10000);
+
+}  // namespace
@@ -0,0 +1,328 @@
+// Микробенчмарки lab8_utils. Запускаются из корня репозитория, так как пути
+// к данным относительны (см. kPathPrefix). Для отслеживания регрессий
+// результаты сохраняются в машиночитаемом виде:
+//   lab8_bench --benchmark_out=results.json --benchmark_out_format=json
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "job_system.hpp"
+#include "mesh_generator.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Допустимое отклонение TrigKernel::kAngleAddition от TrigKernel::kExact
+// для координат, по модулю не превышающих 1. Аргументы i * step и
+// begin * step + j * step округляются по-разному, что даёт до 1.5 ULP
+// угла (до 1.33e-15 при углах до 2 pi), и ещё около ULP добавляют
+// умножения; допуск взят с двукратным запасом.
+constexpr double kAngleAdditionTolerance { 16 * DBL_EPSILON };
+
+// Прежняя скалярная реализация CreateCylinderCoordinates, с которой
+// сверяется TrigKernel::kExact.
+std::vector<double> CreateReferenceCylinderCoordinates(
+    unsigned int sector_count, double radius, double height) {
+  assert(sector_count >= 3);
+
+  std::vector<double> coordinates(10 * (sector_count + 1));
+
+  const double kSectorStep { 2.0f * M_PI / sector_count };
+
+  double sector_angle { 0 };
+  double position_x { 0 };
+  double position_y { 0 };
+  double texture_x { 0 };
+  for (unsigned int i { 0 }, j { 0 }; i <= sector_count; i++) {
+    sector_angle = i * kSectorStep;
+    position_x = radius * std::cos(sector_angle);
+    position_y = radius * std::sin(sector_angle);
+    texture_x = static_cast<double>(i) / sector_count;
+
+    coordinates[j++] = position_x;
+    coordinates[j++] = position_y;
+    coordinates[j++] = 0.5f * height;
+    coordinates[j++] = texture_x;
+    coordinates[j++] = 1.0f;
+
+    coordinates[j++] = position_x;
+    coordinates[j++] = position_y;
+    coordinates[j++] = -0.5f * height;
+    coordinates[j++] = texture_x;
+    coordinates[j++] = 0.0f;
+  }
+
+  return coordinates;
+}
+
+void SectorCountSweep(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(8)->Range(8, 1 << 21);
+  benchmark->Unit(benchmark::kMicrosecond);
+}
+
+void BM_CreateCylinderCoordinates(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+
+  for (auto _ : state) {
+    std::vector<double> coordinates {
+      CreateCylinderCoordinates(kSectorCount, kCylinderRadius, kCylinderHeight)
+    };
+    benchmark::DoNotOptimize(coordinates.data());
+  }
+
+  if (CreateCylinderCoordinates(kSectorCount, kCylinderRadius,
+                                kCylinderHeight) !=
+      CreateReferenceCylinderCoordinates(kSectorCount, kCylinderRadius,
+                                         kCylinderHeight)) {
+    state.SkipWithError("Coordinates differ from the scalar generator");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * kSectorCount);
+}
+BENCHMARK(BM_CreateCylinderCoordinates)->Apply(SectorCountSweep);
+
+void BM_CreateCylinderIndices(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+
+  for (auto _ : state) {
+    std::vector<unsigned int> indices { CreateCylinderIndices(kSectorCount) };
+    benchmark::DoNotOptimize(indices.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * kSectorCount);
+}
+BENCHMARK(BM_CreateCylinderIndices)->Apply(SectorCountSweep);
+
+// Генерация в заранее выделенный буфер без выделения памяти.
+void BM_GenerateCylinderCoordinates(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+  const TrigKernel kKernel { static_cast<TrigKernel>(state.range(1)) };
+
+  std::vector<double> coordinates(
+      GetCylinderMeshSize(kSectorCount).coordinate_count);
+
+  for (auto _ : state) {
+    GenerateCylinderCoordinates(kSectorCount, kCylinderRadius, kCylinderHeight,
+                                coordinates.data(), coordinates.size(),
+                                kKernel);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kSectorCount);
+}
+BENCHMARK(BM_GenerateCylinderCoordinates)
+    ->ArgNames({ "sectors", "kernel" })
+    ->ArgsProduct({ benchmark::CreateRange(8, 1 << 21, 8),
+                    { static_cast<long>(TrigKernel::kExact),
+                      static_cast<long>(TrigKernel::kAngleAddition) } })
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_GenerateCylinderIndices(benchmark::State& state) {
+  const unsigned int kSectorCount { static_cast<unsigned int>(state.range(0)) };
+
+  std::vector<unsigned int> indices(
+      GetCylinderMeshSize(kSectorCount).index_count);
+
+  for (auto _ : state) {
+    GenerateCylinderIndices(kSectorCount, indices.data(), indices.size());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kSectorCount);
+}
+BENCHMARK(BM_GenerateCylinderIndices)->Apply(SectorCountSweep);
+
+enum class Shape {
+  kCylinder,
+  kCappedCylinder,
+  kCone,
+  kSphere,
+  kTorus,
+};
+
+// Сетки для проверки генераторов; все координаты по модулю не больше 1.
+// У сферы и тора size секторов и size / 2 поясов (сторон), у остальных
+// фигур -- size секторов.
+struct Mesh {
+  std::vector<double> coordinates;
+  std::vector<unsigned int> indices;
+};
+
+MeshSize GetShapeMeshSize(Shape shape, unsigned int size) {
+  switch (shape) {
+    case Shape::kCylinder:
+      return GetCylinderMeshSize(size);
+    case Shape::kCappedCylinder:
+      return GetCappedCylinderMeshSize(size);
+    case Shape::kCone:
+      return GetConeMeshSize(size);
+    case Shape::kSphere:
+      return GetSphereMeshSize(size, size / 2);
+    case Shape::kTorus:
+      return GetTorusMeshSize(size, size / 2);
+  }
+  return { };
+}
+
+bool GenerateShape(Shape shape, unsigned int size, TrigKernel kernel,
+                   JobSystem* jobs, Mesh& mesh) {
+  double* coordinates { mesh.coordinates.data() };
+  const std::size_t kCoordinateCount { mesh.coordinates.size() };
+  unsigned int* indices { mesh.indices.data() };
+  const std::size_t kIndexCount { mesh.indices.size() };
+
+  // false, если генератор отказался записывать координаты или индексы
+  bool coordinates_written { false };
+  bool indices_written { false };
+  switch (shape) {
+    case Shape::kCylinder:
+      coordinates_written = GenerateCylinderCoordinates(
+          size, 0.5, 1.0, coordinates, kCoordinateCount, kernel, jobs);
+      indices_written = GenerateCylinderIndices(size, indices, kIndexCount,
+                                                jobs);
+      break;
+    case Shape::kCappedCylinder:
+      coordinates_written = GenerateCappedCylinderCoordinates(
+          size, 0.5, 1.0, coordinates, kCoordinateCount, kernel, jobs);
+      indices_written = GenerateCappedCylinderIndices(size, indices,
+                                                      kIndexCount, jobs);
+      break;
+    case Shape::kCone:
+      coordinates_written = GenerateConeCoordinates(
+          size, 0.5, 1.0, coordinates, kCoordinateCount, kernel, jobs);
+      indices_written = GenerateConeIndices(size, indices, kIndexCount, jobs);
+      break;
+    case Shape::kSphere:
+      coordinates_written = GenerateSphereCoordinates(
+          size, size / 2, 1.0, coordinates, kCoordinateCount, kernel, jobs);
+      indices_written = GenerateSphereIndices(size, size / 2, indices,
+                                              kIndexCount, jobs);
+      break;
+    case Shape::kTorus:
+      coordinates_written = GenerateTorusCoordinates(
+          size, size / 2, 0.75, 0.25, coordinates, kCoordinateCount, kernel,
+          jobs);
+      indices_written = GenerateTorusIndices(size, size / 2, indices,
+                                             kIndexCount, jobs);
+      break;
+  }
+  return coordinates_written && indices_written;
+}
+
+Mesh CreateShape(Shape shape, unsigned int size, TrigKernel kernel,
+                 JobSystem* jobs) {
+  const MeshSize kSize { GetShapeMeshSize(shape, size) };
+  Mesh mesh { std::vector<double>(kSize.coordinate_count),
+              std::vector<unsigned int>(kSize.index_count) };
+  GenerateShape(shape, size, kernel, jobs, mesh);
+  return mesh;
+}
+
+double GetMaxDifference(const std::vector<double>& a,
+                        const std::vector<double>& b) {
+  double difference { 0.0 };
+  for (std::size_t i { 0 }; i < a.size(); i++) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+// Генерация фигуры state.range(0) (Shape) размера state.range(1) ядром
+// state.range(2) (TrigKernel) в state.range(3) потоках (0 -- без
+// планировщика). Проверяется, что TrigKernel::kAngleAddition отличается от
+// TrigKernel::kExact не больше чем на kAngleAdditionTolerance, а генерация
+// с планировщиком совпадает с однопоточной бит в бит. Счётчик error_ulp --
+// наибольшее отклонение ядер в DBL_EPSILON.
+void BM_GenerateShape(benchmark::State& state) {
+  const Shape kShape { static_cast<Shape>(state.range(0)) };
+  const unsigned int kSize { static_cast<unsigned int>(state.range(1)) };
+  const TrigKernel kKernel { static_cast<TrigKernel>(state.range(2)) };
+  const unsigned int kThreadCount {
+    static_cast<unsigned int>(state.range(3))
+  };
+  JobSystem jobs { std::max(1u, kThreadCount) };
+  JobSystem* const kJobs { kThreadCount > 0 ? &jobs : nullptr };
+
+  // в буферы на одну координату и один индекс меньше нужного генераторы
+  // ничего не должны записывать
+  const MeshSize kMeshSize { GetShapeMeshSize(kShape, kSize) };
+  const Mesh kShortMesh {
+    std::vector<double>(kMeshSize.coordinate_count - 1),
+    std::vector<unsigned int>(kMeshSize.index_count - 1)
+  };
+  Mesh short_mesh { kShortMesh };
+  if (GenerateShape(kShape, kSize, kKernel, kJobs, short_mesh) ||
+      short_mesh.coordinates != kShortMesh.coordinates ||
+      short_mesh.indices != kShortMesh.indices) {
+    state.SkipWithError("Generator wrote into a buffer that is too small");
+    return;
+  }
+
+  Mesh mesh { CreateShape(kShape, kSize, kKernel, nullptr) };
+  for (auto _ : state) {
+    GenerateShape(kShape, kSize, kKernel, kJobs, mesh);
+    benchmark::ClobberMemory();
+  }
+
+  const Mesh kExact {
+    CreateShape(kShape, kSize, TrigKernel::kExact, nullptr)
+  };
+  const Mesh kAngleAddition {
+    CreateShape(kShape, kSize, TrigKernel::kAngleAddition, nullptr)
+  };
+  const Mesh& expected {
+    kKernel == TrigKernel::kExact ? kExact : kAngleAddition
+  };
+  if (mesh.coordinates != expected.coordinates ||
+      mesh.indices != expected.indices) {
+    state.SkipWithError("Generation with jobs differs from single-threaded");
+    return;
+  }
+  if (kAngleAddition.indices != kExact.indices) {
+    state.SkipWithError("Trig kernels produce different indices");
+    return;
+  }
+  const double kError {
+    GetMaxDifference(kAngleAddition.coordinates, kExact.coordinates)
+  };
+  if (kError > kAngleAdditionTolerance) {
+    state.SkipWithError("Angle addition error exceeds the tolerance");
+    return;
+  }
+
+  state.counters["error_ulp"] = kError / DBL_EPSILON;
+  state.SetItemsProcessed(state.iterations() * mesh.coordinates.size() / 5);
+}
+void ShapeArgs(benchmark::internal::Benchmark* benchmark,
+               const std::vector<Shape>& shapes,
+               const std::vector<long>& sizes) {
+  std::vector<long> shape_args { };
+  for (Shape shape : shapes) {
+    shape_args.push_back(static_cast<long>(shape));
+  }
+  benchmark->ArgNames({ "shape", "size", "kernel", "threads" })
+      ->ArgsProduct({ shape_args, sizes,
+                      { static_cast<long>(TrigKernel::kExact),
+                        static_cast<long>(TrigKernel::kAngleAddition) },
+                      { 0, 4 } })
+      ->Unit(benchmark::kMicrosecond);
+}
+
+// фигуры из одного ряда углов: size -- число секторов
+BENCHMARK(BM_GenerateShape)->Apply([](benchmark::internal::Benchmark* b) {
+  ShapeArgs(b, { Shape::kCylinder, Shape::kCappedCylinder, Shape::kCone },
+            { 8, 1 << 10, 1 << 17 });
+});
+
+// фигуры из size * size / 2 вершин
+BENCHMARK(BM_GenerateShape)->Apply([](benchmark::internal::Benchmark* b) {
+  ShapeArgs(b, { Shape::kSphere, Shape::kTorus }, { 8, 64, 1 << 10 });
+});
+
+}  // namespace
@@ -0,0 +1,199 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "profiler.hpp"
+#include "shader_cache.hpp"
+
+namespace {
+
+// Стоимость одного участка CPU: два чтения часов и запись в кольцевой
+// буфер потока. Буфер опустошается раз в 1000 участков, как если бы
+// каждый кадр содержал 1000 участков.
+void BM_ScopedCpuTimer(benchmark::State& state) {
+  Profiler& profiler { Profiler::GetInstance() };
+  int zone_count { 0 };
+
+  profiler.BeginFrame();
+  for (auto _ : state) {
+    {
+      ScopedCpuTimer timer { "Zone" };
+    }
+
+    if (++zone_count == 1000) {
+      state.PauseTiming();
+      profiler.EndFrame();
+      profiler.BeginFrame();
+      zone_count = 0;
+      state.ResumeTiming();
+    }
+  }
+  profiler.EndFrame();
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ScopedCpuTimer);
+
+// Стоимость сбора событий в EndFrame на участок.
+void BM_ProfilerEndFrame(benchmark::State& state) {
+  Profiler& profiler { Profiler::GetInstance() };
+  const int kZoneCount { static_cast<int>(state.range(0)) };
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    profiler.BeginFrame();
+    for (int i { 0 }; i < kZoneCount; i++) {
+      ScopedCpuTimer timer { "Zone" };
+    }
+    state.ResumeTiming();
+
+    profiler.EndFrame();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kZoneCount);
+}
+BENCHMARK(BM_ProfilerEndFrame)->Arg(16)->Arg(1024);
+
+// Суммарное время участка "Check" в кадре i из окна статистики: значения
+// 1, 2, ..., kMaxZoneFrameCount мкс в перемешанном порядке.
+std::int64_t GetCheckTotal(std::size_t frame) {
+  return static_cast<std::int64_t>(
+      (frame * 7 % Profiler::kMaxZoneFrameCount + 1) * 1000);
+}
+
+// Начало первого из двух событий участка "Check" в кадре frame.
+std::int64_t GetCheckStart(std::size_t frame) {
+  return static_cast<std::int64_t>(frame + 1) * 10000000;
+}
+
+// Число после key в строке события трассы или NaN.
+double ParseTraceNumber(const std::string& line, const std::string& key) {
+  const std::size_t kPosition { line.find(key) };
+  if (kPosition == std::string::npos) {
+    return std::nan("");
+  }
+  return std::strtod(line.c_str() + kPosition + key.size(), nullptr);
+}
+
+// Проверяет трассу: заголовок, одно метасобытие и три события "X" на
+// кадр (два "Check" и "Frame") со временем в микросекундах.
+bool CheckChromeTrace(const std::string& path) {
+  std::string text { };
+  if (!ReadFile(path, text)) {
+    return false;
+  }
+  std::istringstream stream { text };
+  std::vector<std::string> lines { };
+  for (std::string line { }; std::getline(stream, line);) {
+    lines.push_back(line);
+  }
+  if (lines.size() < 3 ||
+      lines.front() != "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" ||
+      lines[1].find("\"ph\":\"M\"") == std::string::npos ||
+      lines.back() != "]}") {
+    return false;
+  }
+
+  std::size_t event_count { 0 };
+  std::size_t check_count { 0 };
+  for (std::size_t i { 2 }; i + 1 < lines.size(); i++) {
+    const std::string& kLine { lines[i] };
+    if (kLine.find("\"ph\":\"X\"") == std::string::npos) {
+      return false;
+    }
+    event_count++;
+    if (kLine.find("\"name\":\"Check\"") == std::string::npos) {
+      continue;
+    }
+
+    const std::size_t kFrame { check_count / 2 };
+    const std::int64_t kHalf { GetCheckTotal(kFrame) / 2 };
+    const std::int64_t kStart {
+      GetCheckStart(kFrame) + (check_count % 2 == 0 ? 0 : kHalf)
+    };
+    if (std::abs(ParseTraceNumber(kLine, "\"ts\":") - kStart * 1e-3) >
+            1e-3 ||
+        std::abs(ParseTraceNumber(kLine, "\"dur\":") - kHalf * 1e-3) >
+            1e-3) {
+      return false;
+    }
+    check_count++;
+  }
+
+  return check_count == 2 * Profiler::kMaxZoneFrameCount &&
+         event_count == 3 * Profiler::kMaxZoneFrameCount;
+}
+
+// Статистика и трасса для участка с известным временем. Сначала 100 кадров
+// с участком по 1 с, затем окно из kMaxZoneFrameCount кадров по
+// GetCheckTotal, каждый из двух событий: первые кадры должны выйти из
+// окна, а min, avg и p99 -- совпасть с 1 мкс, средним и 99-м
+// процентилем чисел 1, ..., 4096 мкс. Измеряется GetStatistics.
+void BM_ProfilerStatistics(benchmark::State& state) {
+  constexpr std::size_t kWindow { Profiler::kMaxZoneFrameCount };
+  Profiler& profiler { Profiler::GetInstance() };
+  profiler.Reset();
+
+  for (std::size_t i { 0 }; i < 100; i++) {
+    profiler.BeginFrame();
+    profiler.RecordCpuEvent("Check", 0, 1000000000);
+    profiler.EndFrame();
+  }
+  profiler.EnableTrace();
+  for (std::size_t i { 0 }; i < kWindow; i++) {
+    const std::int64_t kStart { GetCheckStart(i) };
+    const std::int64_t kHalf { GetCheckTotal(i) / 2 };
+    profiler.BeginFrame();
+    profiler.RecordCpuEvent("Check", kStart, kStart + kHalf);
+    profiler.RecordCpuEvent("Check", kStart + kHalf, kStart + 2 * kHalf);
+    profiler.EndFrame();
+  }
+
+  const std::string kTracePath {
+    (std::filesystem::temp_directory_path() / "lab8_profiler_bench.json")
+        .string()
+  };
+  const bool kTraceValid {
+    profiler.WriteChromeTrace(kTracePath.c_str()) &&
+    CheckChromeTrace(kTracePath)
+  };
+
+  bool statistics_match { false };
+  for (const ZoneStatistics& zone : profiler.GetStatistics()) {
+    if (zone.name != "Check") {
+      continue;
+    }
+    // ближайший ранг 99-го процентиля: ceil(0.99 * 4096) = 4056
+    statistics_match = zone.cpu && zone.frame_count == kWindow &&
+            std::abs(zone.min_ms - 0.001) < 1e-9 &&
+            std::abs(zone.average_ms - (kWindow + 1) * 0.0005) < 1e-9 &&
+            std::abs(zone.p99_ms - 4.056) < 1e-9;
+  }
+  if (!statistics_match) {
+    profiler.Reset();
+    state.SkipWithError("Unexpected zone statistics");
+    return;
+  }
+  if (!kTraceValid) {
+    profiler.Reset();
+    state.SkipWithError("Unexpected Chrome trace");
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(profiler.GetStatistics().data());
+  }
+
+  profiler.Reset();
+  state.SetItemsProcessed(state.iterations() * kWindow);
+}
+BENCHMARK(BM_ProfilerStatistics)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -0,0 +1,219 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "shader_cache.hpp"
+
+#ifdef LAB8_HEADLESS
+#include "offscreen_context.hpp"
+#endif
+
+namespace {
+
+const std::filesystem::path kDirectory {
+  std::filesystem::temp_directory_path() / "lab8_shader_bench"
+};
+
+void WriteText(const std::filesystem::path& path, const std::string& text) {
+  std::ofstream file { path, std::ios::binary };
+  file << text;
+}
+
+// Фрагментный шейдер, включающий include_count файлов с функциями, и
+// вершинный шейдер к нему. variant добавляется в комментарий, чтобы
+// получить другой исходник, а значит и другой ключ кэша.
+void CreateShaderSet(std::size_t include_count, std::size_t variant = 0) {
+  std::filesystem::create_directories(kDirectory);
+
+  std::string root { "#version 330 core\n// variant " +
+                     std::to_string(variant) + "\n" };
+  std::string body { };
+  for (std::size_t i { 0 }; i < include_count; i++) {
+    const std::string kName { "function_" + std::to_string(i) };
+    WriteText(kDirectory / (kName + ".glsl"),
+              "// " + kName + "\n"
+              "float " + kName + "(float x) {\n"
+              "  float y = sin(x * " + std::to_string(i + 1) + ".0);\n"
+              "  for (int k = 0; k < 4; k++) {\n"
+              "    y = y * y + cos(y + float(k));\n"
+              "  }\n"
+              "  return y;\n"
+              "}\n");
+    root += "#include \"" + kName + ".glsl\"\n";
+    body += "  value = " + kName + "(value);\n";
+  }
+  WriteText(kDirectory / "shader.frag",
+            root +
+            "in vec2 vertex_texture;\n"
+            "out vec4 fragment_color;\n"
+            "void main() {\n"
+            "  float value = vertex_texture.x;\n" + body +
+            "  fragment_color = vec4(value);\n"
+            "}\n");
+  WriteText(kDirectory / "shader.vert",
+            "#version 330 core\n"
+            "layout (location = 0) in vec3 attribute_position;\n"
+            "layout (location = 1) in vec2 attribute_texture;\n"
+            "out vec2 vertex_texture;\n"
+            "void main() {\n"
+            "  gl_Position = vec4(attribute_position, 1.0);\n"
+            "  vertex_texture = attribute_texture;\n"
+            "}\n");
+}
+
+// Прежнее чтение шейдера через поток и копии строк.
+std::string ReadWithStream(const std::string& path) {
+  std::ifstream file { path };
+  std::stringstream stream { };
+  stream << file.rdbuf();
+  return stream.str();
+}
+
+std::string CreateLargeSource() {
+  std::string source { };
+  while (source.size() < (1 << 16)) {
+    source += "  value = value * value + sin(value);\n";
+  }
+  return source;
+}
+
+void BM_ReadShaderStream(benchmark::State& state) {
+  std::filesystem::create_directories(kDirectory);
+  const std::string kPath { (kDirectory / "large.glsl").string() };
+  WriteText(kPath, CreateLargeSource());
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReadWithStream(kPath).data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * (1 << 16));
+}
+BENCHMARK(BM_ReadShaderStream);
+
+void BM_ReadShaderFile(benchmark::State& state) {
+  std::filesystem::create_directories(kDirectory);
+  const std::string kPath { (kDirectory / "large.glsl").string() };
+  WriteText(kPath, CreateLargeSource());
+
+  std::string text { };
+  for (auto _ : state) {
+    ReadFile(kPath, text);
+    benchmark::DoNotOptimize(text.data());
+  }
+
+  if (text != ReadWithStream(kPath)) {
+    state.SkipWithError("Single-read contents differ from the stream");
+    return;
+  }
+  state.SetBytesProcessed(state.iterations() * (1 << 16));
+}
+BENCHMARK(BM_ReadShaderFile);
+
+// Раскрытие state.range(0) включений. Каждый файл должен попасть в текст
+// один раз и быть окружён директивами #line.
+void BM_PreprocessShader(benchmark::State& state) {
+  const std::size_t kIncludeCount { static_cast<std::size_t>(state.range(0)) };
+  CreateShaderSet(kIncludeCount);
+  const std::string kPath { (kDirectory / "shader.frag").string() };
+
+  std::string source { };
+  for (auto _ : state) {
+    PreprocessShader(kPath, source);
+    benchmark::DoNotOptimize(source.data());
+  }
+
+  std::size_t line_count { 0 };
+  for (std::size_t position { source.find("#line") };
+       position != std::string::npos;
+       position = source.find("#line", position + 1)) {
+    line_count++;
+  }
+  if (line_count != 2 * kIncludeCount ||
+      source.find("#include") != std::string::npos) {
+    state.SkipWithError("Includes were not expanded");
+    return;
+  }
+  state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_PreprocessShader)->Arg(16);
+
+void BM_HashBytes(benchmark::State& state) {
+  const std::string kSource { CreateLargeSource() };
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HashBytes(kSource.data(), kSource.size()));
+  }
+
+  state.SetBytesProcessed(state.iterations() * kSource.size());
+}
+BENCHMARK(BM_HashBytes);
+
+#ifdef LAB8_HEADLESS
+// Контекст без окна, общий для всех измерений.
+bool MakeContextCurrent() {
+  static OffscreenContext context { };
+  static const bool kCreated { context.Create() };
+  return kCreated;
+}
+
+// Создание программы из 16 включений: state.range(0) = 0 -- каждый раз
+// с новым исходником, то есть с компиляцией и компоновкой (кэш Mesa тоже
+// промахивается), 1 -- из двоичного представления в кэше.
+void BM_CreateProgram(benchmark::State& state) {
+  constexpr std::size_t kIncludeCount { 16 };
+  const bool kWarm { state.range(0) != 0 };
+  if (!MakeContextCurrent()) {
+    state.SkipWithError("Failed to create an offscreen context");
+    return;
+  }
+
+  const std::string kCacheDirectory { (kDirectory / "cache").string() };
+  std::filesystem::remove_all(kCacheDirectory);
+  ShaderCache cache { kCacheDirectory };
+  if (!cache.IsEnabled()) {
+    state.SkipWithError("Program binaries are not supported");
+    return;
+  }
+
+  const std::string kVertexPath { (kDirectory / "shader.vert").string() };
+  const std::string kFragmentPath { (kDirectory / "shader.frag").string() };
+  CreateShaderSet(kIncludeCount);
+  if (kWarm) {
+    glDeleteProgram(cache.CreateProgram(kVertexPath, kFragmentPath));
+  }
+
+  std::size_t variant { 0 };
+  bool created { true };
+  for (auto _ : state) {
+    if (!kWarm) {
+      state.PauseTiming();
+      CreateShaderSet(kIncludeCount, ++variant);
+      state.ResumeTiming();
+    }
+    const GLuint kProgram { cache.CreateProgram(kVertexPath, kFragmentPath) };
+    created = created && kProgram != 0;
+    glDeleteProgram(kProgram);
+  }
+
+  const std::size_t kExpectedHits {
+    kWarm ? static_cast<std::size_t>(state.iterations()) : 0
+  };
+  if (!created || cache.GetHitCount() != kExpectedHits) {
+    state.SkipWithError("Unexpected shader cache result");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateProgram)
+    ->ArgName("warm")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+#endif
+
+}  // namespace
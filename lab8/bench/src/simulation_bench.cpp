@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "instance_store.hpp"
+#include "simulation.hpp"
+#include "triple_buffer.hpp"
+
+namespace {
+
+bool IsEqual(const InstanceStore& a, const InstanceStore& b) {
+  return a.x_offsets == b.x_offsets && a.y_offsets == b.y_offsets &&
+         a.x_directions == b.x_directions &&
+         a.y_directions == b.y_directions && a.alphas == b.alphas &&
+         a.betas == b.betas && a.scales == b.scales;
+}
+
+// Стоимость публикации и получения значения в одном потоке.
+void BM_TripleBufferPublish(benchmark::State& state) {
+  TripleBuffer<std::int64_t> buffer { };
+  std::int64_t value { 0 };
+
+  for (auto _ : state) {
+    buffer.GetWriteBuffer() = value++;
+    buffer.Publish();
+    buffer.Update();
+    benchmark::DoNotOptimize(buffer.GetReadBuffer());
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TripleBufferPublish);
+
+// Задержка передачи между потоками: время от Publish до момента, когда
+// читатель видит значение. Писатель публикует метки времени без пауз.
+void BM_TripleBufferHandoff(benchmark::State& state) {
+  using Clock = std::chrono::steady_clock;
+
+  TripleBuffer<Clock::time_point> buffer { };
+  std::atomic<bool> stopping { false };
+
+  std::thread writer { [&buffer, &stopping] {
+    while (!stopping.load(std::memory_order_relaxed)) {
+      buffer.GetWriteBuffer() = Clock::now();
+      buffer.Publish();
+      std::this_thread::yield();
+    }
+  } };
+
+  double latency_sum { 0.0 };
+  for (auto _ : state) {
+    while (!buffer.Update()) {
+      std::this_thread::yield();
+    }
+    const std::chrono::duration<double, std::micro> kLatency {
+      Clock::now() - buffer.GetReadBuffer()
+    };
+    latency_sum += kLatency.count();
+  }
+
+  stopping = true;
+  writer.join();
+
+  state.counters["latency_us"] = latency_sum / state.iterations();
+}
+BENCHMARK(BM_TripleBufferHandoff)->UseRealTime();
+
+// Задержка от публикации снимка SimulationThread до его получения потоком
+// отрисовки для state.range(0) фигур при 1000 шагах в секунду. Одна
+// итерация ждёт один новый снимок.
+void BM_SimulationHandoff(benchmark::State& state) {
+  const std::size_t kCount { static_cast<std::size_t>(state.range(0)) };
+  SimulationThread simulation { CreateInstanceStore(kCount, 0), 1000.0 };
+  InstanceStore instances { };
+
+  double latency_sum { 0.0 };
+  for (auto _ : state) {
+    while (!simulation.Update()) {
+      std::this_thread::yield();
+    }
+    const auto kNow { std::chrono::steady_clock::now() };
+    const SimulationSnapshot& kSnapshot { simulation.GetSnapshot() };
+
+    const std::chrono::duration<double, std::micro> kLatency {
+      kNow - kSnapshot.publish_time
+    };
+    latency_sum += kLatency.count();
+
+    InterpolateInstances(kSnapshot.previous, kSnapshot.current,
+                         simulation.GetInterpolationFactor(kNow), instances);
+    benchmark::DoNotOptimize(instances.x_offsets.data());
+  }
+
+  simulation.Stop();
+
+  state.counters["latency_us"] = latency_sum / state.iterations();
+}
+BENCHMARK(BM_SimulationHandoff)->Arg(1000)->Arg(100000)->UseRealTime();
+
+// Проверка детерминированности: поток отрисовки с периодом кадра
+// state.range(0) мкс читает снимки моделирования с 1000 шагами в секунду
+// и каждый кадр задаёт поворот по сценарию, помечая его шагом на
+// kInputDelay после показанного снимка. Состояние последнего снимка после
+// шага последнего ввода должно совпасть с последовательными шагами
+// StepSimulation с теми же вводами.
+void BM_SimulationDeterminism(benchmark::State& state) {
+  constexpr std::size_t kCount { 1000 };
+  // запас на задержку ввода, чтобы он успел прийти до своего шага
+  constexpr std::uint64_t kInputDelay { 10 };
+  const std::chrono::microseconds kFramePeriod { state.range(0) };
+
+  std::vector<RotationInput> inputs { };
+  for (auto _ : state) {
+    SimulationThread simulation { CreateInstanceStore(kCount, 1), 1000.0 };
+    InstanceStore instances { };
+    inputs.clear();
+
+    for (int frame { 0 }; frame < 20; frame++) {
+      simulation.Update();
+      const SimulationSnapshot& kSnapshot { simulation.GetSnapshot() };
+      InterpolateInstances(
+          kSnapshot.previous, kSnapshot.current,
+          simulation.GetInterpolationFactor(std::chrono::steady_clock::now()),
+          instances);
+
+      const RotationInput kInput {
+        kSnapshot.tick + kInputDelay, 0.01f * (frame % 5 - 2),
+        0.02f * (frame % 3 - 1)
+      };
+      inputs.push_back(kInput);
+      simulation.SetRotation(kInput.tick, kInput.alpha_changing,
+                             kInput.beta_changing);
+      std::this_thread::sleep_for(kFramePeriod);
+    }
+
+    // все вводы сценария должны вступить в силу
+    while (simulation.GetSnapshot().tick < inputs.back().tick) {
+      std::this_thread::sleep_for(simulation.GetTickDuration());
+      simulation.Update();
+    }
+    simulation.Stop();
+    simulation.Update();
+    const SimulationSnapshot& kSnapshot { simulation.GetSnapshot() };
+
+    state.PauseTiming();
+    if (kSnapshot.late_input_count != 0) {
+      state.SkipWithError("Rotation input arrived after its tick");
+      break;
+    }
+
+    InstanceStore expected { CreateInstanceStore(kCount, 1) };
+    InstanceStore previous { };
+    RotationInput rotation { 0, 0.0f, 0.0f };
+    std::size_t next_input { 0 };
+    for (std::uint64_t tick { 1 }; tick <= kSnapshot.tick; tick++) {
+      while (next_input < inputs.size() && inputs[next_input].tick <= tick) {
+        rotation = inputs[next_input++];
+      }
+      previous = expected;
+      StepSimulation(expected, rotation.alpha_changing,
+                     rotation.beta_changing);
+    }
+    if (kSnapshot.tick == 0 || !IsEqual(kSnapshot.current, expected) ||
+        !IsEqual(kSnapshot.previous, previous)) {
+      state.SkipWithError("Simulation state depends on the frame rate");
+      break;
+    }
+    state.counters["ticks"] = static_cast<double>(kSnapshot.tick);
+    state.counters["inputs"] = static_cast<double>(next_input);
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_SimulationDeterminism)
+    ->Arg(250)
+    ->Arg(4000)
+    ->Arg(33000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <benchmark/benchmark.h>
+
+#include <stb/stb_image.h>
+
+#include "texture_compressor.hpp"
+#include "texture_container.hpp"
+#include "texture_decoder.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Пиковый объём резидентной памяти процесса в мегабайтах. Он не убывает,
+// поэтому для сравнения способов загрузки бенчмарки запускаются по одному:
+//   lab8_bench --benchmark_filter=BM_LoadTextureFrom
+double GetPeakRssMegabytes() {
+  rusage usage { };
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+// Декодирование, выполняемое CreateTexture перед загрузкой в OpenGL.
+void BM_DecodeTexture(benchmark::State& state) {
+  int width { 0 }, height { 0 }, channels { 0 };
+
+  for (auto _ : state) {
+    unsigned char* data = stbi_load(kTexturePath.c_str(), &width, &height,
+                                    &channels, 0);
+    if (!data) {
+      state.SkipWithError("Failed to load the texture");
+      break;
+    }
+    benchmark::DoNotOptimize(data);
+    stbi_image_free(data);
+  }
+
+  state.SetItemsProcessed(state.iterations() * width * height);
+  state.SetLabel(kTexturePath);
+}
+BENCHMARK(BM_DecodeTexture)->Unit(benchmark::kMillisecond);
+
+void BM_LoadImage(benchmark::State& state) {
+  Image image { };
+
+  for (auto _ : state) {
+    if (!LoadImage(kTexturePath.c_str(), image)) {
+      state.SkipWithError("Failed to load the texture");
+      break;
+    }
+    benchmark::DoNotOptimize(image.pixels.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * image.width * image.height);
+}
+BENCHMARK(BM_LoadImage)->Unit(benchmark::kMillisecond);
+
+// Уровни изображения 5x3 с двумя каналами: 5x3, 2x1 и 1x1, как у
+// glGenerateMipmap. Каждый пиксель уровня -- округлённое среднее квадрата
+// 2x2 предыдущего уровня; сторона длины 1 входит в квадрат дважды.
+bool CheckMipChain() {
+  constexpr int kSizes[][2] { { 5, 3 }, { 2, 1 }, { 1, 1 } };
+  // суммы квадратов дают все остатки от деления на 4, так что ошибка
+  // округления заметна
+  const Image kImage {
+    5, 3, 2, {
+      120, 155, 52, 202, 245, 79, 46, 34, 10, 205,
+      148, 30, 113, 184, 141, 88, 54, 134, 109, 13,
+      133, 139, 99, 84, 158, 148, 190, 44, 172, 198
+    }
+  };
+
+  const std::vector<Image> kLevels { CreateMipChain(kImage) };
+  if (kLevels.size() != 3 || kLevels[0].pixels != kImage.pixels) {
+    return false;
+  }
+  for (std::size_t level { 0 }; level < kLevels.size(); level++) {
+    const Image& kLevel { kLevels[level] };
+    if (kLevel.width != kSizes[level][0] ||
+        kLevel.height != kSizes[level][1] || kLevel.channels != 2 ||
+        kLevel.pixels.size() !=
+            static_cast<std::size_t>(kLevel.width) * kLevel.height * 2) {
+      return false;
+    }
+  }
+
+  for (std::size_t level { 1 }; level < kLevels.size(); level++) {
+    const Image& kSource { kLevels[level - 1] };
+    const Image& kLevel { kLevels[level] };
+    auto get_source = [&kSource](int x, int y, int c) -> unsigned int {
+      x = std::min(x, kSource.width - 1);
+      y = std::min(y, kSource.height - 1);
+      return kSource.pixels[(y * kSource.width + x) * 2 + c];
+    };
+
+    for (int y { 0 }; y < kLevel.height; y++) {
+      for (int x { 0 }; x < kLevel.width; x++) {
+        for (int c { 0 }; c < 2; c++) {
+          const unsigned int kSum {
+            get_source(2 * x, 2 * y, c) + get_source(2 * x + 1, 2 * y, c) +
+            get_source(2 * x, 2 * y + 1, c) +
+            get_source(2 * x + 1, 2 * y + 1, c)
+          };
+          if (kLevel.pixels[(y * kLevel.width + x) * 2 + c] !=
+              (kSum + 2) / 4) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Построение уровней детализации на CPU вместо glGenerateMipmap. Сначала
+// проверяются уровни маленького изображения нечётного размера.
+void BM_CreateMipChain(benchmark::State& state) {
+  if (!CheckMipChain()) {
+    state.SkipWithError("Mip levels do not match 2x2 averages");
+    return;
+  }
+
+  Image image { };
+  if (!LoadImage(kTexturePath.c_str(), image)) {
+    state.SkipWithError("Failed to load the texture");
+    return;
+  }
+
+  for (auto _ : state) {
+    std::vector<Image> levels { CreateMipChain(image) };
+    benchmark::DoNotOptimize(levels.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * image.width * image.height);
+}
+BENCHMARK(BM_CreateMipChain)->Unit(benchmark::kMillisecond);
+
+// Декодирование 16 текстур пулом из state.range(0) потоков. Перед
+// измерением уровни одной текстуры сравниваются с LoadImage и
+// CreateMipChain в вызывающем потоке.
+void BM_TextureDecoder(benchmark::State& state) {
+  constexpr int kTextureCount { 16 };
+  TextureDecoder decoder { static_cast<unsigned int>(state.range(0)) };
+
+  Image image { };
+  if (!LoadImage(kTexturePath.c_str(), image)) {
+    state.SkipWithError("Failed to load the texture");
+    return;
+  }
+  const std::vector<Image> kExpected { CreateMipChain(std::move(image)) };
+  DecodedTexture decoded { };
+  decoder.Submit(0, kTexturePath);
+  if (!decoder.Pop(decoded) || !decoded.loaded ||
+      decoded.levels.size() != kExpected.size() ||
+      !std::equal(decoded.levels.begin(), decoded.levels.end(),
+                  kExpected.begin(),
+                  [](const Image& decoded_level, const Image& level) {
+                    return decoded_level.width == level.width &&
+                           decoded_level.height == level.height &&
+                           decoded_level.pixels == level.pixels;
+                  })) {
+    state.SkipWithError("Decoded levels differ from CreateMipChain");
+    return;
+  }
+
+  for (auto _ : state) {
+    for (int i { 0 }; i < kTextureCount; i++) {
+      decoder.Submit(i, kTexturePath);
+    }
+
+    DecodedTexture texture { };
+    while (decoder.Pop(texture)) {
+      if (!texture.loaded) {
+        state.SkipWithError("Failed to load the texture");
+      }
+      benchmark::DoNotOptimize(texture.levels.data());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kTextureCount);
+}
+BENCHMARK(BM_TextureDecoder)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Подготовка всех уровней детализации к загрузке в OpenGL из исходного
+// изображения: декодирование и уменьшение.
+void BM_LoadTextureFromImage(benchmark::State& state) {
+  for (auto _ : state) {
+    Image image { };
+    if (!LoadImage(kTexturePath.c_str(), image)) {
+      state.SkipWithError("Failed to load the texture");
+      break;
+    }
+    std::vector<Image> levels { CreateMipChain(std::move(image)) };
+    benchmark::DoNotOptimize(levels.data());
+  }
+
+  state.counters["peak_rss_mb"] = GetPeakRssMegabytes();
+}
+BENCHMARK(BM_LoadTextureFromImage)->Unit(benchmark::kMillisecond);
+
+// То же из контейнера, подготовленного lab8_bake. Каждая страница уровней
+// читается, чтобы учесть стоимость их подкачки.
+void BM_LoadTextureFromContainer(benchmark::State& state) {
+  for (auto _ : state) {
+    MappedTextureContainer container { };
+    if (!container.OpenForImage(kTexturePath)) {
+      state.SkipWithError("Failed to open the texture container "
+                          "(build the lab8_bake_data target)");
+      break;
+    }
+
+    unsigned int checksum { 0 };
+    for (std::size_t i { 0 }; i < container.GetLevelCount(); i++) {
+      const ImageView kLevel { container.GetLevel(i) };
+      const std::size_t kSize {
+        static_cast<std::size_t>(kLevel.width) * kLevel.height *
+        kLevel.channels
+      };
+      for (std::size_t k { 0 }; k < kSize; k += 4096) {
+        checksum += kLevel.pixels[k];
+      }
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+
+  state.counters["peak_rss_mb"] = GetPeakRssMegabytes();
+}
+BENCHMARK(BM_LoadTextureFromContainer)->Unit(benchmark::kMillisecond);
+
+// Сжатие текстуры в BC1: state.range(0) -- CompressionQuality,
+// state.range(1) -- число потоков. Счётчик psnr -- качество нулевого
+// уровня после распаковки, mpix_per_s -- пропускная способность.
+void BM_CompressBc1(benchmark::State& state) {
+  const CompressionQuality kQuality {
+    static_cast<CompressionQuality>(state.range(0))
+  };
+  const unsigned int kThreadCount {
+    static_cast<unsigned int>(state.range(1))
+  };
+
+  Image image { };
+  if (!LoadImage(kTexturePath.c_str(), image)) {
+    state.SkipWithError("Failed to load the texture");
+    return;
+  }
+  const ImageView kImage {
+    image.width, image.height, image.channels, image.pixels.data()
+  };
+
+  std::vector<unsigned char> blocks { };
+  for (auto _ : state) {
+    blocks = CompressBc1(kImage, kQuality, kThreadCount);
+    benchmark::DoNotOptimize(blocks.data());
+  }
+
+  const Image kDecompressed {
+    DecompressBc1(blocks.data(), image.width, image.height)
+  };
+  state.counters["psnr"] = ComputePsnr(kImage, ImageView {
+    kDecompressed.width, kDecompressed.height, kDecompressed.channels,
+    kDecompressed.pixels.data()
+  });
+  state.counters["mpix_per_s"] = benchmark::Counter(
+      1e-6 * image.width * image.height * state.iterations(),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_CompressBc1)
+    ->ArgsProduct({
+      { static_cast<int>(CompressionQuality::kFast),
+        static_cast<int>(CompressionQuality::kNormal),
+        static_cast<int>(CompressionQuality::kHigh) },
+      { 1, 4 }
+    })
+    ->ArgNames({ "quality", "threads" })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Распаковывает два блока 4x4 с концами first и second (RGB565) и
+// индексами 0, 1, 2, 3 в каждой строке и сравнивает результат с palette.
+bool CheckBc1Palette(std::uint16_t first, std::uint16_t second,
+                     const unsigned char palette[4][3]) {
+  const unsigned char kBlock[kBc1BlockSize] {
+    static_cast<unsigned char>(first), static_cast<unsigned char>(first >> 8),
+    static_cast<unsigned char>(second),
+    static_cast<unsigned char>(second >> 8), 0xE4, 0xE4, 0xE4, 0xE4
+  };
+  const Image kImage { DecompressBc1(kBlock, 4, 4) };
+
+  for (int i { 0 }; i < 16; i++) {
+    for (int c { 0 }; c < 3; c++) {
+      if (kImage.pixels[3 * i + c] != palette[i % 4][c]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Одноцветный блок должен сжиматься в четырёхцветный без потерь: при
+// совпавших концах трёхцветный режим сделал бы один из цветов чёрным.
+bool CheckFlatBc1Block(unsigned char red, unsigned char green,
+                       unsigned char blue) {
+  std::vector<unsigned char> pixels { };
+  for (int i { 0 }; i < 16; i++) {
+    pixels.insert(pixels.end(), { red, green, blue });
+  }
+  const std::vector<unsigned char> kBlock {
+    CompressBc1(ImageView { 4, 4, 3, pixels.data() },
+                CompressionQuality::kHigh, 1)
+  };
+  const std::uint16_t kColor0 {
+    static_cast<std::uint16_t>(kBlock[0] | kBlock[1] << 8)
+  };
+  const std::uint16_t kColor1 {
+    static_cast<std::uint16_t>(kBlock[2] | kBlock[3] << 8)
+  };
+
+  return kColor0 > kColor1 &&
+         DecompressBc1(kBlock.data(), 4, 4).pixels == pixels;
+}
+
+// Распаковка сжатой текстуры, которой CreateBc1Texture заменяет
+// GL_EXT_texture_compression_s3tc. Сначала проверяются палитры обоих
+// режимов BC1 и сжатие одноцветных блоков.
+void BM_DecompressBc1(benchmark::State& state) {
+  // красный > синий: (2 * c0 + c1) / 3 и (c0 + 2 * c1) / 3
+  constexpr unsigned char kFourColors[4][3] {
+    { 255, 0, 0 }, { 0, 0, 255 }, { 170, 0, 85 }, { 85, 0, 170 }
+  };
+  // синий < красный: середина и чёрный
+  constexpr unsigned char kThreeColors[4][3] {
+    { 0, 0, 255 }, { 255, 0, 0 }, { 127, 0, 127 }, { 0, 0, 0 }
+  };
+  if (!CheckBc1Palette(0xF800, 0x001F, kFourColors) ||
+      !CheckBc1Palette(0x001F, 0xF800, kThreeColors)) {
+    state.SkipWithError("BC1 palette does not match the specification");
+    return;
+  }
+  if (!CheckFlatBc1Block(0, 0, 0) || !CheckFlatBc1Block(255, 255, 255) ||
+      !CheckFlatBc1Block(8, 4, 0)) {
+    state.SkipWithError("Flat block is not encoded as a four-colour block");
+    return;
+  }
+
+  Image image { };
+  if (!LoadImage(kTexturePath.c_str(), image)) {
+    state.SkipWithError("Failed to load the texture");
+    return;
+  }
+  const std::vector<unsigned char> kBlocks {
+    CompressBc1(ImageView {
+                  image.width, image.height, image.channels,
+                  image.pixels.data()
+                },
+                CompressionQuality::kFast)
+  };
+
+  for (auto _ : state) {
+    Image decompressed {
+      DecompressBc1(kBlocks.data(), image.width, image.height)
+    };
+    benchmark::DoNotOptimize(decompressed.pixels.data());
+  }
+
+  state.counters["mpix_per_s"] = benchmark::Counter(
+      1e-6 * image.width * image.height * state.iterations(),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_DecompressBc1)->Unit(benchmark::kMillisecond);
+
+}  // namespace
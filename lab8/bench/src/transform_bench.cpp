@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+
+#include <glm/matrix.hpp>
+
+#include "utils.hpp"
+
+namespace {
+
+// Покадровое построение матрицы преобразования в цикле отрисовки main.cpp.
+void BM_CreateTransform(benchmark::State& state) {
+  float alpha { 0 };
+  float beta { 0 };
+  float x_offset { 0 };
+  float y_offset { 0 };
+  int x_direction { 1 };
+  int y_direction { 1 };
+
+  for (auto _ : state) {
+    alpha += kAlphaChanging;
+    beta += kBetaChanging;
+    UpdatePosition(x_offset, y_offset, x_direction, y_direction);
+
+    glm::mat4 transform { CreateTransform(x_offset, y_offset, alpha, beta) };
+    benchmark::DoNotOptimize(transform);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateTransform);
+
+}  // namespace
@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "mesh_generator.hpp"
+#include "utils.hpp"
+#include "vertex_format.hpp"
+
+namespace {
+
+// Допустимая погрешность кодирования -- половина шага кодировки для
+// значений из [-1; 1], в котором лежат все координаты цилиндра и сферы:
+// у float и half шаг на [0.5; 1) равен 2^-24 и 2^-11, у snorm16 --
+// 1 / 32767. Небольшой запас покрывает округление при декодировании.
+const double kFloatTolerance { std::ldexp(1.0, -25) };
+const double kHalfTolerance { std::ldexp(1.0, -12) };
+const double kSnorm16Tolerance { 0.5 / 32767.0 + 1e-12 };
+
+// Размер вершины исходных данных (5 double), загружавшихся как GL_DOUBLE.
+constexpr std::size_t kDoubleVertexSize { 5 * sizeof(double) };
+
+enum class Mesh {
+  kCylinder,
+  kSphere,
+};
+
+std::vector<double> CreateCoordinates(Mesh mesh) {
+  if (mesh == Mesh::kCylinder) {
+    return CreateCylinderCoordinates(kCylinderSectorCount, kCylinderRadius,
+                                     kCylinderHeight);
+  }
+
+  constexpr unsigned int kSectorCount { 64 };
+  constexpr unsigned int kStackCount { 32 };
+  std::vector<double> coordinates(
+      GetSphereMeshSize(kSectorCount, kStackCount).coordinate_count);
+  GenerateSphereCoordinates(kSectorCount, kStackCount, 0.5,
+                            coordinates.data(), coordinates.size());
+  return coordinates;
+}
+
+// Кодирование сетки state.range(0) (Mesh) в формат Format. Проверяется,
+// что вершина занимает vertex_size байтов, а погрешность позиционных и
+// текстурных координат не превышает tolerance.
+template <typename Format>
+void EncodeVertices(benchmark::State& state, std::size_t vertex_size,
+                    double tolerance) {
+  const std::vector<double> kCoordinates {
+    CreateCoordinates(static_cast<Mesh>(state.range(0)))
+  };
+  const std::size_t kVertexCount {
+    kCoordinates.size() / kVertexCoordinateCount
+  };
+
+  std::vector<typename Format::Vertex> vertices(kVertexCount);
+  for (auto _ : state) {
+    Format::Encode(kCoordinates.data(), kVertexCount, vertices.data());
+    benchmark::DoNotOptimize(vertices.data());
+  }
+
+  const std::size_t kByteCount {
+    vertices.size() * sizeof(typename Format::Vertex)
+  };
+  if (kByteCount != kVertexCount * vertex_size) {
+    state.SkipWithError("Unexpected vertex size");
+    return;
+  }
+
+  const typename Format::EncodingError kError {
+    Format::MeasureError(kCoordinates, vertices)
+  };
+  if (kError.position > tolerance || kError.texture > tolerance) {
+    state.SkipWithError("Encoding error exceeds the tolerance");
+    return;
+  }
+
+  state.counters["position_error"] = kError.position;
+  state.counters["texture_error"] = kError.texture;
+  state.counters["size_ratio"] =
+      static_cast<double>(vertex_size) / kDoubleVertexSize;
+  state.SetItemsProcessed(state.iterations() * kVertexCount);
+  state.SetBytesProcessed(state.iterations() * kByteCount);
+}
+
+void MeshArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("sphere")->Arg(0)->Arg(1);
+}
+
+void BM_EncodeFloatVertices(benchmark::State& state) {
+  EncodeVertices<FloatVertexFormat>(state, 20, kFloatTolerance);
+}
+BENCHMARK(BM_EncodeFloatVertices)->Apply(MeshArgs);
+
+void BM_EncodeHalfVertices(benchmark::State& state) {
+  EncodeVertices<HalfVertexFormat>(state, 12, kHalfTolerance);
+}
+BENCHMARK(BM_EncodeHalfVertices)->Apply(MeshArgs);
+
+void BM_EncodeSnorm16Vertices(benchmark::State& state) {
+  EncodeVertices<Snorm16VertexFormat>(state, 12, kSnorm16Tolerance);
+}
+BENCHMARK(BM_EncodeSnorm16Vertices)->Apply(MeshArgs);
+
+}  // namespace
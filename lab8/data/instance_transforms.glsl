@@ -0,0 +1,6 @@
+// Матрицы экземпляров текущей порции. Размер массива соответствует
+// kMaxInstancesPerDraw: 16 КБ -- наименьший размер блока, который обязана
+// поддерживать любая реализация.
+layout (std140) uniform InstanceTransforms {
+   mat4 transforms[256];
+};
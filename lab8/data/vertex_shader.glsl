@@ -2,13 +2,15 @@
 
 layout (location = 0) in vec3 attribute_position;
 layout (location = 1) in vec2 attribute_texture;
+// номер экземпляра с учётом base_instance команды отрисовки (см. MeshArena)
+layout (location = 2) in uint attribute_instance;
 
-out vec2 vertex_texture;
+#include "instance_transforms.glsl"
 
-uniform mat4 transform;
+out vec2 vertex_texture;
 
 void main() {
-   gl_Position = transform * vec4(attribute_position, 1.0);
+   gl_Position =
+       transforms[attribute_instance] * vec4(attribute_position, 1.0);
    vertex_texture = attribute_texture;
 }
-
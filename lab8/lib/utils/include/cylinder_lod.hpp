@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Цепочка чисел секторов от max_sector_count, каждое следующее вдвое меньше
+// предыдущего (с округлением вверх), пока не станет меньше
+// min_sector_count.
+std::vector<unsigned int> CreateLodSectorCounts(
+    unsigned int max_sector_count, unsigned int min_sector_count = 4);
+
+// Выбор уровня детализации цилиндра радиуса radius по погрешности его
+// силуэта на экране. Многоугольник из n секторов отклоняется от окружности
+// не больше чем на radius * (1 - cos(pi / n)); это отклонение переводится
+// в пиксели по матрице преобразования экземпляра и размеру области вывода.
+//
+// Уровни упорядочены от самого подробного (0) к самому грубому. Выбирается
+// самый грубый уровень с погрешностью не больше max_error пикселей, но на
+// более грубый уровень фигура переходит, только если его погрешность не
+// превышает max_error * hysteresis: иначе фигура, размер которой колеблется
+// около порога, переключалась бы каждый кадр.
+class CylinderLod {
+ public:
+  CylinderLod(std::vector<unsigned int> sector_counts, float radius,
+              float max_error, float hysteresis = 0.75f);
+
+  std::size_t GetLevelCount() const;
+  unsigned int GetSectorCount(std::size_t level) const;
+
+  // Наибольшая длина в пикселях, в которую матрица transform (в порядке
+  // хранения glm) переводит отрезок длины radius в плоскости сечения
+  // цилиндра, для области вывода width x height.
+  float GetProjectedRadius(const float* transform, float width,
+                           float height) const;
+  // Погрешность силуэта уровня level в пикселях.
+  float GetError(std::size_t level, float projected_radius) const;
+
+  std::size_t SelectLevel(float projected_radius,
+                          std::size_t current_level) const;
+
+  // Обновляет levels (уровни прошлого кадра; новые экземпляры начинают с
+  // самого подробного) для count матриц подряд.
+  void SelectLevels(const float* transforms, std::size_t count, float width,
+                    float height, std::vector<unsigned char>& levels) const;
+  // То же для count матриц подряд, i-я из которых принадлежит экземпляру
+  // indices[i], например видимых после отсечения. levels хранит уровни
+  // всех экземпляров и должен вмещать каждый номер из indices.
+  void SelectLevels(const float* transforms, const std::uint32_t* indices,
+                    std::size_t count, float width, float height,
+                    std::vector<unsigned char>& levels) const;
+
+ private:
+  std::vector<unsigned int> sector_counts_;
+  // погрешность каждого уровня на единицу радиуса на экране
+  std::vector<float> relative_errors_;
+  float radius_;
+  float max_error_;
+  float hysteresis_;
+};
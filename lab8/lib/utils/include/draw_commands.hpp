@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Команда glMultiDrawElementsIndirect; порядок полей задан OpenGL.
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// Подряд идущие команды с одним типом примитивов: их можно нарисовать
+// одним вызовом.
+struct DrawCommandRun {
+  GLenum mode;
+  std::size_t first;
+  std::size_t count;
+};
+
+// Собирает команды кадра. Команда той же сетки, экземпляры которой
+// продолжают экземпляры предыдущей команды, сливается с ней.
+class DrawCommandBuilder {
+ public:
+  void Clear();
+  void Add(GLenum mode, const DrawElementsIndirectCommand& command);
+
+  const std::vector<DrawElementsIndirectCommand>& GetCommands() const;
+  const std::vector<DrawCommandRun>& GetRuns() const;
+
+ private:
+  std::vector<DrawElementsIndirectCommand> commands_;
+  std::vector<DrawCommandRun> runs_;
+};
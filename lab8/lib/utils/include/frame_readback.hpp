@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "utils.hpp"
+
+// Кадровый буфер для отрисовки без окна и асинхронное чтение его кадров.
+// Queue ставит копирование кадра в один из буферов пикселей (PBO) кольца
+// и сразу возвращается; Pop забирает самый старый кадр, когда GPU его
+// скопирует. Пока в кольце есть свободные буферы, чтение перекрывается с
+// отрисовкой следующих кадров.
+//
+// Все методы вызываются из потока с текущим контекстом OpenGL.
+class FrameReadback {
+ public:
+  FrameReadback(GLsizei width, GLsizei height, std::size_t ring_size = 3);
+  ~FrameReadback();
+
+  FrameReadback(const FrameReadback&) = delete;
+  FrameReadback& operator=(const FrameReadback&) = delete;
+
+  // false, если кадровый буфер неполон.
+  bool IsComplete() const;
+
+  // Делает кадровый буфер целью отрисовки.
+  void Bind() const;
+
+  // Ставит в очередь чтение кадра с номером frame. Кольцо не должно быть
+  // заполнено (см. IsFull).
+  void Queue(std::uint64_t frame);
+  bool IsFull() const;
+  std::size_t GetPendingCount() const;
+
+  // Забирает самый старый прочитанный кадр (RGBA, строки сверху вниз).
+  // Если его копирование ещё не закончено, ждёт, а время ожидания
+  // добавляется к GetStallTime. Возвращает false, если очередь пуста или
+  // буфер кадра не удалось отобразить в память.
+  bool Pop(Image& image, std::uint64_t& frame);
+
+  std::chrono::nanoseconds GetStallTime() const;
+
+ private:
+  struct Slot {
+    GLuint buffer;
+    GLsync fence;
+    std::uint64_t frame;
+  };
+
+  GLsizei width_;
+  GLsizei height_;
+  GLuint framebuffer_;
+  GLuint color_buffer_;
+  GLuint depth_buffer_;
+
+  std::vector<Slot> slots_;
+  // самый старый непрочитанный кадр и число кадров в кольце
+  std::size_t first_;
+  std::size_t pending_count_;
+
+  std::chrono::nanoseconds stall_time_;
+};
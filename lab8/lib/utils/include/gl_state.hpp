@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Функции OpenGL, через которые работают GlStateCache и UniformRing.
+// Таблицу можно заменить подставной, чтобы считать вызовы без контекста.
+struct GlDispatch {
+  PFNGLUSEPROGRAMPROC use_program;
+  PFNGLBINDVERTEXARRAYPROC bind_vertex_array;
+  PFNGLACTIVETEXTUREPROC active_texture;
+  PFNGLBINDTEXTUREPROC bind_texture;
+  PFNGLBINDBUFFERPROC bind_buffer;
+  PFNGLBINDBUFFERRANGEPROC bind_buffer_range;
+  PFNGLGENBUFFERSPROC gen_buffers;
+  PFNGLDELETEBUFFERSPROC delete_buffers;
+  PFNGLBUFFERDATAPROC buffer_data;
+  // nullptr, если OpenGL 4.4 недоступен
+  PFNGLBUFFERSTORAGEPROC buffer_storage;
+  PFNGLMAPBUFFERRANGEPROC map_buffer_range;
+  PFNGLUNMAPBUFFERPROC unmap_buffer;
+  PFNGLFENCESYNCPROC fence_sync;
+  PFNGLCLIENTWAITSYNCPROC client_wait_sync;
+  PFNGLDELETESYNCPROC delete_sync;
+  PFNGLGETINTEGERVPROC get_integerv;
+};
+
+// Таблица функций загруженного glad контекста.
+GlDispatch LoadGlDispatch();
+
+// Отслеживает привязки программы, массива вершин, текстур и буферов и
+// пропускает вызовы, не меняющие состояние. Изначально состояние
+// считается неизвестным, поэтому первая привязка выполняется всегда.
+//
+// Привязка GL_ELEMENT_ARRAY_BUFFER хранится в массиве вершин и забывается
+// при смене массива. Если состояние меняется в обход кэша (например,
+// CreateTexture привязывает новую текстуру), нужно вызвать Invalidate.
+class GlStateCache {
+ public:
+  explicit GlStateCache(const GlDispatch& dispatch);
+
+  void UseProgram(GLuint program);
+  void BindVertexArray(GLuint vertex_array);
+  void BindTexture(GLuint unit, GLenum target, GLuint texture);
+  void BindBuffer(GLenum target, GLuint buffer);
+  void BindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                       GLintptr offset, GLsizeiptr size);
+
+  // Забывает всё состояние.
+  void Invalidate();
+  // Забывает привязки удаляемого буфера: OpenGL отвязывает его сам.
+  void ForgetBuffer(GLuint buffer);
+
+  const GlDispatch& GetDispatch() const;
+
+  // Число запрошенных привязок и число пропущенных из них.
+  std::size_t GetRequestCount() const;
+  std::size_t GetElidedCount() const;
+
+ private:
+  struct BufferBinding {
+    GLenum target;
+    GLuint buffer;
+  };
+
+  struct IndexedBinding {
+    GLenum target;
+    GLuint index;
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+
+  struct TextureBinding {
+    GLenum target;
+    GLuint texture;
+  };
+
+  bool Elide(bool unchanged);
+
+  GlDispatch dispatch_;
+
+  GLuint program_;
+  GLuint vertex_array_;
+  GLuint active_unit_;
+  std::vector<TextureBinding> textures_;
+  std::vector<BufferBinding> buffers_;
+  std::vector<IndexedBinding> indexed_buffers_;
+
+  std::size_t request_count_;
+  std::size_t elided_count_;
+};
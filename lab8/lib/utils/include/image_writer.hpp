@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+// Кодирует изображение с 1-4 каналами в PNG. Строки фильтруются
+// разностью с левым соседом, compression_level передаётся zlib (1 --
+// быстрее всего, 9 -- сильнее всего).
+std::vector<unsigned char> EncodePng(const ImageView& image,
+                                     int compression_level = 1);
+
+// Записывает изображение в PNG или в двоичный PPM (альфа-канал
+// отбрасывается) в зависимости от расширения path; файлы с другими
+// расширениями записываются в PPM.
+bool WriteImage(const std::string& path, const ImageView& image);
+
+// Путь кадра index последовательности: первая группа символов '#' в
+// pattern заменяется номером, дополненным нулями до её длины. Если '#' в
+// pattern нет, номер добавляется перед расширением.
+std::string GetSequencePath(const std::string& pattern, std::size_t index);
+
+// Пул потоков, кодирующих и записывающих изображения. Очередь ограничена:
+// если кодирование не успевает, Submit ждёт, а не накапливает кадры.
+class ImageWriter {
+ public:
+  // thread_count, равное 0, означает число аппаратных потоков без одного
+  // (но не меньше одного).
+  explicit ImageWriter(unsigned int thread_count = 0,
+                       std::size_t queue_capacity = 8);
+  // Дописывает все отправленные изображения.
+  ~ImageWriter();
+
+  ImageWriter(const ImageWriter&) = delete;
+  ImageWriter& operator=(const ImageWriter&) = delete;
+
+  void Submit(std::string path, Image image);
+  // Ждёт, пока все отправленные изображения будут записаны.
+  void Wait();
+
+  // Число изображений, которые не удалось записать.
+  std::size_t GetFailureCount() const;
+  unsigned int GetThreadCount() const;
+
+ private:
+  struct Request {
+    std::string path;
+    Image image;
+  };
+
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::size_t queue_capacity_;
+
+  std::mutex mutex_;
+  std::condition_variable request_condition_;
+  std::condition_variable space_condition_;
+  std::condition_variable done_condition_;
+  std::deque<Request> requests_;
+  // число отправленных, но ещё не записанных изображений
+  std::size_t pending_;
+  bool stopping_;
+
+  std::atomic<std::size_t> failure_count_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Индексный буфер, готовый к загрузке в GL_ELEMENT_ARRAY_BUFFER и к вызову
+// glDrawElements(mode, count, type, 0).
+struct IndexBuffer {
+  // GL_TRIANGLES или GL_TRIANGLE_STRIP
+  GLenum mode;
+  // GL_UNSIGNED_SHORT или GL_UNSIGNED_INT
+  GLenum type;
+  // число индексов, включая индексы перезапуска примитива
+  GLsizei count;
+  // индекс перезапуска примитива; используется только для полос
+  unsigned int restart_index;
+  std::vector<unsigned char> data;
+
+  unsigned int GetIndex(std::size_t i) const;
+};
+
+struct IndexBufferOptions {
+  // переупорядочивать треугольники для кэша преобразованных вершин
+  bool optimize_vertex_cache { true };
+  // собирать треугольники в полосы, разделённые перезапуском примитива
+  bool use_triangle_strips { false };
+  // Сохранять порядок обхода вершин каждого треугольника в полосах. Без
+  // этого полосы длиннее, но их можно использовать, только если отсечение
+  // нелицевых граней выключено.
+  bool preserve_winding { true };
+};
+
+// Переупорядочивает треугольники списка так, чтобы вершины чаще оказывались
+// в кэше преобразованных вершин (алгоритм Форсайта).
+std::vector<unsigned int> OptimizeVertexCache(
+    const std::vector<unsigned int>& indices, std::size_t vertex_count);
+
+// Собирает список треугольников в полосы, разделённые restart_index.
+std::vector<unsigned int> CreateTriangleStrips(
+    const std::vector<unsigned int>& indices, std::size_t vertex_count,
+    unsigned int restart_index, bool preserve_winding);
+
+// Строит индексный буфер из списка треугольников. Индексы хранятся в
+// 16 битах, если все вершины (и индекс перезапуска) в них умещаются.
+IndexBuffer CreateIndexBuffer(const std::vector<unsigned int>& indices,
+                              std::size_t vertex_count,
+                              const IndexBufferOptions& options);
+
+// Эффективность кэша преобразованных вершин: ACMR -- среднее число промахов
+// на треугольник, ATVR -- отношение числа промахов к числу вершин (в лучшем
+// случае 1).
+struct VertexCacheStatistics {
+  double acmr;
+  double atvr;
+};
+
+// Моделирует FIFO-кэш из cache_size вершин.
+VertexCacheStatistics AnalyzeVertexCache(const IndexBuffer& buffer,
+                                         std::size_t vertex_count,
+                                         unsigned int cache_size = 32);
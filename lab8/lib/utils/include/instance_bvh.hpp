@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ограничивающие параллелепипеды экземпляров, выровненные по осям, в виде
+// структуры массивов.
+struct InstanceBounds {
+  std::vector<float> min_x;
+  std::vector<float> min_y;
+  std::vector<float> min_z;
+  std::vector<float> max_x;
+  std::vector<float> max_y;
+  std::vector<float> max_z;
+
+  std::size_t GetCount() const;
+  void Resize(std::size_t count);
+};
+
+// Записывает в bounds параллелепипеды цилиндров радиуса radius и высоты
+// 2 * half_height (ось -- локальная ось z, см. CreateCylinderCoordinates),
+// преобразованных матрицами transforms (по 16 чисел в порядке хранения glm).
+void ComputeCylinderBounds(const float* transforms, std::size_t count,
+                           float radius, float half_height,
+                           InstanceBounds& bounds);
+// То же для count матриц, начиная с экземпляра first; bounds уже должен
+// вмещать их.
+void ComputeCylinderBounds(const float* transforms, std::size_t first,
+                           std::size_t count, float radius,
+                           float half_height, InstanceBounds& bounds);
+
+// Шесть плоскостей пирамиды видимости: точка p видима, если
+// a * x + b * y + c * z + d >= 0 для каждой плоскости (a, b, c, d).
+struct Frustum {
+  float planes[6][4];
+};
+
+// Извлекает плоскости из матрицы проекции (в порядке хранения glm) по
+// методу Грибба -- Хартманна: плоскости отсечения -w <= x, y, z <= w
+// переводятся в систему координат, к которой применяется матрица.
+Frustum ExtractFrustumPlanes(const float* matrix);
+
+// Видим ли параллелепипед: не лежит ли он целиком вне одной из плоскостей.
+// Параллелепипед вне пирамиды, но не вне отдельных плоскостей, считается
+// видимым.
+bool IsBoxVisible(const Frustum& frustum, const float* min,
+                  const float* max);
+
+// Иерархия ограничивающих объёмов с четырьмя потомками в узле. Границы
+// потомков узла хранятся структурой массивов, так что все четыре
+// проверяются с плоскостью одной векторной операцией SSE.
+//
+// Build строит иерархию делением по медиане центров вдоль самой длинной
+// оси. Refit пересчитывает границы узлов при той же структуре, что быстрее
+// построения, но при движении экземпляров узлы разрастаются; GetCost
+// позволяет решить, когда перестроить иерархию.
+class InstanceBvh {
+ public:
+  InstanceBvh();
+
+  void Build(const InstanceBounds& bounds);
+  void Refit(const InstanceBounds& bounds);
+
+  // Записывает в visible номера экземпляров, видимых по IsBoxVisible, в
+  // порядке обхода иерархии.
+  void Cull(const Frustum& frustum, const InstanceBounds& bounds,
+            std::vector<std::uint32_t>& visible) const;
+
+  // Сумма площадей поверхностей потомков всех узлов, отнесённая к площади
+  // корня: оценка числа проверок при обходе.
+  float GetCost() const;
+  std::size_t GetNodeCount() const;
+  std::size_t GetInstanceCount() const;
+
+ private:
+  // в листе не больше kLeafSize экземпляров
+  static constexpr std::uint32_t kLeafSize { 1 };
+  static constexpr std::uint32_t kLeaf { ~std::uint32_t { 0 } };
+
+  struct alignas(16) Node {
+    // наименьшие x, y, z, затем наибольшие x, y, z потомков
+    float bounds[6][4];
+    // номер узла-потомка или kLeaf
+    std::uint32_t children[4];
+    // Экземпляры потомка занимают в order_ подряд count элементов, начиная
+    // с first, поэтому видимое целиком поддерево не нужно обходить.
+    std::uint32_t firsts[4];
+    std::uint32_t counts[4];
+    std::uint32_t child_count;
+  };
+
+  // Проверяет потомков узла с плоскостями: бит i в visible_mask -- i-й
+  // потомок не лежит вне ни одной плоскости, в inside_mask -- лежит внутри
+  // всех плоскостей.
+  static void TestChildren(const Node& node, const Frustum& frustum,
+                           int& visible_mask, int& inside_mask);
+
+  std::uint32_t BuildNode(const InstanceBounds& bounds, std::uint32_t first,
+                          std::uint32_t count);
+  void UpdateCost();
+
+  std::vector<Node> nodes_;
+  // номера экземпляров в порядке листьев
+  std::vector<std::uint32_t> order_;
+  // центры экземпляров, нужные только при построении
+  std::vector<float> centers_;
+  float cost_;
+};
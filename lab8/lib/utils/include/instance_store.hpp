@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Число элементов матрицы преобразования одного экземпляра в буфере,
+// заполняемом BuildInstanceTransforms.
+constexpr std::size_t kInstanceTransformSize { 16 };
+
+// Наименьший масштаб экземпляров CreateInstanceStore.
+constexpr float kMinInstanceScale { 0.05f };
+
+// Состояния движущихся фигур в виде структуры массивов: i-е элементы
+// массивов описывают i-й экземпляр. Смысл полей совпадает с аргументами
+// UpdatePosition и CreateTransform; направления хранятся как 1.0f и -1.0f.
+// Фигура экземпляра дополнительно равномерно масштабируется на scales[i].
+struct InstanceStore {
+  std::vector<float> x_offsets;
+  std::vector<float> y_offsets;
+  std::vector<float> x_directions;
+  std::vector<float> y_directions;
+  std::vector<float> alphas;
+  std::vector<float> betas;
+  std::vector<float> scales;
+
+  std::size_t GetCount() const;
+  void Resize(std::size_t count);
+};
+
+// Создаёт count экземпляров. Нулевой экземпляр находится в начальном
+// состоянии одиночной фигуры, остальные получают случайные положения,
+// направления, углы и масштабы, воспроизводимые при одинаковом seed.
+// Масштабы распределены равномерно по логарифму в [kMinInstanceScale; 1],
+// поэтому мелких фигур больше, чем крупных, как при взгляде вглубь сцены.
+InstanceStore CreateInstanceStore(std::size_t count, unsigned int seed);
+
+// Выполняет шаг UpdatePosition для всех экземпляров.
+void UpdateInstancePositions(InstanceStore& store);
+
+// Поворачивает все экземпляры на заданные углы вокруг осей x и y.
+void RotateInstances(InstanceStore& store, float alpha_changing,
+                     float beta_changing);
+
+// Записывает в result состояние между previous и current: factor = 0
+// соответствует previous, factor = 1 -- current. Углы интерполируются по
+// кратчайшей дуге.
+void InterpolateInstances(const InstanceStore& previous,
+                          const InstanceStore& current, float factor,
+                          InstanceStore& result);
+// То же для count экземпляров, начиная с first; result уже должен иметь
+// размер current. Разные диапазоны можно обрабатывать параллельно.
+void InterpolateInstances(const InstanceStore& previous,
+                          const InstanceStore& current, float factor,
+                          std::size_t first, std::size_t count,
+                          InstanceStore& result);
+
+// Записывает в transforms по kInstanceTransformSize чисел на экземпляр:
+// матрицы CreateTransform, умноженные на масштаб экземпляра, в порядке
+// хранения glm.
+void BuildInstanceTransforms(const InstanceStore& store, float* transforms);
+// То же для count экземпляров, начиная с first; матрицы записываются на
+// свои места в transforms.
+void BuildInstanceTransforms(const InstanceStore& store, std::size_t first,
+                             std::size_t count, float* transforms);
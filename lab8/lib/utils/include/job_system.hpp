@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job {
+  std::function<void()> function;
+  // уменьшается по завершении задания, если задан
+  JobCounter* counter;
+};
+
+// Число незавершённых заданий, связанных со счётчиком. Задания, зависящие
+// от счётчика, ставятся в очередь, когда он обнуляется.
+class JobCounter {
+ public:
+  JobCounter();
+
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  // После true счётчик можно уничтожить: завершившее последнее задание
+  // больше к нему не обращается.
+  bool IsDone() const;
+
+ private:
+  friend class JobSystem;
+
+  std::atomic<std::size_t> value_;
+  mutable std::mutex mutex_;
+  std::vector<Job> continuations_;
+};
+
+// Планировщик заданий с перехватом работы. У каждого рабочего потока своя
+// очередь: поток берёт из неё последнее поставленное задание, а
+// простаивающие потоки забирают самые старые задания из чужих очередей.
+// Задания, поставленные из других потоков, попадают в общую внешнюю
+// очередь. Ожидающий поток (Wait) сам выполняет задания, поэтому задания
+// могут ставить и ждать вложенные задания.
+class JobSystem {
+ public:
+  // thread_count -- число потоков вместе с вызывающим; 0 означает число
+  // аппаратных потоков.
+  explicit JobSystem(unsigned int thread_count = 0);
+  // Все поставленные задания должны быть завершены.
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // Ставит задание в очередь. counter, если задан, увеличивается сразу и
+  // уменьшается по завершении задания. Задание с dependency начнётся не
+  // раньше, чем dependency обнулится, поэтому все задания, от которых оно
+  // зависит, должны быть поставлены раньше него.
+  void Run(std::function<void()> function, JobCounter* counter = nullptr,
+           JobCounter* dependency = nullptr);
+  // Выполняет задания, пока counter не обнулится.
+  void Wait(const JobCounter& counter);
+
+  // Делит [0; count) на части, границы которых кратны grain_size, и
+  // вызывает для них function(begin, end) параллельно; возвращает после
+  // завершения всех. При кратном ширине вектора grain_size векторные ядра
+  // обрабатывают одни и те же элементы при любом числе потоков.
+  void ParallelFor(std::size_t count, std::size_t grain_size,
+                   const std::function<void(std::size_t, std::size_t)>&
+                       function);
+
+  // Число потоков, выполняющих задания, вместе с вызывающим.
+  unsigned int GetThreadCount() const;
+  std::size_t GetJobCount() const;
+  // Число заданий, взятых из чужих очередей.
+  std::size_t GetStealCount() const;
+
+ private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  void Push(Job job);
+  bool TryRunJob();
+  void Execute(Job& job);
+  void Finish(JobCounter& counter);
+  void WorkerLoop(std::size_t queue_index);
+  // Очередь текущего потока; 0 -- внешняя.
+  std::size_t GetQueueIndex() const;
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  // число заданий во всех очередях
+  std::atomic<std::size_t> queued_count_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_condition_;
+  std::atomic<bool> stopping_;
+
+  std::atomic<std::size_t> job_count_;
+  std::atomic<std::size_t> steal_count_;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "draw_commands.hpp"
+#include "gl_state.hpp"
+#include "index_buffer.hpp"
+#include "tlsf_allocator.hpp"
+
+using MeshHandle = std::uint32_t;
+constexpr MeshHandle kInvalidMeshHandle { ~MeshHandle { 0 } };
+
+// Общие буферы вершин и индексов для многих сеток одного формата вершин.
+// Место в буферах распределяется TlsfAllocator в вершинах и индексах, так
+// что сетка рисуется с базовой вершиной и первым индексом, а все сетки --
+// с одним массивом вершин и, если доступен OpenGL 4.3, одним вызовом
+// glMultiDrawElementsIndirect. Иначе каждая команда рисуется отдельным
+// glDrawElementsInstancedBaseVertex.
+//
+// Шейдер получает номер экземпляра с учётом base_instance команды из
+// атрибута instance_location (gl_InstanceID его не учитывает). Атрибут
+// читается из буфера чисел 0, 1, ..., max_instance_count - 1.
+//
+// Индексы всех сеток хранятся в типе index_type, перезапуск примитива --
+// наибольшим значением типа (см. GetRestartIndex).
+class MeshArena {
+ public:
+  // Настраивает атрибуты вершин для текущих VAO и GL_ARRAY_BUFFER.
+  using SetupAttributes = void (*)();
+
+  MeshArena(GlStateCache& state, std::size_t vertex_size,
+            SetupAttributes setup_attributes, GLenum index_type,
+            GLuint instance_location, std::size_t max_instance_count,
+            std::size_t vertex_capacity = 1 << 16,
+            std::size_t index_capacity = 1 << 18);
+  ~MeshArena();
+
+  MeshArena(const MeshArena&) = delete;
+  MeshArena& operator=(const MeshArena&) = delete;
+
+  // Копирует сетку в буферы, при нехватке места дефрагментируя или
+  // увеличивая их. Возвращает kInvalidMeshHandle, если индексы не
+  // умещаются в index_type или место не удалось выделить.
+  MeshHandle AddMesh(const void* vertices, std::size_t vertex_count,
+                     const IndexBuffer& indices);
+  void RemoveMesh(MeshHandle mesh);
+
+  // Сдвигает сетки к началу буферов, копируя их в новые буферы.
+  void Defragment();
+
+  GLenum GetMode(MeshHandle mesh) const;
+  GLuint GetRestartIndex() const;
+  DrawElementsIndirectCommand GetDrawCommand(MeshHandle mesh,
+                                             GLuint instance_count,
+                                             GLuint base_instance) const;
+
+  // Рисует команды builder; номера экземпляров не должны превышать
+  // max_instance_count.
+  void Draw(const DrawCommandBuilder& builder);
+
+  bool IsIndirect() const;
+  // Число вызовов отрисовки и число нарисованных команд.
+  std::size_t GetDrawCallCount() const;
+  std::size_t GetCommandCount() const;
+  std::size_t GetDefragmentCount() const;
+  const TlsfAllocator& GetVertexAllocator() const;
+  const TlsfAllocator& GetIndexAllocator() const;
+
+ private:
+  struct Mesh {
+    TlsfHandle vertices;
+    TlsfHandle indices;
+    GLuint index_count;
+    GLenum mode;
+  };
+
+  // Переносит сетки в новые буферы заданной ёмкости, сдвигая их к началу.
+  void Reallocate(std::size_t vertex_capacity, std::size_t index_capacity);
+  void SetupVertexArray();
+  void SetBaseInstance(GLuint base_instance);
+
+  GlStateCache& state_;
+  std::size_t vertex_size_;
+  SetupAttributes setup_attributes_;
+  GLenum index_type_;
+  std::size_t index_size_;
+  GLuint instance_location_;
+  std::size_t max_instance_count_;
+  bool indirect_;
+
+  TlsfAllocator vertex_allocator_;
+  TlsfAllocator index_allocator_;
+  std::vector<Mesh> meshes_;
+  std::vector<MeshHandle> spare_meshes_;
+
+  GLuint vertex_array_;
+  GLuint vertex_buffer_;
+  GLuint index_buffer_;
+  GLuint instance_buffer_;
+  GLuint command_buffer_;
+  std::size_t command_capacity_;
+
+  std::size_t draw_call_count_;
+  std::size_t command_count_;
+  std::size_t defragment_count_;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+
+class JobSystem;
+
+// Генераторы параметрических поверхностей. Координаты записываются в буфер
+// вызывающей стороны в формате CreateCylinderCoordinates: для каждой вершины
+// 3 позиционные и 2 текстурные координаты подряд. Индексы задают список
+// треугольников. Размер буферов определяется функциями Get*MeshSize: если
+// буфер меньше или секторов (сторон) меньше 3, а поясов сферы меньше 2,
+// генератор возвращает false и ничего не записывает.
+//
+// Без планировщика jobs генераторы работают в вызывающем потоке и не
+// выделяют память. С планировщиком большие сетки делятся между его
+// потоками на части, границы которых не зависят от числа потоков, поэтому
+// результат совпадает с однопоточным бит в бит.
+
+// Способ вычисления синусов и косинусов углов секторов.
+enum class TrigKernel {
+  // std::cos и std::sin для каждого угла; результат совпадает с прежним
+  // скалярным генератором бит в бит.
+  kExact,
+  // Углы разбиваются на блоки: для начала блока значения вычисляются точно,
+  // остальные получаются по формулам синуса и косинуса суммы из таблицы
+  // смещений внутри блока. Для координат, по модулю не превышающих 1,
+  // отличие от kExact не больше 16 * DBL_EPSILON (см. BM_GenerateShape).
+  kAngleAddition,
+};
+
+struct MeshSize {
+  // число координат, т. е. 5 * число вершин
+  std::size_t coordinate_count;
+  std::size_t index_count;
+};
+
+// Боковая поверхность цилиндра, ось которого совпадает с осью z.
+MeshSize GetCylinderMeshSize(unsigned int sector_count);
+bool GenerateCylinderCoordinates(unsigned int sector_count, double radius,
+                                 double height, double* coordinates,
+                                 std::size_t coordinate_count,
+                                 TrigKernel kernel = TrigKernel::kExact,
+                                 JobSystem* jobs = nullptr);
+bool GenerateCylinderIndices(unsigned int sector_count, unsigned int* indices,
+                             std::size_t index_count,
+                             JobSystem* jobs = nullptr);
+
+// Цилиндр с основаниями. Вершины боковой поверхности совпадают с
+// GenerateCylinderCoordinates, за ними следуют верхнее и нижнее основания:
+// центр и окружность из sector_count + 1 вершин.
+MeshSize GetCappedCylinderMeshSize(unsigned int sector_count);
+bool GenerateCappedCylinderCoordinates(unsigned int sector_count,
+                                       double radius, double height,
+                                       double* coordinates,
+                                       std::size_t coordinate_count,
+                                       TrigKernel kernel = TrigKernel::kExact,
+                                       JobSystem* jobs = nullptr);
+bool GenerateCappedCylinderIndices(unsigned int sector_count,
+                                   unsigned int* indices,
+                                   std::size_t index_count,
+                                   JobSystem* jobs = nullptr);
+
+// Боковая поверхность конуса с вершиной в точке (0, 0, height / 2) и
+// основанием в плоскости z = -height / 2.
+MeshSize GetConeMeshSize(unsigned int sector_count);
+bool GenerateConeCoordinates(unsigned int sector_count, double radius,
+                             double height, double* coordinates,
+                             std::size_t coordinate_count,
+                             TrigKernel kernel = TrigKernel::kExact,
+                             JobSystem* jobs = nullptr);
+bool GenerateConeIndices(unsigned int sector_count, unsigned int* indices,
+                         std::size_t index_count, JobSystem* jobs = nullptr);
+
+// Сфера из sector_count меридианов и stack_count параллельных поясов.
+MeshSize GetSphereMeshSize(unsigned int sector_count,
+                           unsigned int stack_count);
+bool GenerateSphereCoordinates(unsigned int sector_count,
+                               unsigned int stack_count, double radius,
+                               double* coordinates,
+                               std::size_t coordinate_count,
+                               TrigKernel kernel = TrigKernel::kExact,
+                               JobSystem* jobs = nullptr);
+bool GenerateSphereIndices(unsigned int sector_count, unsigned int stack_count,
+                           unsigned int* indices, std::size_t index_count,
+                           JobSystem* jobs = nullptr);
+
+// Тор в плоскости xy: sector_count секторов вдоль большой окружности
+// радиуса major_radius и side_count сторон вдоль малой окружности радиуса
+// minor_radius.
+MeshSize GetTorusMeshSize(unsigned int sector_count, unsigned int side_count);
+bool GenerateTorusCoordinates(unsigned int sector_count,
+                              unsigned int side_count, double major_radius,
+                              double minor_radius, double* coordinates,
+                              std::size_t coordinate_count,
+                              TrigKernel kernel = TrigKernel::kExact,
+                              JobSystem* jobs = nullptr);
+bool GenerateTorusIndices(unsigned int sector_count, unsigned int side_count,
+                          unsigned int* indices, std::size_t index_count,
+                          JobSystem* jobs = nullptr);
@@ -0,0 +1,27 @@
+#pragma once
+
+// Контекст OpenGL 3.3 core без окна через EGL. Используется платформа
+// surfaceless из Mesa, если она есть (тогда не нужен ни X, ни Wayland, и
+// контекст работает, например, на llvmpipe), иначе дисплей по умолчанию.
+// Отрисовка идёт в кадровый буфер приложения (см. FrameReadback).
+//
+// Доступен, если библиотека собрана с LAB8_ENABLE_HEADLESS.
+class OffscreenContext {
+ public:
+  OffscreenContext();
+  ~OffscreenContext();
+
+  OffscreenContext(const OffscreenContext&) = delete;
+  OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+  // Создаёт контекст, делает его текущим и загружает функции OpenGL через
+  // glad. Возвращает false и сообщает причину в std::cerr при ошибке.
+  bool Create();
+
+ private:
+  // EGLDisplay, EGLSurface и EGLContext; заголовки EGL не подключаются,
+  // чтобы не тянуть их (и заголовки X11) в main.cpp
+  void* display_;
+  void* surface_;
+  void* context_;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Профилирование кадра. Участки кода отмечаются макросами
+//   LAB8_PROFILE_SCOPE("имя");      // время CPU до конца области видимости
+//   LAB8_PROFILE_GPU_SCOPE("имя");  // время GPU между командами области
+// Имена должны быть строковыми литералами: сохраняются только указатели.
+// Если библиотека собрана без LAB8_PROFILER, макросы ничего не делают.
+//
+// Каждый поток пишет события в собственный кольцевой буфер без блокировок;
+// Profiler::EndFrame, вызываемый потоком отрисовки, забирает их, считает
+// суммарное время каждого участка за кадр (по всем потокам, поэтому оно
+// может превышать длительность кадра) и, если включена трасса,
+// сохраняет события для экспорта в формате Chrome trace event
+// (chrome://tracing, ui.perfetto.dev).
+
+#if defined(LAB8_PROFILER)
+#define LAB8_PROFILE_CONCAT_IMPL(first, second) first##second
+#define LAB8_PROFILE_CONCAT(first, second) \
+  LAB8_PROFILE_CONCAT_IMPL(first, second)
+#define LAB8_PROFILE_SCOPE(name) \
+  ScopedCpuTimer LAB8_PROFILE_CONCAT(profile_scope_, __LINE__) { name }
+#define LAB8_PROFILE_GPU_SCOPE(name) \
+  ScopedGpuTimer LAB8_PROFILE_CONCAT(profile_gpu_scope_, __LINE__) { name }
+#else
+#define LAB8_PROFILE_SCOPE(name) static_cast<void>(0)
+#define LAB8_PROFILE_GPU_SCOPE(name) static_cast<void>(0)
+#endif
+
+// Время участка за кадр по последним Profiler::kMaxZoneFrameCount кадрам,
+// в которых он выполнялся.
+struct ZoneStatistics {
+  // имена участков GPU начинаются с "GPU "
+  std::string name;
+  // false для участков, измеренных на GPU
+  bool cpu;
+  std::size_t frame_count;
+  double min_ms;
+  double average_ms;
+  double p99_ms;
+};
+
+class Profiler {
+ public:
+  // Число последних кадров участка, по которым считается статистика;
+  // более старые забываются, чтобы память не росла при долгой работе.
+  static constexpr std::size_t kMaxZoneFrameCount { 1 << 12 };
+
+  static Profiler& GetInstance();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  // Сохранять события для WriteChromeTrace (не больше max_event_count).
+  void EnableTrace(std::size_t max_event_count = 1 << 20);
+
+  // Включает участки GPU, если есть запросы времени GL_TIMESTAMP
+  // (OpenGL 3.3). Вызывается с текущим контекстом;
+  // DisableGpuTimers должен быть вызван до его уничтожения.
+  bool EnableGpuTimers();
+  void DisableGpuTimers();
+
+  void BeginFrame();
+  void EndFrame();
+  // Забывает участки, кадры и события трассы и выключает трассу.
+  // Вызывается потоком, вызывающим EndFrame.
+  void Reset();
+
+  std::size_t GetFrameCount() const;
+  std::vector<ZoneStatistics> GetStatistics() const;
+  void PrintStatistics(std::ostream& stream) const;
+  bool WriteChromeTrace(const char* path) const;
+
+  // текущее время в наносекундах от запуска программы
+  static std::int64_t GetTime();
+
+  void RecordCpuEvent(const char* name, std::int64_t start,
+                      std::int64_t end);
+  // Возвращает номер пары запросов или -1, если участки GPU выключены.
+  int BeginGpuEvent(const char* name);
+  void EndGpuEvent(int event);
+
+ private:
+  struct Event {
+    const char* name;
+    std::int64_t start;
+    std::int64_t end;
+  };
+
+  // Кольцевой буфер событий одного потока: поток пишет, EndFrame читает.
+  struct ThreadBuffer {
+    static constexpr std::uint32_t kCapacity { 1 << 14 };
+
+    std::unique_ptr<Event[]> events { new Event[kCapacity] };
+    std::atomic<std::uint32_t> write_index { 0 };
+    std::atomic<std::uint32_t> read_index { 0 };
+    std::atomic<std::uint32_t> dropped_count { 0 };
+    std::uint32_t thread_id { 0 };
+  };
+
+  struct GpuEvent {
+    const char* name;
+    unsigned int begin_query;
+    unsigned int end_query;
+    bool ended;
+  };
+
+  struct TraceEvent {
+    const char* name;
+    std::int64_t start;
+    std::int64_t end;
+    // номер потока; участки GPU записываются в отдельную дорожку
+    std::uint32_t thread_id;
+  };
+
+  struct Zone {
+    bool cpu;
+    // суммарное время участка за текущий кадр
+    std::int64_t frame_total;
+    bool in_frame;
+    // суммарные времена за последние кадры, кольцевой буфер из не
+    // более чем kMaxZoneFrameCount значений
+    std::vector<std::int64_t> frame_totals;
+    // число кадров участка за всё время
+    std::size_t frame_count;
+  };
+
+  Profiler();
+
+  ThreadBuffer& GetThreadBuffer();
+  void AddEvent(const char* name, bool cpu, std::int64_t start,
+                std::int64_t end, std::uint32_t thread_id);
+  void CollectCpuEvents();
+  void CollectGpuEvents();
+
+  mutable std::mutex buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+  // поля ниже используются только потоком, вызывающим EndFrame
+  std::int64_t frame_start_;
+  std::size_t frame_count_;
+  std::unordered_map<std::string, Zone> zones_;
+  // порядок появления участков для вывода
+  std::vector<std::string> zone_order_;
+
+  bool trace_enabled_;
+  std::size_t max_trace_event_count_;
+  std::vector<TraceEvent> trace_events_;
+  std::size_t dropped_trace_event_count_;
+
+  bool gpu_timers_enabled_;
+  // разность часов CPU и GPU в наносекундах
+  std::int64_t gpu_time_offset_;
+  std::vector<GpuEvent> gpu_events_;
+  std::vector<unsigned int> free_queries_;
+  std::vector<unsigned int> all_queries_;
+};
+
+class ScopedCpuTimer {
+ public:
+  explicit ScopedCpuTimer(const char* name);
+  ~ScopedCpuTimer();
+
+  ScopedCpuTimer(const ScopedCpuTimer&) = delete;
+  ScopedCpuTimer& operator=(const ScopedCpuTimer&) = delete;
+
+ private:
+  const char* name_;
+  std::int64_t start_;
+};
+
+class ScopedGpuTimer {
+ public:
+  explicit ScopedGpuTimer(const char* name);
+  ~ScopedGpuTimer();
+
+  ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+  ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+
+ private:
+  int event_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+// Читает файл целиком одним чтением.
+bool ReadFile(const std::string& path, std::string& contents);
+
+// Записывает в source текст шейдера path, подставив вместо строк
+// #include "имя" содержимое файлов (пути относительно включающего файла).
+// Каждый файл включается не больше одного раза, как с #pragma once. Перед
+// включённым текстом и после него вставляются директивы #line с номером
+// файла в порядке включения (корневой -- 0), поэтому сообщения компилятора
+// указывают на строки исходных файлов. Ошибки сообщаются в std::cerr.
+bool PreprocessShader(const std::string& path, std::string& source);
+
+constexpr std::uint64_t kFnvOffsetBasis { 14695981039346656037ull };
+
+// 64-битный хэш FNV-1a; hash -- результат для предшествующих данных.
+std::uint64_t HashBytes(const void* data, std::size_t size,
+                        std::uint64_t hash = kFnvOffsetBasis);
+
+// Файл кэша -- заголовок и binary_size байтов, выданных
+// glGetProgramBinary. Файлы пишутся и читаются на одной машине, поэтому
+// порядок байтов не фиксируется.
+struct ShaderBinaryHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint32_t format;
+  std::uint32_t binary_size;
+};
+
+static_assert(sizeof(ShaderBinaryHeader) == 24,
+              "Shader binary header must have no padding");
+
+constexpr char kShaderBinaryMagic[4] { 'L', '8', 'S', 'B' };
+constexpr std::uint32_t kShaderBinaryVersion { 1 };
+
+// Сборка программ из вершинного и фрагментного шейдеров с кэшем
+// скомпонованных программ на диске. Ключ -- хэш обработанных исходников и
+// строк GL_VENDOR, GL_RENDERER и GL_VERSION, так что после изменения
+// шейдеров или обновления драйвера программа собирается заново. Файл,
+// который драйвер не принял, перезаписывается.
+//
+// Создаётся при текущем контексте. Кэш не используется, если directory
+// пуст или драйвер не поддерживает двоичные представления программ
+// (OpenGL 4.1).
+class ShaderCache {
+ public:
+  explicit ShaderCache(std::string directory);
+
+  // Возвращает 0 при ошибке; причина сообщается в std::cerr.
+  GLuint CreateProgram(const std::string& vertex_path,
+                       const std::string& fragment_path);
+
+  bool IsEnabled() const;
+  std::size_t GetHitCount() const;
+  std::size_t GetMissCount() const;
+
+ private:
+  std::string GetBinaryPath(std::uint64_t key) const;
+  GLuint LoadBinary(std::uint64_t key) const;
+  void StoreBinary(GLuint program, std::uint64_t key) const;
+
+  std::string directory_;
+  bool enabled_;
+  // строки драйвера, входящие в ключ
+  std::string driver_;
+
+  std::size_t hit_count_;
+  std::size_t miss_count_;
+};
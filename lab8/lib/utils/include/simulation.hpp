@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "instance_store.hpp"
+#include "triple_buffer.hpp"
+
+// Состояние фигур после двух последовательных шагов моделирования. Поток
+// отрисовки показывает момент между ними (см. InterpolateInstances), то
+// есть отстаёт от моделирования на один шаг.
+struct SimulationSnapshot {
+  // номер шага, после которого получено current
+  std::uint64_t tick;
+  // запланированное время шага tick
+  std::chrono::steady_clock::time_point time;
+  // момент публикации снимка, для измерения задержки передачи
+  std::chrono::steady_clock::time_point publish_time;
+  // число вводов, пришедших после своего шага и применённых позже
+  std::uint64_t late_input_count;
+  InstanceStore previous;
+  InstanceStore current;
+};
+
+// Углы поворота за шаг, действующие начиная с шага tick.
+struct RotationInput {
+  std::uint64_t tick;
+  float alpha_changing;
+  float beta_changing;
+};
+
+// Один шаг моделирования: UpdateInstancePositions и поворот на заданные
+// углы. Результат зависит только от состояния и числа шагов.
+void StepSimulation(InstanceStore& store, float alpha_changing,
+                    float beta_changing);
+
+// Моделирование в отдельном потоке с фиксированной частотой шагов. После
+// каждого шага снимок публикуется через тройной буфер; отстающий поток
+// выполняет пропущенные шаги подряд, поэтому состояние после n шагов не
+// зависит ни от частоты кадров, ни от загрузки процессора.
+class SimulationThread {
+ public:
+  SimulationThread(InstanceStore initial_state, double tick_rate);
+  ~SimulationThread();
+
+  SimulationThread(const SimulationThread&) = delete;
+  SimulationThread& operator=(const SimulationThread&) = delete;
+
+  // Углы поворота за шаг, применяемые начиная с шага tick; номера шагов
+  // не должны убывать. Ввод, пришедший после своего шага, применяется с
+  // ближайшего и учитывается в snapshot.late_input_count. Без опозданий
+  // состояние совпадает с последовательными вызовами StepSimulation с теми
+  // же углами.
+  void SetRotation(std::uint64_t tick, float alpha_changing,
+                   float beta_changing);
+
+  // Забирает последний снимок; возвращает true, если он обновился.
+  // Вызывается только из одного потока.
+  bool Update();
+  const SimulationSnapshot& GetSnapshot() const;
+
+  // Доля шага от snapshot.time до now в [0; 1] для InterpolateInstances.
+  float GetInterpolationFactor(
+      std::chrono::steady_clock::time_point now) const;
+
+  std::chrono::steady_clock::duration GetTickDuration() const;
+
+  void Stop();
+
+ private:
+  void Run(InstanceStore state, std::chrono::steady_clock::time_point start);
+
+  std::chrono::steady_clock::duration tick_duration_;
+  TripleBuffer<SimulationSnapshot> snapshots_;
+
+  std::mutex input_mutex_;
+  std::vector<RotationInput> inputs_;
+  std::atomic<bool> stopping_;
+  std::thread thread_;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/matrix.hpp>
+
+#include "utils.hpp"
+
+// Буфер кадра программного растеризатора. Цвет хранится в формате RGBA8
+// (красный канал в младшем байте), глубина -- в диапазоне [0; 1]. Ширина
+// строки дополняется до кратной 4, чтобы растеризатор обрабатывал пиксели
+// группами по 4 без проверки выхода за границы.
+struct SoftwareFramebuffer {
+  int width;
+  int height;
+  int stride;
+  std::vector<std::uint32_t> color;
+  std::vector<float> depth;
+
+  SoftwareFramebuffer(int width, int height);
+
+  void Clear(float red, float green, float blue, float alpha);
+  bool WritePpm(const char* path) const;
+};
+
+// Текстура программного растеризатора в формате RGBA8.
+struct SoftwareTexture {
+  int width;
+  int height;
+  std::vector<std::uint32_t> texels;
+
+  explicit SoftwareTexture(const Image& image);
+};
+
+// Тайловый растеризатор треугольников на CPU. Вершины задаются в формате
+// CreateCylinderCoordinates, индексы -- в формате CreateCylinderIndices.
+// Треугольники распределяются по тайлам экрана, после чего тайлы
+// растеризуются всеми потоками; поток, закончивший свои тайлы, забирает
+// необработанные тайлы других потоков.
+class SoftwareRenderer {
+ public:
+  // thread_count, равное 0, означает число аппаратных потоков.
+  explicit SoftwareRenderer(unsigned int thread_count = 0);
+  ~SoftwareRenderer();
+
+  SoftwareRenderer(const SoftwareRenderer&) = delete;
+  SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+  void Draw(const std::vector<double>& coordinates,
+            const std::vector<unsigned int>& indices,
+            const glm::mat4& transform, const SoftwareTexture& texture,
+            SoftwareFramebuffer& framebuffer);
+
+  unsigned int GetThreadCount() const;
+
+  static constexpr int kTileSize { 64 };
+
+ private:
+  struct ScreenVertex {
+    float x;
+    float y;
+    float z;
+    float inv_w;
+    float u_w;
+    float v_w;
+    bool visible;
+  };
+
+  struct TriangleSetup {
+    // Функции рёбер, нормированные на площадь треугольника: значение i-й
+    // функции в точке равно i-й барицентрической координате.
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    bool top_left[3];
+    unsigned int vertices[3];
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+  };
+
+  // Диапазон тайлов потока. Следующий тайл берётся атомарным увеличением
+  // next, поэтому диапазон могут разбирать и другие потоки.
+  struct alignas(64) TileRange {
+    std::atomic<int> next;
+    int end;
+  };
+
+  void RunParallel(const std::function<void(unsigned int)>& task);
+  void WorkerLoop(unsigned int worker_index);
+
+  void TransformVertices(unsigned int worker_index);
+  void BinTriangles(unsigned int worker_index);
+  void RasterizeTiles(unsigned int worker_index);
+  void RasterizeTile(int tile_index);
+  void RasterizeTriangle(const TriangleSetup& triangle, int tile_min_x,
+                         int tile_min_y, int tile_max_x, int tile_max_y);
+  std::uint32_t ShadePixel(const TriangleSetup& triangle, float l0, float l1,
+                           float l2) const;
+
+  unsigned int thread_count_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable start_condition_;
+  std::condition_variable finish_condition_;
+  std::function<void(unsigned int)> task_;
+  std::uint64_t generation_;
+  unsigned int remaining_;
+  bool stopping_;
+
+  // состояние текущего вызова Draw
+  const std::vector<double>* coordinates_;
+  const std::vector<unsigned int>* indices_;
+  glm::mat4 transform_;
+  const SoftwareTexture* texture_;
+  SoftwareFramebuffer* framebuffer_;
+  int tiles_x_;
+  int tiles_y_;
+
+  std::vector<ScreenVertex> vertices_;
+  std::vector<TriangleSetup> triangles_;
+  // bins_[worker][tile] -- индексы треугольников, попавших в тайл, в порядке
+  // их следования в индексном буфере
+  std::vector<std::vector<std::vector<unsigned int>>> bins_;
+  std::unique_ptr<TileRange[]> tile_ranges_;
+};
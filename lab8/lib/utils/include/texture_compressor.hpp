@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "utils.hpp"
+
+// Размер блока BC1 (DXT1) в байтах: блок кодирует 4x4 пикселя.
+constexpr std::size_t kBc1BlockSize { 8 };
+
+// Соотношение качества и скорости сжатия.
+enum class CompressionQuality {
+  // концы отрезка палитры -- углы ограничивающего параллелепипеда цветов
+  kFast,
+  // концы отрезка лежат на главной оси цветов блока
+  kNormal,
+  // kNormal, после чего концы уточняются методом наименьших квадратов
+  kHigh,
+};
+
+// Размер изображения width x height в формате BC1 в байтах.
+std::size_t GetBc1Size(int width, int height);
+
+// Сжимает изображение в BC1 без прозрачности (четырёхцветные блоки).
+// Блоки идут построчно; неполные блоки на краях дополняются повторением
+// крайних пикселей. Строки блоков распределяются между thread_count
+// потоками; 0 означает число аппаратных потоков.
+std::vector<unsigned char> CompressBc1(const ImageView& image,
+                                       CompressionQuality quality,
+                                       unsigned int thread_count = 0);
+
+// Восстанавливает изображение RGB из блоков BC1.
+Image DecompressBc1(const unsigned char* blocks, int width, int height);
+
+// Пиковое отношение сигнала к шуму в децибелах по каналам RGB двух
+// изображений одного размера. Одноканальные изображения считаются серыми.
+double ComputePsnr(const ImageView& first, const ImageView& second);
+
+// Создаёт текстуру GL_COMPRESSED_RGB_S3TC_DXT1_EXT из уровней
+// детализации, пиксели которых указывают на блоки BC1. Если расширение
+// GL_EXT_texture_compression_s3tc не поддерживается, уровни распаковываются
+// и загружаются без сжатия.
+unsigned int CreateBc1Texture(const std::vector<ImageView>& levels);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "texture_compressor.hpp"
+#include "utils.hpp"
+
+// Контейнер текстуры -- файл с заранее подготовленными уровнями
+// детализации, которые загружаются в OpenGL без декодирования. Все числа
+// записываются в порядке байтов little-endian:
+//
+//   TextureContainerHeader
+//   TextureContainerLevel[level_count]
+//   данные уровней, каждый с отступа, кратного data_alignment
+//
+// Строки пикселей (или блоков BC1) внутри уровня идут сверху вниз без
+// выравнивания.
+
+// формат пикселей контейнера
+enum class TextureContainerFormat : std::uint32_t {
+  // channels беззнаковых нормализованных байтов на пиксель
+  kUnorm8 = 1,
+  // блоки BC1 без прозрачности; channels равно 3
+  kBc1 = 2,
+};
+
+struct TextureContainerHeader {
+  char magic[4];
+  std::uint32_t version;
+  TextureContainerFormat format;
+  std::uint32_t channels;
+  std::uint32_t level_count;
+  // выравнивание отступов данных уровней от начала файла
+  std::uint32_t data_alignment;
+  // выравнивание строк пикселей для GL_UNPACK_ALIGNMENT
+  std::uint32_t row_alignment;
+  std::uint32_t reserved;
+  std::uint64_t file_size;
+  // размер и время изменения изображения, из которого подготовлен
+  // контейнер (см. TextureSourceStamp)
+  std::uint64_t source_size;
+  std::int64_t source_modification_time;
+};
+
+struct TextureContainerLevel {
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+static_assert(sizeof(TextureContainerHeader) == 56,
+              "Texture container header must have no padding");
+static_assert(sizeof(TextureContainerLevel) == 24,
+              "Texture container level must have no padding");
+
+constexpr char kTextureContainerMagic[4] { 'L', '8', 'T', 'X' };
+constexpr std::uint32_t kTextureContainerVersion { 2 };
+constexpr std::uint32_t kTextureContainerAlignment { 64 };
+
+// Путь к контейнеру, подготовленному для изображения image_path: расширение
+// заменяется на ".l8tex".
+std::string GetTextureContainerPath(const std::string& image_path);
+
+// Признаки версии исходного изображения. Контейнер, признаки которого не
+// совпадают с признаками изображения, устарел: изображение изменили после
+// подготовки.
+struct TextureSourceStamp {
+  std::uint64_t size;
+  // std::filesystem::file_time_type в единицах её часов; сравнивается
+  // только на той же машине
+  std::int64_t modification_time;
+};
+
+// Возвращает false, если файла нет.
+bool GetTextureSourceStamp(const std::string& image_path,
+                           TextureSourceStamp& stamp);
+
+struct TextureContainerOptions {
+  TextureContainerFormat format { TextureContainerFormat::kUnorm8 };
+  // используется только для kBc1
+  CompressionQuality quality { CompressionQuality::kNormal };
+};
+
+// Записывает уровни детализации (например, из CreateMipChain), полученные
+// из изображения с признаками source, в контейнер, при необходимости сжимая
+// их.
+bool WriteTextureContainer(const char* path, const std::vector<Image>& levels,
+                           const TextureSourceStamp& source,
+                           const TextureContainerOptions& options = { });
+
+// Контейнер, отображённый в память только для чтения. Указатели на данные
+// уровней действительны, пока объект существует.
+class MappedTextureContainer {
+ public:
+  MappedTextureContainer();
+  ~MappedTextureContainer();
+
+  MappedTextureContainer(const MappedTextureContainer&) = delete;
+  MappedTextureContainer& operator=(const MappedTextureContainer&) = delete;
+
+  // Отображает файл и проверяет его заголовок. Возвращает false, если файла
+  // нет или он повреждён.
+  bool Open(const char* path);
+  // Открывает контейнер, подготовленный для изображения image_path
+  // (GetTextureContainerPath). Возвращает false, если контейнер устарел;
+  // если изображения нет, контейнер используется как есть.
+  bool OpenForImage(const std::string& image_path);
+  void Close();
+
+  const TextureContainerHeader& GetHeader() const;
+  std::size_t GetLevelCount() const;
+  // Уровень детализации, пиксели которого указывают внутрь файла. Для
+  // kBc1 pixels указывает на блоки.
+  ImageView GetLevel(std::size_t level) const;
+
+ private:
+  const unsigned char* data_;
+  std::size_t size_;
+  // используется вместо отображения там, где нет mmap
+  std::vector<unsigned char> buffer_;
+};
+
+// Создаёт текстуру из всех уровней контейнера без копирования их данных.
+unsigned int CreateTexture(const MappedTextureContainer& container);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+// Строит цепочку уровней детализации: нулевой уровень -- само изображение,
+// каждый следующий вдвое меньше предыдущего (с округлением вниз, но не
+// меньше 1) и получен усреднением блоков 2x2, как при glGenerateMipmap.
+std::vector<Image> CreateMipChain(Image image);
+
+// Результат декодирования одной текстуры.
+struct DecodedTexture {
+  // идентификатор, переданный в TextureDecoder::Submit
+  std::size_t id;
+  // false, если файл не удалось прочитать; levels в этом случае пуст
+  bool loaded;
+  std::vector<Image> levels;
+};
+
+// Пул потоков, декодирующих изображения и строящих для них цепочки уровней
+// детализации без обращения к OpenGL. Готовые текстуры складываются в
+// очередь ограниченной длины: если её не успевают разбирать, потоки ждут,
+// а не накапливают декодированные изображения в памяти.
+class TextureDecoder {
+ public:
+  // thread_count, равное 0, означает число аппаратных потоков без одного
+  // (но не меньше одного), чтобы не отнимать процессор у потока отрисовки.
+  explicit TextureDecoder(unsigned int thread_count = 0,
+                          std::size_t queue_capacity = 4);
+  // Необработанные запросы отбрасываются.
+  ~TextureDecoder();
+
+  TextureDecoder(const TextureDecoder&) = delete;
+  TextureDecoder& operator=(const TextureDecoder&) = delete;
+
+  void Submit(std::size_t id, const std::string& path);
+
+  // Забирает готовую текстуру, если она есть, не блокируясь.
+  bool TryPop(DecodedTexture& texture);
+  // Ждёт готовую текстуру. Возвращает false, если все отправленные
+  // запросы уже забраны.
+  bool Pop(DecodedTexture& texture);
+
+  unsigned int GetThreadCount() const;
+
+ private:
+  struct Request {
+    std::size_t id;
+    std::string path;
+  };
+
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::size_t queue_capacity_;
+
+  std::mutex mutex_;
+  std::condition_variable request_condition_;
+  std::condition_variable space_condition_;
+  std::condition_variable result_condition_;
+  std::deque<Request> requests_;
+  std::deque<DecodedTexture> results_;
+  // число отправленных, но ещё не забранных запросов
+  std::size_t pending_;
+  bool stopping_;
+};
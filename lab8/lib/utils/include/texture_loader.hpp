@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "texture_decoder.hpp"
+
+// Номер текстуры, выданный TextureLoader::Load.
+using TextureHandle = std::size_t;
+
+// Асинхронная загрузка текстур. Изображения декодируются и уменьшаются в
+// потоках TextureDecoder, а поток с контекстом OpenGL загружает готовые
+// текстуры в ProcessUploads, не превышая заданного времени за кадр. Пока
+// текстура не загружена (или если её не удалось прочитать), вместо неё
+// выдаётся текстура-заглушка.
+//
+// Все методы, кроме GetThreadCount, вызываются из потока с текущим
+// контекстом OpenGL, в том числе конструктор и деструктор.
+class TextureLoader {
+ public:
+  explicit TextureLoader(unsigned int thread_count = 0,
+                         std::size_t queue_capacity = 4);
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+
+  // Текстура из подготовленного контейнера (см. GetTextureContainerPath)
+  // загружается сразу, остальные -- через потоки декодирования.
+  TextureHandle Load(const std::string& path);
+
+  // Загружает готовые текстуры, пока не истечёт budget; хотя бы одна
+  // готовая текстура загружается всегда. Возвращает число загруженных.
+  std::size_t ProcessUploads(std::chrono::microseconds budget);
+
+  // Имя объекта текстуры OpenGL или заглушки.
+  unsigned int GetTexture(TextureHandle handle) const;
+  bool IsReady(TextureHandle handle) const;
+
+  unsigned int GetThreadCount() const;
+
+ private:
+  static unsigned int Upload(const std::vector<Image>& levels);
+
+  TextureDecoder decoder_;
+  unsigned int placeholder_;
+  // 0, пока текстура не загружена
+  std::vector<unsigned int> textures_;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Номер участка TlsfAllocator. Он не меняется при дефрагментации, в отличие
+// от смещения участка.
+using TlsfHandle = std::uint32_t;
+constexpr TlsfHandle kInvalidTlsfHandle { ~TlsfHandle { 0 } };
+
+// Перемещение данных участка при дефрагментации.
+struct TlsfMove {
+  std::size_t source;
+  std::size_t destination;
+  std::size_t size;
+};
+
+// Распределитель диапазона [0, capacity) по схеме TLSF (two-level
+// segregated fit): свободные участки хранятся в списках по классам
+// размеров, класс задаётся старшим битом размера и следующими за ним
+// kSecondLevelBits битами. Подходящий список находится по битовым картам
+// за постоянное время, поэтому выделение и освобождение не зависят от
+// числа участков. Соседние свободные участки сливаются при освобождении.
+//
+// Сам распределитель не владеет памятью: он выдаёт смещения в единицах,
+// выбранных вызывающей стороной (например, вершинах буфера OpenGL).
+class TlsfAllocator {
+ public:
+  explicit TlsfAllocator(std::size_t capacity);
+
+  // Возвращает kInvalidTlsfHandle, если подходящего свободного участка
+  // нет, даже если свободного места в сумме достаточно.
+  TlsfHandle Allocate(std::size_t size);
+  void Free(TlsfHandle handle);
+
+  // Наименьший свободный участок, в котором Allocate(size) заведомо найдёт
+  // место. Запрос округляется вверх до следующего класса размеров, поэтому
+  // участок ровно из size единиц может не подойти.
+  static std::size_t GetFitSize(std::size_t size);
+
+  std::size_t GetOffset(TlsfHandle handle) const;
+  std::size_t GetSize(TlsfHandle handle) const;
+
+  // Сдвигает занятые участки к началу диапазона без изменения их порядка,
+  // оставляя один свободный участок в конце. В moves записываются
+  // перемещения данных в порядке возрастания смещений; перемещаемые
+  // диапазоны могут перекрываться с прежними.
+  void Defragment(std::vector<TlsfMove>& moves);
+  // Увеличивает диапазон до capacity, добавляя место в конец.
+  void Grow(std::size_t capacity);
+
+  std::size_t GetCapacity() const;
+  std::size_t GetUsedSize() const;
+  std::size_t GetAllocationCount() const;
+  // Наибольший свободный участок; если он заметно меньше свободного места
+  // в сумме, диапазон фрагментирован.
+  std::size_t GetLargestFreeSize() const;
+
+ private:
+  static constexpr unsigned int kSecondLevelBits { 4 };
+  static constexpr unsigned int kSecondLevelCount { 1u << kSecondLevelBits };
+  static constexpr unsigned int kFirstLevelCount { 64 };
+  static constexpr std::uint32_t kNone { ~std::uint32_t { 0 } };
+
+  struct Block {
+    std::size_t offset;
+    std::size_t size;
+    // соседи в диапазоне
+    std::uint32_t previous;
+    std::uint32_t next;
+    // соседи в списке свободных участков того же класса
+    std::uint32_t previous_free;
+    std::uint32_t next_free;
+    bool free;
+  };
+
+  static void GetClass(std::size_t size, unsigned int& first,
+                       unsigned int& second);
+
+  std::uint32_t CreateBlock(std::size_t offset, std::size_t size);
+  void ReleaseBlock(std::uint32_t index);
+  void InsertFree(std::uint32_t index);
+  void RemoveFree(std::uint32_t index);
+  // Свободный участок не меньше size или kNone.
+  std::uint32_t FindFree(std::size_t size) const;
+
+  std::vector<Block> blocks_;
+  // номера неиспользуемых элементов blocks_
+  std::vector<std::uint32_t> spare_blocks_;
+  std::uint64_t first_level_map_;
+  std::uint32_t second_level_maps_[kFirstLevelCount];
+  std::uint32_t free_lists_[kFirstLevelCount][kSecondLevelCount];
+
+  std::uint32_t first_block_;
+  std::uint32_t last_block_;
+  std::size_t capacity_;
+  std::size_t used_size_;
+  std::size_t allocation_count_;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Передача последнего значения от одного потока-писателя одному
+// потоку-читателю без ожидания. Писатель заполняет свой буфер и публикует
+// его, читатель забирает последний опубликованный; третий буфер лежит
+// между ними, поэтому ни один из потоков не ждёт другого, а промежуточные
+// значения, которые читатель не успел забрать, пропускаются.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer()
+      : write_index_ { 0 },
+        middle_ { 1 },
+        read_index_ { 2 } { }
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Буфер писателя; его прежнее содержимое не определено.
+  T& GetWriteBuffer() {
+    return buffers_[write_index_];
+  }
+
+  void Publish() {
+    const std::uint8_t kPrevious {
+      middle_.exchange(write_index_ | kFresh, std::memory_order_acq_rel)
+    };
+    write_index_ = kPrevious & kIndexMask;
+  }
+
+  // Забирает последний опубликованный буфер, если он новее текущего
+  // буфера читателя. Возвращает true, если буфер читателя обновился.
+  bool Update() {
+    if (!(middle_.load(std::memory_order_relaxed) & kFresh)) {
+      return false;
+    }
+
+    const std::uint8_t kPrevious {
+      middle_.exchange(read_index_, std::memory_order_acq_rel)
+    };
+    read_index_ = kPrevious & kIndexMask;
+    return true;
+  }
+
+  const T& GetReadBuffer() const {
+    return buffers_[read_index_];
+  }
+
+ private:
+  // признак того, что средний буфер опубликован и ещё не прочитан
+  static constexpr std::uint8_t kFresh { 4 };
+  static constexpr std::uint8_t kIndexMask { 3 };
+
+  T buffers_[3];
+  // используется только писателем
+  std::uint8_t write_index_;
+  alignas(64) std::atomic<std::uint8_t> middle_;
+  // используется только читателем
+  alignas(64) std::uint8_t read_index_;
+};
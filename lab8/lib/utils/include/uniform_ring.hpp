@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "gl_state.hpp"
+
+// Участок UniformRing, выделенный в текущем кадре. Данные записываются по
+// указателю data; offset отсчитывается от начала буфера OpenGL.
+struct UniformAllocation {
+  void* data;
+  GLintptr offset;
+  GLsizeiptr size;
+};
+
+// Кольцевой буфер GL_UNIFORM_BUFFER для данных, которые заново
+// записываются каждый кадр. Буфер разделён на frame_count областей по
+// frame_capacity байт; кадр пишет в свою область, пока GPU читает
+// предыдущие. Перед повторным использованием области BeginFrame ждёт
+// барьер, поставленный в EndFrame того кадра, который её заполнял.
+//
+// Если доступен OpenGL 4.4, буфер отображается в память один раз
+// (постоянное когерентное отображение) и данные пишутся прямо в него.
+// Иначе они копируются в буфер в Flush без синхронизации драйвера.
+class UniformRing {
+ public:
+  UniformRing(GlStateCache& state, std::size_t frame_capacity,
+              unsigned int frame_count = 3);
+  ~UniformRing();
+
+  UniformRing(const UniformRing&) = delete;
+  UniformRing& operator=(const UniformRing&) = delete;
+
+  void BeginFrame();
+
+  // Выделяет size байт с выравниванием GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+  // Возвращает участок с data == nullptr, если в кадре не хватает места.
+  UniformAllocation Allocate(std::size_t size);
+
+  // Делает записанные данные видимыми GPU; вызывается до отрисовки.
+  void Flush();
+
+  // Привязывает участок allocation, начиная с offset байт от его начала,
+  // к точке привязки index.
+  void Bind(GLuint index, const UniformAllocation& allocation,
+            GLintptr offset, GLsizeiptr size);
+
+  void EndFrame();
+
+  bool IsPersistent() const;
+  std::size_t GetAlignment() const;
+  // Сколько раз BeginFrame пришлось ждать GPU.
+  std::size_t GetWaitCount() const;
+
+ private:
+  GlStateCache& state_;
+  const GlDispatch& gl_;
+
+  std::size_t frame_capacity_;
+  std::size_t alignment_;
+  GLuint buffer_;
+  // постоянное отображение всего буфера или nullptr
+  unsigned char* mapping_;
+  // данные кадра без постоянного отображения
+  std::vector<unsigned char> staging_;
+
+  std::vector<GLsync> fences_;
+  unsigned int frame_;
+  std::size_t used_size_;
+  std::size_t flushed_size_;
+  std::size_t wait_count_;
+};
@@ -6,6 +6,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <glm/matrix.hpp>
+
 extern const int kWindowWidth;
 extern const int kWindowHeight;
 extern const char* kWindowTitle;
@@ -17,6 +19,8 @@ extern const std::string kPathPrefix;
 extern const std::string kVertexShaderPath;
 extern const std::string kFragmentShaderPath;
 extern const std::string kTexturePath;
+// каталог кэша скомпонованных программ по умолчанию (см. ShaderCache)
+extern const std::string kShaderCacheDirectory;
 
 extern unsigned int kCylinderSectorCount;
 
@@ -30,13 +34,33 @@ extern const float kBetaChanging;
 extern const float kXVelocity;
 extern const float kYVelocity;
 
+// Изображение в памяти: строки сверху вниз, каналы каждого пикселя подряд.
+struct Image {
+  int width;
+  int height;
+  int channels;
+  std::vector<unsigned char> pixels;
+};
+
+// Изображение в чужой памяти в том же формате, что и Image.
+struct ImageView {
+  int width;
+  int height;
+  int channels;
+  const unsigned char* pixels;
+};
+
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void ProcessInput(GLFWwindow* window, float& alpha, float& beta);
 
-unsigned int CreateShaderProgram(const char* vertex_shader_path,
-                                 const char* fragment_shader_path);
+// Если рядом с изображением лежит подготовленный контейнер (см.
+// GetTextureContainerPath), текстура загружается из него без декодирования.
 unsigned int CreateTexture(const char* texture_path);
+// Создаёт текстуру из готовых уровней детализации, начиная с нулевого.
+unsigned int CreateTexture(const std::vector<ImageView>& levels);
+bool LoadImage(const char* image_path, Image& image);
 
+// Возвращают пустые векторы, если секторов меньше 3.
 std::vector<double> CreateCylinderCoordinates(unsigned int sector_count,
                                               double radius, double height);
 std::vector<unsigned int> CreateCylinderIndices(unsigned int sector_count);
@@ -44,3 +68,6 @@ std::vector<unsigned int> CreateCylinderIndices(unsigned int sector_count);
 void UpdatePosition(float& x_offset, float& y_offset,
                     int& x_direction, int& y_direction);
 
+glm::mat4 CreateTransform(float x_offset, float y_offset,
+                          float alpha, float beta);
+
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Число координат одной вершины во входных данных: 3 позиционные и 2
+// текстурные (см. CreateCylinderCoordinates).
+constexpr std::size_t kVertexCoordinateCount { 5 };
+
+std::uint16_t EncodeHalf(float value);
+float DecodeHalf(std::uint16_t half);
+
+// Кодировки одной компоненты вершинного атрибута. Каждая кодировка задаёт тип
+// хранения, соответствующие ему параметры glVertexAttribPointer и функции
+// преобразования из double и обратно.
+
+struct FloatEncoding {
+  using Component = float;
+
+  static constexpr GLenum kType { GL_FLOAT };
+  static constexpr GLboolean kNormalized { GL_FALSE };
+
+  static Component Encode(double value) {
+    return static_cast<float>(value);
+  }
+
+  static double Decode(Component component) {
+    return component;
+  }
+};
+
+struct HalfEncoding {
+  using Component = std::uint16_t;
+
+  static constexpr GLenum kType { GL_HALF_FLOAT };
+  static constexpr GLboolean kNormalized { GL_FALSE };
+
+  static Component Encode(double value) {
+    return EncodeHalf(static_cast<float>(value));
+  }
+
+  static double Decode(Component component) {
+    return DecodeHalf(component);
+  }
+};
+
+// Знаковое нормализованное 16-битное целое: значение из [-1; 1]
+// отображается в [-32767; 32767] (правило преобразования OpenGL 4.2+).
+struct Snorm16Encoding {
+  using Component = std::int16_t;
+
+  static constexpr GLenum kType { GL_SHORT };
+  static constexpr GLboolean kNormalized { GL_TRUE };
+
+  static Component Encode(double value) {
+    assert(value >= -1.0 && value <= 1.0);
+    const double kClamped { std::clamp(value, -1.0, 1.0) };
+    return static_cast<Component>(std::lround(kClamped * 32767.0));
+  }
+
+  static double Decode(Component component) {
+    return std::max(component / 32767.0, -1.0);
+  }
+};
+
+// Формат вершины: позиция из 3 компонент и текстурные координаты из 2
+// компонент. Позиция 16-битных кодировок дополняется четвёртой компонентой,
+// чтобы каждый атрибут начинался на границе 4 байт.
+template <typename PositionEncoding, typename TextureEncoding>
+struct VertexFormat {
+  using PositionComponent = typename PositionEncoding::Component;
+  using TextureComponent = typename TextureEncoding::Component;
+
+  static constexpr std::size_t kPositionSize { 3 };
+  static constexpr std::size_t kPositionStorage {
+    sizeof(PositionComponent) % 4 == 0 ? 3 : 4
+  };
+  static constexpr std::size_t kTextureSize { 2 };
+
+  struct Vertex {
+    PositionComponent position[kPositionStorage];
+    TextureComponent texture[kTextureSize];
+  };
+
+  static constexpr GLsizei kStride { sizeof(Vertex) };
+
+  // Настраивает атрибуты 0 (позиция) и 1 (текстурные координаты) для
+  // текущих VAO и GL_ARRAY_BUFFER.
+  static void SetupAttributes() {
+    void* position_offset {
+      reinterpret_cast<void*>(offsetof(Vertex, position))
+    };
+    glVertexAttribPointer(0, kPositionSize, PositionEncoding::kType,
+                          PositionEncoding::kNormalized, kStride,
+                          position_offset);
+    glEnableVertexAttribArray(0);
+
+    void* texture_offset {
+      reinterpret_cast<void*>(offsetof(Vertex, texture))
+    };
+    glVertexAttribPointer(1, kTextureSize, TextureEncoding::kType,
+                          TextureEncoding::kNormalized, kStride,
+                          texture_offset);
+    glEnableVertexAttribArray(1);
+  }
+
+  // Кодирует vertex_count вершин из чередующихся координат (по
+  // kVertexCoordinateCount на вершину) в вершины формата.
+  static void Encode(const double* coordinates, std::size_t vertex_count,
+                     Vertex* vertices) {
+    for (std::size_t i { 0 }; i < vertex_count; i++) {
+      const double* source { coordinates + i * kVertexCoordinateCount };
+      Vertex& vertex { vertices[i] };
+
+      for (std::size_t k { 0 }; k < kPositionSize; k++) {
+        vertex.position[k] = PositionEncoding::Encode(source[k]);
+      }
+      for (std::size_t k { kPositionSize }; k < kPositionStorage; k++) {
+        vertex.position[k] = PositionEncoding::Encode(0.0);
+      }
+
+      for (std::size_t k { 0 }; k < kTextureSize; k++) {
+        vertex.texture[k] = TextureEncoding::Encode(source[kPositionSize + k]);
+      }
+    }
+  }
+
+  static std::vector<Vertex> Encode(const std::vector<double>& coordinates) {
+    assert(coordinates.size() % kVertexCoordinateCount == 0);
+
+    std::vector<Vertex> vertices(coordinates.size() / kVertexCoordinateCount);
+    Encode(coordinates.data(), vertices.size(), vertices.data());
+
+    return vertices;
+  }
+
+  // Максимальная абсолютная погрешность кодирования позиционных и текстурных
+  // координат соответственно.
+  struct EncodingError {
+    double position;
+    double texture;
+  };
+
+  static EncodingError MeasureError(const std::vector<double>& coordinates,
+                                    const std::vector<Vertex>& vertices) {
+    assert(coordinates.size() == vertices.size() * kVertexCoordinateCount);
+
+    EncodingError error { 0.0, 0.0 };
+    for (std::size_t i { 0 }; i < vertices.size(); i++) {
+      const double* source { coordinates.data() + i * kVertexCoordinateCount };
+      const Vertex& vertex { vertices[i] };
+
+      for (std::size_t k { 0 }; k < kPositionSize; k++) {
+        const double kDecoded { PositionEncoding::Decode(vertex.position[k]) };
+        error.position = std::max(error.position,
+                                  std::abs(kDecoded - source[k]));
+      }
+
+      for (std::size_t k { 0 }; k < kTextureSize; k++) {
+        const double kDecoded { TextureEncoding::Decode(vertex.texture[k]) };
+        error.texture = std::max(
+            error.texture, std::abs(kDecoded - source[kPositionSize + k]));
+      }
+    }
+
+    return error;
+  }
+};
+
+using FloatVertexFormat = VertexFormat<FloatEncoding, FloatEncoding>;
+using HalfVertexFormat = VertexFormat<HalfEncoding, HalfEncoding>;
+using Snorm16VertexFormat = VertexFormat<Snorm16Encoding, Snorm16Encoding>;
+
+static_assert(sizeof(FloatVertexFormat::Vertex) == 20);
+static_assert(sizeof(HalfVertexFormat::Vertex) == 12);
+static_assert(sizeof(Snorm16VertexFormat::Vertex) == 12);
+
+// Формат вершин, используемый при сборке, выбирается параметром CMake
+// LAB8_VERTEX_FORMAT.
+#if defined(LAB8_VERTEX_FORMAT_FLOAT)
+using CylinderVertexFormat = FloatVertexFormat;
+#elif defined(LAB8_VERTEX_FORMAT_SNORM16)
+using CylinderVertexFormat = Snorm16VertexFormat;
+#else
+using CylinderVertexFormat = HalfVertexFormat;
+#endif
@@ -0,0 +1,128 @@
+#include "cylinder_lod.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+std::vector<unsigned int> CreateLodSectorCounts(
+    unsigned int max_sector_count, unsigned int min_sector_count) {
+  assert(min_sector_count >= 3);
+
+  std::vector<unsigned int> sector_counts;
+  for (unsigned int count { max_sector_count }; count >= min_sector_count;
+       count = (count + 1) / 2) {
+    sector_counts.push_back(count);
+    if (count == min_sector_count) {
+      break;
+    }
+  }
+
+  return sector_counts;
+}
+
+CylinderLod::CylinderLod(std::vector<unsigned int> sector_counts,
+                         float radius, float max_error, float hysteresis)
+    : sector_counts_ { std::move(sector_counts) },
+      radius_ { radius },
+      max_error_ { max_error },
+      hysteresis_ { hysteresis } {
+  assert(!sector_counts_.empty());
+  assert(sector_counts_.size() <= std::numeric_limits<unsigned char>::max());
+
+  relative_errors_.reserve(sector_counts_.size());
+  for (unsigned int count : sector_counts_) {
+    relative_errors_.push_back(
+        static_cast<float>(1.0 - std::cos(M_PI / count)));
+  }
+}
+
+std::size_t CylinderLod::GetLevelCount() const {
+  return sector_counts_.size();
+}
+
+unsigned int CylinderLod::GetSectorCount(std::size_t level) const {
+  return sector_counts_[level];
+}
+
+float CylinderLod::GetProjectedRadius(const float* transform, float width,
+                                      float height) const {
+  // Сечение цилиндра лежит в плоскости локальных осей x и y, то есть
+  // переводится на экран матрицей 2x2 из первых двух столбцов transform.
+  // Её наибольшее сингулярное значение -- наибольшее растяжение окружности.
+  const float kW { std::abs(transform[15]) };
+  if (kW <= std::numeric_limits<float>::epsilon()) {
+    return std::numeric_limits<float>::infinity();
+  }
+
+  const float kXScale { 0.5f * width / kW };
+  const float kYScale { 0.5f * height / kW };
+  const float kA { transform[0] * kXScale };
+  const float kB { transform[4] * kXScale };
+  const float kC { transform[1] * kYScale };
+  const float kD { transform[5] * kYScale };
+
+  const float kTrace { kA * kA + kB * kB + kC * kC + kD * kD };
+  const float kDeterminant { kA * kD - kB * kC };
+  const float kDiscriminant {
+    std::max(0.0f, kTrace * kTrace - 4.0f * kDeterminant * kDeterminant)
+  };
+
+  return radius_ * std::sqrt(0.5f * (kTrace + std::sqrt(kDiscriminant)));
+}
+
+float CylinderLod::GetError(std::size_t level, float projected_radius) const {
+  return relative_errors_[level] * projected_radius;
+}
+
+std::size_t CylinderLod::SelectLevel(float projected_radius,
+                                     std::size_t current_level) const {
+  // самые грубые уровни, допустимые без запаса и с запасом hysteresis
+  std::size_t coarsest { 0 };
+  std::size_t coarsest_with_margin { 0 };
+  for (std::size_t level { 0 }; level < sector_counts_.size(); level++) {
+    const float kError { GetError(level, projected_radius) };
+    if (kError <= max_error_) {
+      coarsest = level;
+    }
+    if (kError <= max_error_ * hysteresis_) {
+      coarsest_with_margin = level;
+    }
+  }
+
+  if (current_level > coarsest) {
+    return coarsest;
+  }
+  if (current_level < coarsest_with_margin) {
+    return coarsest_with_margin;
+  }
+  return current_level;
+}
+
+void CylinderLod::SelectLevels(const float* transforms, std::size_t count,
+                               float width, float height,
+                               std::vector<unsigned char>& levels) const {
+  levels.resize(count, 0);
+
+  for (std::size_t i { 0 }; i < count; i++) {
+    const float kProjectedRadius {
+      GetProjectedRadius(transforms + 16 * i, width, height)
+    };
+    levels[i] = static_cast<unsigned char>(
+        SelectLevel(kProjectedRadius, levels[i]));
+  }
+}
+
+void CylinderLod::SelectLevels(const float* transforms,
+                               const std::uint32_t* indices,
+                               std::size_t count, float width, float height,
+                               std::vector<unsigned char>& levels) const {
+  for (std::size_t i { 0 }; i < count; i++) {
+    const float kProjectedRadius {
+      GetProjectedRadius(transforms + 16 * i, width, height)
+    };
+    unsigned char& level { levels[indices[i]] };
+    level = static_cast<unsigned char>(SelectLevel(kProjectedRadius, level));
+  }
+}
@@ -0,0 +1,38 @@
+#include "draw_commands.hpp"
+
+void DrawCommandBuilder::Clear() {
+  commands_.clear();
+  runs_.clear();
+}
+
+void DrawCommandBuilder::Add(GLenum mode,
+                             const DrawElementsIndirectCommand& command) {
+  if (command.instance_count == 0) {
+    return;
+  }
+
+  if (!runs_.empty() && runs_.back().mode == mode) {
+    DrawElementsIndirectCommand& last { commands_.back() };
+    if (last.count == command.count &&
+        last.first_index == command.first_index &&
+        last.base_vertex == command.base_vertex &&
+        last.base_instance + last.instance_count == command.base_instance) {
+      last.instance_count += command.instance_count;
+      return;
+    }
+    runs_.back().count++;
+  } else {
+    runs_.push_back(DrawCommandRun { mode, commands_.size(), 1 });
+  }
+
+  commands_.push_back(command);
+}
+
+const std::vector<DrawElementsIndirectCommand>&
+DrawCommandBuilder::GetCommands() const {
+  return commands_;
+}
+
+const std::vector<DrawCommandRun>& DrawCommandBuilder::GetRuns() const {
+  return runs_;
+}
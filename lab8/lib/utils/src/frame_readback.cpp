@@ -0,0 +1,159 @@
+#include "frame_readback.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "profiler.hpp"
+
+namespace {
+
+constexpr int kChannels { 4 };
+
+// ожидание барьера порциями по одной секунде
+constexpr GLuint64 kWaitTimeout { 1000000000 };
+
+}  // namespace
+
+FrameReadback::FrameReadback(GLsizei width, GLsizei height,
+                             std::size_t ring_size)
+    : width_ { width },
+      height_ { height },
+      slots_(std::max<std::size_t>(1, ring_size), Slot { 0, nullptr, 0 }),
+      first_ { 0 },
+      pending_count_ { 0 },
+      stall_time_ { 0 } {
+  glGenRenderbuffers(1, &color_buffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, color_buffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+
+  glGenRenderbuffers(1, &depth_buffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_,
+                        height_);
+
+  glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color_buffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_buffer_);
+
+  const GLsizeiptr kFrameSize {
+    static_cast<GLsizeiptr>(width_) * height_ * kChannels
+  };
+  for (Slot& slot : slots_) {
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, kFrameSize, nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameReadback::~FrameReadback() {
+  for (Slot& slot : slots_) {
+    if (slot.fence) {
+      glDeleteSync(slot.fence);
+    }
+    glDeleteBuffers(1, &slot.buffer);
+  }
+
+  glDeleteFramebuffers(1, &framebuffer_);
+  glDeleteRenderbuffers(1, &color_buffer_);
+  glDeleteRenderbuffers(1, &depth_buffer_);
+}
+
+bool FrameReadback::IsComplete() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void FrameReadback::Bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, width_, height_);
+}
+
+void FrameReadback::Queue(std::uint64_t frame) {
+  assert(!IsFull());
+
+  Slot& slot { slots_[(first_ + pending_count_) % slots_.size()] };
+  slot.frame = frame;
+
+  // с привязанным буфером пикселей glReadPixels только ставит копирование
+  // в очередь GPU
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // барьер должен дойти до GPU, иначе Pop будет ждать его вечно
+  glFlush();
+
+  pending_count_++;
+}
+
+bool FrameReadback::IsFull() const {
+  return pending_count_ == slots_.size();
+}
+
+std::size_t FrameReadback::GetPendingCount() const {
+  return pending_count_;
+}
+
+bool FrameReadback::Pop(Image& image, std::uint64_t& frame) {
+  if (pending_count_ == 0) {
+    return false;
+  }
+
+  Slot& slot { slots_[first_] };
+
+  GLenum result { glClientWaitSync(slot.fence, 0, 0) };
+  if (result == GL_TIMEOUT_EXPIRED) {
+    LAB8_PROFILE_SCOPE("ReadbackStall");
+    const auto kStart { std::chrono::steady_clock::now() };
+    while (result == GL_TIMEOUT_EXPIRED) {
+      result = glClientWaitSync(slot.fence, 0, kWaitTimeout);
+    }
+    stall_time_ += std::chrono::steady_clock::now() - kStart;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  const std::size_t kRowSize {
+    static_cast<std::size_t>(width_) * kChannels
+  };
+
+  image.width = width_;
+  image.height = height_;
+  image.channels = kChannels;
+  image.pixels.resize(kRowSize * height_);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  const unsigned char* pixels {
+    static_cast<const unsigned char*>(glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0,
+        static_cast<GLsizeiptr>(kRowSize * height_), GL_MAP_READ_BIT))
+  };
+  if (pixels) {
+    // OpenGL хранит строки снизу вверх
+    for (GLsizei y { 0 }; y < height_; y++) {
+      std::memcpy(image.pixels.data() + y * kRowSize,
+                  pixels + (height_ - 1 - y) * kRowSize, kRowSize);
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  frame = slot.frame;
+  first_ = (first_ + 1) % slots_.size();
+  pending_count_--;
+
+  return pixels != nullptr;
+}
+
+std::chrono::nanoseconds FrameReadback::GetStallTime() const {
+  return stall_time_;
+}
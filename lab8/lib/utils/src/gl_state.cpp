@@ -0,0 +1,181 @@
+#include "gl_state.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// имя объекта, привязка которого неизвестна
+constexpr GLuint kUnknown { ~0u };
+
+}  // namespace
+
+GlDispatch LoadGlDispatch() {
+  GlDispatch dispatch { };
+  dispatch.use_program = glUseProgram;
+  dispatch.bind_vertex_array = glBindVertexArray;
+  dispatch.active_texture = glActiveTexture;
+  dispatch.bind_texture = glBindTexture;
+  dispatch.bind_buffer = glBindBuffer;
+  dispatch.bind_buffer_range = glBindBufferRange;
+  dispatch.gen_buffers = glGenBuffers;
+  dispatch.delete_buffers = glDeleteBuffers;
+  dispatch.buffer_data = glBufferData;
+  dispatch.buffer_storage = GLAD_GL_VERSION_4_4 ? glBufferStorage : nullptr;
+  dispatch.map_buffer_range = glMapBufferRange;
+  dispatch.unmap_buffer = glUnmapBuffer;
+  dispatch.fence_sync = glFenceSync;
+  dispatch.client_wait_sync = glClientWaitSync;
+  dispatch.delete_sync = glDeleteSync;
+  dispatch.get_integerv = glGetIntegerv;
+  return dispatch;
+}
+
+GlStateCache::GlStateCache(const GlDispatch& dispatch)
+    : dispatch_ { dispatch },
+      request_count_ { 0 },
+      elided_count_ { 0 } {
+  Invalidate();
+}
+
+void GlStateCache::UseProgram(GLuint program) {
+  if (Elide(program_ == program)) {
+    return;
+  }
+
+  dispatch_.use_program(program);
+  program_ = program;
+}
+
+void GlStateCache::BindVertexArray(GLuint vertex_array) {
+  if (Elide(vertex_array_ == vertex_array)) {
+    return;
+  }
+
+  dispatch_.bind_vertex_array(vertex_array);
+  vertex_array_ = vertex_array;
+
+  // привязка индексного буфера принадлежит массиву вершин
+  buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                [](const BufferBinding& binding) {
+                                  return binding.target ==
+                                         GL_ELEMENT_ARRAY_BUFFER;
+                                }),
+                 buffers_.end());
+}
+
+void GlStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+  if (unit >= textures_.size()) {
+    textures_.resize(unit + 1, TextureBinding { 0, kUnknown });
+  }
+
+  TextureBinding& binding { textures_[unit] };
+  if (Elide(binding.target == target && binding.texture == texture)) {
+    return;
+  }
+
+  if (active_unit_ != unit) {
+    dispatch_.active_texture(GL_TEXTURE0 + unit);
+    active_unit_ = unit;
+  }
+  dispatch_.bind_texture(target, texture);
+  binding = TextureBinding { target, texture };
+}
+
+void GlStateCache::BindBuffer(GLenum target, GLuint buffer) {
+  auto iterator {
+    std::find_if(buffers_.begin(), buffers_.end(),
+                 [target](const BufferBinding& binding) {
+                   return binding.target == target;
+                 })
+  };
+  if (Elide(iterator != buffers_.end() && iterator->buffer == buffer)) {
+    return;
+  }
+
+  dispatch_.bind_buffer(target, buffer);
+  if (iterator != buffers_.end()) {
+    iterator->buffer = buffer;
+  } else {
+    buffers_.push_back(BufferBinding { target, buffer });
+  }
+}
+
+void GlStateCache::BindBufferRange(GLenum target, GLuint index,
+                                   GLuint buffer, GLintptr offset,
+                                   GLsizeiptr size) {
+  auto iterator {
+    std::find_if(indexed_buffers_.begin(), indexed_buffers_.end(),
+                 [target, index](const IndexedBinding& binding) {
+                   return binding.target == target && binding.index == index;
+                 })
+  };
+  if (Elide(iterator != indexed_buffers_.end() &&
+            iterator->buffer == buffer && iterator->offset == offset &&
+            iterator->size == size)) {
+    return;
+  }
+
+  dispatch_.bind_buffer_range(target, index, buffer, offset, size);
+  const IndexedBinding kBinding { target, index, buffer, offset, size };
+  if (iterator != indexed_buffers_.end()) {
+    *iterator = kBinding;
+  } else {
+    indexed_buffers_.push_back(kBinding);
+  }
+
+  // glBindBufferRange привязывает буфер и к самой цели
+  auto generic {
+    std::find_if(buffers_.begin(), buffers_.end(),
+                 [target](const BufferBinding& binding) {
+                   return binding.target == target;
+                 })
+  };
+  if (generic != buffers_.end()) {
+    generic->buffer = buffer;
+  } else {
+    buffers_.push_back(BufferBinding { target, buffer });
+  }
+}
+
+void GlStateCache::Invalidate() {
+  program_ = kUnknown;
+  vertex_array_ = kUnknown;
+  active_unit_ = kUnknown;
+  textures_.clear();
+  buffers_.clear();
+  indexed_buffers_.clear();
+}
+
+void GlStateCache::ForgetBuffer(GLuint buffer) {
+  buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                [buffer](const BufferBinding& binding) {
+                                  return binding.buffer == buffer;
+                                }),
+                 buffers_.end());
+  indexed_buffers_.erase(
+      std::remove_if(indexed_buffers_.begin(), indexed_buffers_.end(),
+                     [buffer](const IndexedBinding& binding) {
+                       return binding.buffer == buffer;
+                     }),
+      indexed_buffers_.end());
+}
+
+const GlDispatch& GlStateCache::GetDispatch() const {
+  return dispatch_;
+}
+
+std::size_t GlStateCache::GetRequestCount() const {
+  return request_count_;
+}
+
+std::size_t GlStateCache::GetElidedCount() const {
+  return elided_count_;
+}
+
+bool GlStateCache::Elide(bool unchanged) {
+  request_count_++;
+  if (unchanged) {
+    elided_count_++;
+  }
+  return unchanged;
+}
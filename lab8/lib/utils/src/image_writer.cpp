@@ -0,0 +1,275 @@
+#include "image_writer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <utility>
+
+#include <zlib.h>
+
+#include "profiler.hpp"
+
+namespace {
+
+void AppendUint32(std::vector<unsigned char>& data, std::uint32_t value) {
+  data.push_back(static_cast<unsigned char>(value >> 24));
+  data.push_back(static_cast<unsigned char>(value >> 16));
+  data.push_back(static_cast<unsigned char>(value >> 8));
+  data.push_back(static_cast<unsigned char>(value));
+}
+
+void AppendChunk(std::vector<unsigned char>& png, const char* type,
+                 const unsigned char* data, std::size_t size) {
+  AppendUint32(png, static_cast<std::uint32_t>(size));
+
+  const std::size_t kTypeOffset { png.size() };
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data, data + size);
+
+  // контрольная сумма охватывает тип и данные
+  const uLong kCrc {
+    crc32(0, png.data() + kTypeOffset, static_cast<uInt>(size + 4))
+  };
+  AppendUint32(png, static_cast<std::uint32_t>(kCrc));
+}
+
+bool HasExtension(const std::string& path, const char* extension) {
+  const std::size_t kDot { path.find_last_of('.') };
+  if (kDot == std::string::npos) {
+    return false;
+  }
+
+  std::string suffix { path.substr(kDot + 1) };
+  std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](char c) {
+    return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+  });
+  return suffix == extension;
+}
+
+bool WriteFile(const std::string& path, const unsigned char* data,
+               std::size_t size) {
+  std::FILE* file { std::fopen(path.c_str(), "wb") };
+  if (!file) {
+    return false;
+  }
+
+  std::fwrite(data, 1, size, file);
+  const bool kSuccess { !std::ferror(file) };
+  return std::fclose(file) == 0 && kSuccess;
+}
+
+std::vector<unsigned char> EncodePpm(const ImageView& image) {
+  char header[64] { };
+  const int kHeaderSize {
+    std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", image.width,
+                  image.height)
+  };
+
+  std::vector<unsigned char> ppm(header, header + kHeaderSize);
+  ppm.reserve(ppm.size() +
+              static_cast<std::size_t>(image.width) * image.height * 3);
+
+  const std::size_t kPixelCount {
+    static_cast<std::size_t>(image.width) * image.height
+  };
+  for (std::size_t i { 0 }; i < kPixelCount; i++) {
+    const unsigned char* pixel { image.pixels + i * image.channels };
+    for (int c { 0 }; c < 3; c++) {
+      // в одно- и двухканальных изображениях первый канал -- яркость
+      ppm.push_back(pixel[image.channels >= 3 ? c : 0]);
+    }
+  }
+
+  return ppm;
+}
+
+}  // namespace
+
+std::vector<unsigned char> EncodePng(const ImageView& image,
+                                     int compression_level) {
+  // тип цвета PNG для 1-4 каналов: яркость, яркость с альфой, RGB, RGBA
+  constexpr unsigned char kColorTypes[] { 0, 4, 2, 6 };
+
+  const std::size_t kRowSize {
+    static_cast<std::size_t>(image.width) * image.channels
+  };
+
+  // каждая строка начинается с номера фильтра; 1 -- разность с левым
+  // пикселем, хорошо подходящая для отрисованных кадров
+  std::vector<unsigned char> filtered((kRowSize + 1) * image.height);
+  for (int y { 0 }; y < image.height; y++) {
+    const unsigned char* source { image.pixels + y * kRowSize };
+    unsigned char* destination { filtered.data() + y * (kRowSize + 1) };
+
+    destination[0] = 1;
+    std::copy(source, source + image.channels, destination + 1);
+    for (std::size_t i { static_cast<std::size_t>(image.channels) };
+         i < kRowSize; i++) {
+      destination[i + 1] =
+          static_cast<unsigned char>(source[i] - source[i - image.channels]);
+    }
+  }
+
+  uLongf compressed_size {
+    compressBound(static_cast<uLong>(filtered.size()))
+  };
+  std::vector<unsigned char> compressed(compressed_size);
+  if (compress2(compressed.data(), &compressed_size, filtered.data(),
+                static_cast<uLong>(filtered.size()),
+                compression_level) != Z_OK) {
+    return { };
+  }
+
+  std::vector<unsigned char> header { };
+  AppendUint32(header, static_cast<std::uint32_t>(image.width));
+  AppendUint32(header, static_cast<std::uint32_t>(image.height));
+  // 8 бит на канал, тип цвета, сжатие, фильтрация и без чересстрочности
+  header.push_back(8);
+  header.push_back(kColorTypes[image.channels - 1]);
+  header.push_back(0);
+  header.push_back(0);
+  header.push_back(0);
+
+  std::vector<unsigned char> png { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a,
+                                   '\n' };
+  png.reserve(png.size() + compressed_size + 64);
+  AppendChunk(png, "IHDR", header.data(), header.size());
+  AppendChunk(png, "IDAT", compressed.data(), compressed_size);
+  AppendChunk(png, "IEND", nullptr, 0);
+
+  return png;
+}
+
+bool WriteImage(const std::string& path, const ImageView& image) {
+  const std::vector<unsigned char> kData {
+    HasExtension(path, "png") ? EncodePng(image) : EncodePpm(image)
+  };
+
+  if (kData.empty() || !WriteFile(path, kData.data(), kData.size())) {
+    std::cerr << "Failed to write " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+std::string GetSequencePath(const std::string& pattern, std::size_t index) {
+  std::string number { std::to_string(index) };
+
+  const std::size_t kFirst { pattern.find('#') };
+  if (kFirst == std::string::npos) {
+    const std::size_t kDot { pattern.find_last_of('.') };
+    const std::size_t kSlash { pattern.find_last_of('/') };
+    if (kDot == std::string::npos ||
+        (kSlash != std::string::npos && kDot < kSlash)) {
+      return pattern + number;
+    }
+    return pattern.substr(0, kDot) + number + pattern.substr(kDot);
+  }
+
+  const std::size_t kLast { pattern.find_first_not_of('#', kFirst) };
+  const std::size_t kWidth {
+    (kLast == std::string::npos ? pattern.size() : kLast) - kFirst
+  };
+  if (number.size() < kWidth) {
+    number.insert(0, kWidth - number.size(), '0');
+  }
+
+  return pattern.substr(0, kFirst) + number + pattern.substr(kFirst + kWidth);
+}
+
+ImageWriter::ImageWriter(unsigned int thread_count,
+                         std::size_t queue_capacity)
+    : queue_capacity_ { std::max<std::size_t>(1, queue_capacity) },
+      pending_ { 0 },
+      stopping_ { false },
+      failure_count_ { 0 } {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    thread_count = std::max(1u, thread_count);
+  }
+
+  for (unsigned int i { 0 }; i < thread_count; i++) {
+    workers_.emplace_back(&ImageWriter::WorkerLoop, this);
+  }
+}
+
+ImageWriter::~ImageWriter() {
+  Wait();
+
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    stopping_ = true;
+  }
+  request_condition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ImageWriter::Submit(std::string path, Image image) {
+  {
+    std::unique_lock<std::mutex> lock { mutex_ };
+    space_condition_.wait(lock, [this] {
+      return requests_.size() < queue_capacity_;
+    });
+    requests_.push_back(Request { std::move(path), std::move(image) });
+    pending_++;
+  }
+  request_condition_.notify_one();
+}
+
+void ImageWriter::Wait() {
+  std::unique_lock<std::mutex> lock { mutex_ };
+  done_condition_.wait(lock, [this] {
+    return pending_ == 0;
+  });
+}
+
+std::size_t ImageWriter::GetFailureCount() const {
+  return failure_count_.load(std::memory_order_relaxed);
+}
+
+unsigned int ImageWriter::GetThreadCount() const {
+  return static_cast<unsigned int>(workers_.size());
+}
+
+void ImageWriter::WorkerLoop() {
+  while (true) {
+    Request request { };
+    {
+      std::unique_lock<std::mutex> lock { mutex_ };
+      request_condition_.wait(lock, [this] {
+        return stopping_ || !requests_.empty();
+      });
+      if (requests_.empty()) {
+        return;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+    }
+    space_condition_.notify_one();
+
+    {
+      LAB8_PROFILE_SCOPE("WriteImage");
+      const ImageView kView {
+        request.image.width, request.image.height, request.image.channels,
+        request.image.pixels.data()
+      };
+      if (!WriteImage(request.path, kView)) {
+        failure_count_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    bool done { false };
+    {
+      std::lock_guard<std::mutex> lock { mutex_ };
+      done = --pending_ == 0;
+    }
+    if (done) {
+      done_condition_.notify_all();
+    }
+  }
+}
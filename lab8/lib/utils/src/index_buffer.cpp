@@ -0,0 +1,441 @@
+#include "index_buffer.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Параметры алгоритма Форсайта: размер моделируемого LRU-кэша, вес вершин
+// последнего треугольника, степень убывания веса с позицией в кэше и
+// параметры прибавки за число оставшихся треугольников вершины.
+constexpr std::size_t kOptimizerCacheSize { 32 };
+constexpr float kLastTriangleScore { 0.75f };
+constexpr float kCacheDecayPower { 1.5f };
+constexpr float kValenceBoostScale { 2.0f };
+constexpr float kValenceBoostPower { 0.5f };
+
+float ComputeVertexScore(int cache_position,
+                         unsigned int remaining_triangles) {
+  if (remaining_triangles == 0) {
+    return -1.0f;
+  }
+
+  float score { 0.0f };
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // Вершины только что выведенного треугольника получают фиксированный
+      // вес, чтобы не поощрять вывод треугольников с теми же рёбрами.
+      score = kLastTriangleScore;
+    } else {
+      const float kScale { 1.0f / (kOptimizerCacheSize - 3.0f) };
+      score = std::pow(1.0f - (cache_position - 3) * kScale,
+                       kCacheDecayPower);
+    }
+  }
+
+  // Вершины с небольшим числом оставшихся треугольников выгодно закончить
+  // раньше, чтобы не возвращаться к ним после вытеснения из кэша.
+  score += kValenceBoostScale *
+           std::pow(static_cast<float>(remaining_triangles),
+                    -kValenceBoostPower);
+
+  return score;
+}
+
+// Веса вершин для типичных значений аргументов вычисляются заранее: вызовы
+// std::pow иначе занимают большую часть времени оптимизации.
+constexpr unsigned int kScoreTableValenceCount { 32 };
+
+struct VertexScoreTable {
+  float scores[kOptimizerCacheSize + 1][kScoreTableValenceCount];
+
+  VertexScoreTable() {
+    for (std::size_t position { 0 }; position <= kOptimizerCacheSize;
+         position++) {
+      for (unsigned int valence { 0 }; valence < kScoreTableValenceCount;
+           valence++) {
+        scores[position][valence] =
+            ComputeVertexScore(static_cast<int>(position) - 1, valence);
+      }
+    }
+  }
+};
+
+float GetVertexScore(int cache_position, unsigned int remaining_triangles) {
+  static const VertexScoreTable kTable { };
+
+  if (remaining_triangles >= kScoreTableValenceCount) {
+    return ComputeVertexScore(cache_position, remaining_triangles);
+  }
+  return kTable.scores[cache_position + 1][remaining_triangles];
+}
+
+// Списки треугольников, содержащих каждую вершину, в формате CSR.
+struct VertexTriangles {
+  std::vector<unsigned int> offsets;
+  std::vector<unsigned int> triangles;
+
+  VertexTriangles(const std::vector<unsigned int>& indices,
+                  std::size_t vertex_count)
+      : offsets(vertex_count + 1),
+        triangles(indices.size()) {
+    for (unsigned int index : indices) {
+      assert(index < vertex_count);
+      offsets[index + 1]++;
+    }
+    for (std::size_t i { 0 }; i < vertex_count; i++) {
+      offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<unsigned int> cursors(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i { 0 }; i < indices.size(); i++) {
+      triangles[cursors[indices[i]]++] = i / 3;
+    }
+  }
+
+  unsigned int GetCount(unsigned int vertex) const {
+    return offsets[vertex + 1] - offsets[vertex];
+  }
+};
+
+// Является ли (a, b, c) циклическим сдвигом треугольника triangle.
+bool HasSameWinding(const unsigned int* triangle, unsigned int a,
+                    unsigned int b, unsigned int c) {
+  for (int k { 0 }; k < 3; k++) {
+    if (triangle[k] == a && triangle[(k + 1) % 3] == b &&
+        triangle[(k + 2) % 3] == c) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+unsigned int IndexBuffer::GetIndex(std::size_t i) const {
+  if (type == GL_UNSIGNED_SHORT) {
+    std::uint16_t index { 0 };
+    std::memcpy(&index, data.data() + i * sizeof(index), sizeof(index));
+    return index;
+  }
+
+  std::uint32_t index { 0 };
+  std::memcpy(&index, data.data() + i * sizeof(index), sizeof(index));
+  return index;
+}
+
+std::vector<unsigned int> OptimizeVertexCache(
+    const std::vector<unsigned int>& indices, std::size_t vertex_count) {
+  assert(indices.size() % 3 == 0);
+
+  const std::size_t kTriangleCount { indices.size() / 3 };
+  if (kTriangleCount == 0) {
+    return { };
+  }
+
+  // Из списков треугольников вершин удаляются выведенные треугольники:
+  // первые remaining[v] элементов списка вершины v ещё не выведены.
+  VertexTriangles adjacency { indices, vertex_count };
+  std::vector<unsigned int> remaining(vertex_count);
+  std::vector<float> vertex_scores(vertex_count);
+  for (std::size_t v { 0 }; v < vertex_count; v++) {
+    remaining[v] = adjacency.GetCount(v);
+    vertex_scores[v] = GetVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangle_scores(kTriangleCount);
+  std::vector<bool> emitted(kTriangleCount, false);
+  long best_triangle { 0 };
+  for (std::size_t t { 0 }; t < kTriangleCount; t++) {
+    triangle_scores[t] = vertex_scores[indices[3 * t]] +
+                         vertex_scores[indices[3 * t + 1]] +
+                         vertex_scores[indices[3 * t + 2]];
+    if (triangle_scores[t] > triangle_scores[best_triangle]) {
+      best_triangle = t;
+    }
+  }
+
+  std::vector<unsigned int> cache { };
+  std::vector<unsigned int> new_cache { };
+  cache.reserve(kOptimizerCacheSize + 3);
+  new_cache.reserve(kOptimizerCacheSize + 3);
+
+  std::vector<unsigned int> result { };
+  result.reserve(indices.size());
+
+  // первый невыведенный треугольник для случая, когда в кэше не осталось
+  // вершин с невыведенными треугольниками
+  std::size_t next_unemitted { 0 };
+
+  for (std::size_t i { 0 }; i < kTriangleCount; i++) {
+    if (best_triangle < 0) {
+      while (emitted[next_unemitted]) {
+        next_unemitted++;
+      }
+      best_triangle = next_unemitted;
+    }
+
+    const unsigned int* kTriangle { indices.data() + 3 * best_triangle };
+    result.insert(result.end(), kTriangle, kTriangle + 3);
+    emitted[best_triangle] = true;
+
+    new_cache.assign(kTriangle, kTriangle + 3);
+    for (int k { 0 }; k < 3; k++) {
+      const unsigned int kVertex { kTriangle[k] };
+
+      unsigned int* first { adjacency.triangles.data() +
+                            adjacency.offsets[kVertex] };
+      unsigned int* last { first + remaining[kVertex] - 1 };
+      unsigned int* found { first };
+      while (*found != static_cast<unsigned int>(best_triangle)) {
+        found++;
+      }
+      std::swap(*found, *last);
+      remaining[kVertex]--;
+    }
+
+    for (unsigned int vertex : cache) {
+      if (vertex != kTriangle[0] && vertex != kTriangle[1] &&
+          vertex != kTriangle[2]) {
+        new_cache.push_back(vertex);
+      }
+    }
+
+    // вытесненные вершины
+    for (std::size_t k { kOptimizerCacheSize }; k < new_cache.size(); k++) {
+      vertex_scores[new_cache[k]] = GetVertexScore(-1,
+                                                   remaining[new_cache[k]]);
+    }
+    if (new_cache.size() > kOptimizerCacheSize) {
+      new_cache.resize(kOptimizerCacheSize);
+    }
+
+    for (std::size_t k { 0 }; k < new_cache.size(); k++) {
+      vertex_scores[new_cache[k]] = GetVertexScore(static_cast<int>(k),
+                                                   remaining[new_cache[k]]);
+    }
+
+    // пересчёт весов невыведенных треугольников вершин кэша и выбор лучшего
+    best_triangle = -1;
+    float best_score { -1.0f };
+    for (unsigned int vertex : new_cache) {
+      const unsigned int* kTriangles {
+        adjacency.triangles.data() + adjacency.offsets[vertex]
+      };
+      for (unsigned int k { 0 }; k < remaining[vertex]; k++) {
+        const unsigned int kT { kTriangles[k] };
+        triangle_scores[kT] = vertex_scores[indices[3 * kT]] +
+                              vertex_scores[indices[3 * kT + 1]] +
+                              vertex_scores[indices[3 * kT + 2]];
+        if (triangle_scores[kT] > best_score) {
+          best_score = triangle_scores[kT];
+          best_triangle = kT;
+        }
+      }
+    }
+
+    std::swap(cache, new_cache);
+  }
+
+  return result;
+}
+
+std::vector<unsigned int> CreateTriangleStrips(
+    const std::vector<unsigned int>& indices, std::size_t vertex_count,
+    unsigned int restart_index, bool preserve_winding) {
+  assert(indices.size() % 3 == 0);
+
+  const std::size_t kTriangleCount { indices.size() / 3 };
+  const VertexTriangles kAdjacency { indices, vertex_count };
+  std::vector<bool> used(kTriangleCount, false);
+
+  // Ищет невыведенный треугольник с ребром (p, q), который можно добавить
+  // в полосу k-м по счёту треугольником. Треугольник полосы с чётным
+  // номером k имеет обход (p, q, r), с нечётным -- (q, p, r).
+  auto find_next = [&](unsigned int p, unsigned int q, std::size_t k,
+                       unsigned int& r) {
+    const unsigned int* kBegin {
+      kAdjacency.triangles.data() + kAdjacency.offsets[q]
+    };
+    const unsigned int* kEnd {
+      kAdjacency.triangles.data() + kAdjacency.offsets[q + 1]
+    };
+
+    for (const unsigned int* t { kBegin }; t != kEnd; t++) {
+      if (used[*t]) {
+        continue;
+      }
+
+      const unsigned int* kTriangle { indices.data() + 3 * *t };
+      for (int m { 0 }; m < 3; m++) {
+        const unsigned int kThird { kTriangle[m] };
+        const unsigned int kA { kTriangle[(m + 1) % 3] };
+        const unsigned int kB { kTriangle[(m + 2) % 3] };
+        if (!((kA == p && kB == q) || (kA == q && kB == p))) {
+          continue;
+        }
+
+        const bool kWindingMatches {
+          k % 2 == 0 ? HasSameWinding(kTriangle, p, q, kThird)
+                     : HasSameWinding(kTriangle, q, p, kThird)
+        };
+        if (preserve_winding && !kWindingMatches) {
+          continue;
+        }
+
+        r = kThird;
+        return static_cast<long>(*t);
+      }
+    }
+
+    return -1L;
+  };
+
+  std::vector<unsigned int> strips { };
+  strips.reserve(indices.size());
+
+  for (std::size_t seed { 0 }; seed < kTriangleCount; seed++) {
+    if (used[seed]) {
+      continue;
+    }
+
+    // Из трёх вариантов начала полосы выбирается тот, который можно
+    // продолжить.
+    const unsigned int* kSeed { indices.data() + 3 * seed };
+    int rotation { 0 };
+    for (int m { 0 }; m < 3; m++) {
+      unsigned int r { 0 };
+      used[seed] = true;
+      const bool kExtendable {
+        find_next(kSeed[(m + 1) % 3], kSeed[(m + 2) % 3], 1, r) >= 0
+      };
+      used[seed] = false;
+      if (kExtendable) {
+        rotation = m;
+        break;
+      }
+    }
+
+    if (!strips.empty()) {
+      strips.push_back(restart_index);
+    }
+
+    // полоса начинается с трёх вершин затравки, так что в ней есть хотя бы
+    // один треугольник
+    for (int m { 0 }; m < 3; m++) {
+      strips.push_back(kSeed[(rotation + m) % 3]);
+    }
+    used[seed] = true;
+
+    for (std::size_t k { 1 };; k++) {
+      const std::size_t kSize { strips.size() };
+      unsigned int r { 0 };
+      const long kNext {
+        find_next(strips[kSize - 2], strips[kSize - 1], k, r)
+      };
+      if (kNext < 0) {
+        break;
+      }
+
+      used[kNext] = true;
+      strips.push_back(r);
+    }
+  }
+
+  return strips;
+}
+
+IndexBuffer CreateIndexBuffer(const std::vector<unsigned int>& indices,
+                              std::size_t vertex_count,
+                              const IndexBufferOptions& options) {
+  IndexBuffer buffer { };
+  buffer.mode = GL_TRIANGLES;
+
+  // Наибольшее значение индекса зарезервировано для перезапуска примитива.
+  const bool kShortIndices { vertex_count <= 0xffff };
+  buffer.type = kShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  buffer.restart_index = kShortIndices ? 0xffff : 0xffffffff;
+
+  std::vector<unsigned int> ordered {
+    options.optimize_vertex_cache ? OptimizeVertexCache(indices, vertex_count)
+                                  : indices
+  };
+
+  if (options.use_triangle_strips) {
+    std::vector<unsigned int> strips {
+      CreateTriangleStrips(ordered, vertex_count, buffer.restart_index,
+                           options.preserve_winding)
+    };
+
+    // полосы из коротких фрагментов могут оказаться длиннее списка
+    if (strips.size() < ordered.size()) {
+      buffer.mode = GL_TRIANGLE_STRIP;
+      ordered = std::move(strips);
+    }
+  }
+
+  buffer.count = ordered.size();
+
+  if (kShortIndices) {
+    buffer.data.resize(ordered.size() * sizeof(std::uint16_t));
+    for (std::size_t i { 0 }; i < ordered.size(); i++) {
+      const std::uint16_t kIndex { static_cast<std::uint16_t>(ordered[i]) };
+      std::memcpy(buffer.data.data() + i * sizeof(kIndex), &kIndex,
+                  sizeof(kIndex));
+    }
+  } else {
+    buffer.data.resize(ordered.size() * sizeof(std::uint32_t));
+    std::memcpy(buffer.data.data(), ordered.data(), buffer.data.size());
+  }
+
+  return buffer;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const IndexBuffer& buffer,
+                                         std::size_t vertex_count,
+                                         unsigned int cache_size) {
+  // Вершина находится в FIFO-кэше, если после её добавления произошло
+  // меньше cache_size промахов.
+  std::vector<std::size_t> inserted_at(vertex_count, 0);
+  std::vector<bool> seen(vertex_count, false);
+  std::size_t misses { 0 };
+  std::size_t triangles { 0 };
+  std::size_t strip_length { 0 };
+
+  for (std::size_t i { 0 }; i < static_cast<std::size_t>(buffer.count); i++) {
+    const unsigned int kIndex { buffer.GetIndex(i) };
+
+    if (buffer.mode == GL_TRIANGLE_STRIP) {
+      if (kIndex == buffer.restart_index) {
+        strip_length = 0;
+        continue;
+      }
+      if (++strip_length >= 3) {
+        triangles++;
+      }
+    } else if (i % 3 == 2) {
+      triangles++;
+    }
+
+    assert(kIndex < vertex_count);
+    if (!seen[kIndex] || misses - inserted_at[kIndex] >= cache_size) {
+      seen[kIndex] = true;
+      misses++;
+      inserted_at[kIndex] = misses;
+    }
+  }
+
+  std::size_t referenced_vertices { 0 };
+  for (bool vertex_seen : seen) {
+    referenced_vertices += vertex_seen;
+  }
+
+  return {
+    triangles ? static_cast<double>(misses) / triangles : 0.0,
+    referenced_vertices ? static_cast<double>(misses) / referenced_vertices
+                        : 0.0
+  };
+}
@@ -0,0 +1,429 @@
+#include "instance_bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Наибольшая глубина стека обхода: в узле не больше 4 потомков, а
+// иерархия из 2^32 экземпляров имеет не больше 16 уровней.
+constexpr std::size_t kMaxStackSize { 4 * 16 };
+
+struct Range {
+  std::uint32_t first;
+  std::uint32_t count;
+};
+
+// Делит диапазон order по медиане центров вдоль оси, на которой центры
+// разбросаны сильнее всего.
+void SplitRange(std::vector<std::uint32_t>& order,
+                const std::vector<float>& centers, Range range,
+                Range& left, Range& right) {
+  float min[3] {
+    std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+    std::numeric_limits<float>::max()
+  };
+  float max[3] {
+    std::numeric_limits<float>::lowest(),
+    std::numeric_limits<float>::lowest(),
+    std::numeric_limits<float>::lowest()
+  };
+  for (std::uint32_t i { range.first }; i < range.first + range.count; i++) {
+    for (int axis { 0 }; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], centers[3 * order[i] + axis]);
+      max[axis] = std::max(max[axis], centers[3 * order[i] + axis]);
+    }
+  }
+
+  int split_axis { 0 };
+  for (int axis { 1 }; axis < 3; axis++) {
+    if (max[axis] - min[axis] > max[split_axis] - min[split_axis]) {
+      split_axis = axis;
+    }
+  }
+
+  const std::uint32_t kHalf { range.count / 2 };
+  const auto kBegin { order.begin() + range.first };
+  std::nth_element(kBegin, kBegin + kHalf, kBegin + range.count,
+                   [&centers, split_axis](std::uint32_t a, std::uint32_t b) {
+                     return centers[3 * a + split_axis] <
+                            centers[3 * b + split_axis];
+                   });
+
+  left = Range { range.first, kHalf };
+  right = Range { range.first + kHalf, range.count - kHalf };
+}
+
+float GetSurfaceArea(float dx, float dy, float dz) {
+  return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+}  // namespace
+
+std::size_t InstanceBounds::GetCount() const {
+  return min_x.size();
+}
+
+void InstanceBounds::Resize(std::size_t count) {
+  min_x.resize(count);
+  min_y.resize(count);
+  min_z.resize(count);
+  max_x.resize(count);
+  max_y.resize(count);
+  max_z.resize(count);
+}
+
+void ComputeCylinderBounds(const float* transforms, std::size_t count,
+                           float radius, float half_height,
+                           InstanceBounds& bounds) {
+  bounds.Resize(count);
+  ComputeCylinderBounds(transforms, 0, count, radius, half_height, bounds);
+}
+
+void ComputeCylinderBounds(const float* transforms, std::size_t first,
+                           std::size_t count, float radius,
+                           float half_height, InstanceBounds& bounds) {
+  std::vector<float>* const kMins[3] {
+    &bounds.min_x, &bounds.min_y, &bounds.min_z
+  };
+  std::vector<float>* const kMaxs[3] {
+    &bounds.max_x, &bounds.max_y, &bounds.max_z
+  };
+
+  for (std::size_t i { first }; i < first + count; i++) {
+    const float* matrix { transforms + 16 * i };
+
+    // Полуширина по оси мира -- сумма проекций полуосей цилиндра на неё.
+    for (int axis { 0 }; axis < 3; axis++) {
+      const float kExtent {
+        (std::abs(matrix[axis]) + std::abs(matrix[4 + axis])) * radius +
+        std::abs(matrix[8 + axis]) * half_height
+      };
+      (*kMins[axis])[i] = matrix[12 + axis] - kExtent;
+      (*kMaxs[axis])[i] = matrix[12 + axis] + kExtent;
+    }
+  }
+}
+
+Frustum ExtractFrustumPlanes(const float* matrix) {
+  Frustum frustum { };
+
+  // плоскости -- сумма и разность четвёртой строки с первыми тремя
+  for (int row { 0 }; row < 3; row++) {
+    for (int column { 0 }; column < 4; column++) {
+      const float kW { matrix[4 * column + 3] };
+      const float kValue { matrix[4 * column + row] };
+      frustum.planes[2 * row][column] = kW + kValue;
+      frustum.planes[2 * row + 1][column] = kW - kValue;
+    }
+  }
+
+  return frustum;
+}
+
+bool IsBoxVisible(const Frustum& frustum, const float* min,
+                  const float* max) {
+  // Достаточно проверить вершину параллелепипеда, дальнюю вдоль нормали
+  // плоскости. Порядок операций совпадает с TestChildren.
+  for (const float (&kPlane)[4] : frustum.planes) {
+    const float kX { kPlane[0] >= 0.0f ? max[0] : min[0] };
+    const float kY { kPlane[1] >= 0.0f ? max[1] : min[1] };
+    const float kZ { kPlane[2] >= 0.0f ? max[2] : min[2] };
+    if (((kPlane[0] * kX + kPlane[1] * kY) + kPlane[2] * kZ) + kPlane[3] <
+        0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+InstanceBvh::InstanceBvh() : cost_ { 0.0f } { }
+
+void InstanceBvh::Build(const InstanceBounds& bounds) {
+  const std::size_t kCount { bounds.GetCount() };
+  assert(kCount <= std::numeric_limits<std::uint32_t>::max());
+
+  order_.resize(kCount);
+  std::iota(order_.begin(), order_.end(), 0u);
+
+  centers_.resize(3 * kCount);
+  for (std::size_t i { 0 }; i < kCount; i++) {
+    centers_[3 * i] = bounds.min_x[i] + bounds.max_x[i];
+    centers_[3 * i + 1] = bounds.min_y[i] + bounds.max_y[i];
+    centers_[3 * i + 2] = bounds.min_z[i] + bounds.max_z[i];
+  }
+
+  nodes_.clear();
+  if (kCount > 0) {
+    nodes_.reserve(kCount / 2 + 1);
+    BuildNode(bounds, 0, static_cast<std::uint32_t>(kCount));
+  }
+
+  Refit(bounds);
+}
+
+void InstanceBvh::Refit(const InstanceBounds& bounds) {
+  assert(bounds.GetCount() == order_.size());
+
+  const float* const kInstanceBounds[6] {
+    bounds.min_x.data(), bounds.min_y.data(), bounds.min_z.data(),
+    bounds.max_x.data(), bounds.max_y.data(), bounds.max_z.data()
+  };
+
+  // потомки создаются после родителя, поэтому обход с конца идёт снизу вверх
+  for (std::size_t i { nodes_.size() }; i-- > 0;) {
+    Node& node { nodes_[i] };
+
+    for (std::uint32_t child { 0 }; child < node.child_count; child++) {
+      float min[3] {
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max()
+      };
+      float max[3] {
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest()
+      };
+
+      if (node.children[child] == kLeaf) {
+        const std::uint32_t kEnd {
+          node.firsts[child] + node.counts[child]
+        };
+        for (std::uint32_t j { node.firsts[child] }; j < kEnd; j++) {
+          const std::uint32_t kInstance { order_[j] };
+          for (int axis { 0 }; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], kInstanceBounds[axis][kInstance]);
+            max[axis] = std::max(max[axis],
+                                 kInstanceBounds[3 + axis][kInstance]);
+          }
+        }
+      } else {
+        const Node& kChild { nodes_[node.children[child]] };
+        for (std::uint32_t j { 0 }; j < kChild.child_count; j++) {
+          for (int axis { 0 }; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], kChild.bounds[axis][j]);
+            max[axis] = std::max(max[axis], kChild.bounds[3 + axis][j]);
+          }
+        }
+      }
+
+      for (int axis { 0 }; axis < 3; axis++) {
+        node.bounds[axis][child] = min[axis];
+        node.bounds[3 + axis][child] = max[axis];
+      }
+    }
+  }
+
+  UpdateCost();
+}
+
+void InstanceBvh::Cull(const Frustum& frustum, const InstanceBounds& bounds,
+                       std::vector<std::uint32_t>& visible) const {
+  visible.clear();
+  if (nodes_.empty()) {
+    return;
+  }
+
+  std::uint32_t stack[kMaxStackSize];
+  std::size_t stack_size { 0 };
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    const Node& kNode { nodes_[stack[--stack_size]] };
+
+    int visible_mask { 0 };
+    int inside_mask { 0 };
+    TestChildren(kNode, frustum, visible_mask, inside_mask);
+
+    for (std::uint32_t child { 0 }; child < kNode.child_count; child++) {
+      if ((visible_mask & (1 << child)) == 0) {
+        continue;
+      }
+
+      const auto kBegin { order_.begin() + kNode.firsts[child] };
+      const auto kEnd { kBegin + kNode.counts[child] };
+      // Поддерево целиком внутри -- его экземпляры лежат в order_ подряд.
+      // Границы листа из одного экземпляра совпадают с его собственными, так
+      // что он уже проверен.
+      if ((inside_mask & (1 << child)) != 0 || kNode.counts[child] == 1) {
+        visible.insert(visible.end(), kBegin, kEnd);
+      } else if (kNode.children[child] == kLeaf) {
+        for (auto instance { kBegin }; instance != kEnd; ++instance) {
+          const float kMin[3] {
+            bounds.min_x[*instance], bounds.min_y[*instance],
+            bounds.min_z[*instance]
+          };
+          const float kMax[3] {
+            bounds.max_x[*instance], bounds.max_y[*instance],
+            bounds.max_z[*instance]
+          };
+          if (IsBoxVisible(frustum, kMin, kMax)) {
+            visible.push_back(*instance);
+          }
+        }
+      } else {
+        assert(stack_size < kMaxStackSize);
+        stack[stack_size++] = kNode.children[child];
+      }
+    }
+  }
+}
+
+float InstanceBvh::GetCost() const {
+  return cost_;
+}
+
+std::size_t InstanceBvh::GetNodeCount() const {
+  return nodes_.size();
+}
+
+std::size_t InstanceBvh::GetInstanceCount() const {
+  return order_.size();
+}
+
+void InstanceBvh::TestChildren(const Node& node, const Frustum& frustum,
+                               int& visible_mask, int& inside_mask) {
+  const int kChildMask { (1 << node.child_count) - 1 };
+
+#if defined(__SSE2__)
+  const __m128 kZero { _mm_setzero_ps() };
+  __m128 outside { kZero };
+  __m128 crossing { kZero };
+
+  for (const float (&kPlane)[4] : frustum.planes) {
+    // ближняя и дальняя вдоль нормали вершины всех четырёх потомков
+    const int kX { kPlane[0] >= 0.0f ? 3 : 0 };
+    const int kY { kPlane[1] >= 0.0f ? 4 : 1 };
+    const int kZ { kPlane[2] >= 0.0f ? 5 : 2 };
+
+    const __m128 kA { _mm_set1_ps(kPlane[0]) };
+    const __m128 kB { _mm_set1_ps(kPlane[1]) };
+    const __m128 kC { _mm_set1_ps(kPlane[2]) };
+    const __m128 kD { _mm_set1_ps(kPlane[3]) };
+
+    const __m128 kFar {
+      _mm_add_ps(
+          _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(kA, _mm_load_ps(node.bounds[kX])),
+                         _mm_mul_ps(kB, _mm_load_ps(node.bounds[kY]))),
+              _mm_mul_ps(kC, _mm_load_ps(node.bounds[kZ]))),
+          kD)
+    };
+    const __m128 kNear {
+      _mm_add_ps(
+          _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(kA, _mm_load_ps(node.bounds[3 - kX])),
+                         _mm_mul_ps(kB, _mm_load_ps(node.bounds[5 - kY]))),
+              _mm_mul_ps(kC, _mm_load_ps(node.bounds[7 - kZ]))),
+          kD)
+    };
+
+    outside = _mm_or_ps(outside, _mm_cmplt_ps(kFar, kZero));
+    crossing = _mm_or_ps(crossing, _mm_cmplt_ps(kNear, kZero));
+  }
+
+  visible_mask = ~_mm_movemask_ps(outside) & kChildMask;
+  inside_mask = visible_mask & ~_mm_movemask_ps(crossing);
+#else
+  visible_mask = 0;
+  inside_mask = 0;
+  for (std::uint32_t child { 0 }; child < node.child_count; child++) {
+    const float kMin[3] {
+      node.bounds[0][child], node.bounds[1][child], node.bounds[2][child]
+    };
+    const float kMax[3] {
+      node.bounds[3][child], node.bounds[4][child], node.bounds[5][child]
+    };
+    if (IsBoxVisible(frustum, kMin, kMax)) {
+      visible_mask |= 1 << child;
+      // внутри всех плоскостей -- ближняя вершина видима
+      if (IsBoxVisible(frustum, kMax, kMin)) {
+        inside_mask |= 1 << child;
+      }
+    }
+  }
+  static_cast<void>(kChildMask);
+#endif
+}
+
+std::uint32_t InstanceBvh::BuildNode(const InstanceBounds& bounds,
+                                     std::uint32_t first,
+                                     std::uint32_t count) {
+  const std::uint32_t kIndex { static_cast<std::uint32_t>(nodes_.size()) };
+  nodes_.emplace_back();
+
+  // диапазон делится пополам дважды, давая до четырёх потомков
+  Range parts[4] { };
+  std::uint32_t part_count { 0 };
+  if (count <= kLeafSize) {
+    parts[part_count++] = Range { first, count };
+  } else {
+    Range halves[2] { };
+    SplitRange(order_, centers_, Range { first, count }, halves[0],
+               halves[1]);
+    for (const Range& kHalf : halves) {
+      if (kHalf.count <= kLeafSize) {
+        parts[part_count++] = kHalf;
+      } else {
+        SplitRange(order_, centers_, kHalf, parts[part_count],
+                   parts[part_count + 1]);
+        part_count += 2;
+      }
+    }
+  }
+
+  nodes_[kIndex].child_count = part_count;
+  for (std::uint32_t child { 0 }; child < part_count; child++) {
+    const std::uint32_t kChild {
+      parts[child].count <= kLeafSize
+          ? kLeaf
+          : BuildNode(bounds, parts[child].first, parts[child].count)
+    };
+
+    Node& node { nodes_[kIndex] };
+    node.children[child] = kChild;
+    node.firsts[child] = parts[child].first;
+    node.counts[child] = parts[child].count;
+  }
+
+  return kIndex;
+}
+
+void InstanceBvh::UpdateCost() {
+  cost_ = 0.0f;
+  if (nodes_.empty()) {
+    return;
+  }
+
+  float area { 0.0f };
+  for (const Node& kNode : nodes_) {
+    for (std::uint32_t child { 0 }; child < kNode.child_count; child++) {
+      area += GetSurfaceArea(kNode.bounds[3][child] - kNode.bounds[0][child],
+                             kNode.bounds[4][child] - kNode.bounds[1][child],
+                             kNode.bounds[5][child] - kNode.bounds[2][child]);
+    }
+  }
+
+  const Node& kRoot { nodes_.front() };
+  float min[3] { kRoot.bounds[0][0], kRoot.bounds[1][0], kRoot.bounds[2][0] };
+  float max[3] { kRoot.bounds[3][0], kRoot.bounds[4][0], kRoot.bounds[5][0] };
+  for (std::uint32_t child { 1 }; child < kRoot.child_count; child++) {
+    for (int axis { 0 }; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], kRoot.bounds[axis][child]);
+      max[axis] = std::max(max[axis], kRoot.bounds[3 + axis][child]);
+    }
+  }
+
+  const float kRootArea {
+    GetSurfaceArea(max[0] - min[0], max[1] - min[1], max[2] - min[2])
+  };
+  cost_ = kRootArea > 0.0f ? area / kRootArea : 0.0f;
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+// Векторные ядра InstanceStore. Заголовок включается в instance_store.cpp
+// (SSE2) и в instance_store_avx2.cpp, который компилируется с -mavx2; все
+// функции находятся в безымянном пространстве имён, чтобы версии из разных
+// единиц трансляции не смешивались при компоновке.
+
+#include <cstddef>
+
+#include <immintrin.h>
+
+namespace {
+
+// Операции над векторами из 4 (SSE2) и 8 (AVX2) чисел с одинаковыми именами,
+// чтобы ядра записывались один раз в виде шаблонов.
+
+template <typename Float>
+Float Set(float value);
+
+template <typename Float>
+Float Load(const float* data);
+
+template <>
+inline __m128 Set<__m128>(float value) {
+  return _mm_set1_ps(value);
+}
+
+template <>
+inline __m128 Load<__m128>(const float* data) {
+  return _mm_loadu_ps(data);
+}
+
+inline void Store(float* data, __m128 a) { _mm_storeu_ps(data, a); }
+inline __m128 Add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 Sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 Mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+inline __m128 And(__m128 a, __m128 b) { return _mm_and_ps(a, b); }
+inline __m128 AndNot(__m128 a, __m128 b) { return _mm_andnot_ps(a, b); }
+inline __m128 Or(__m128 a, __m128 b) { return _mm_or_ps(a, b); }
+inline __m128 Xor(__m128 a, __m128 b) { return _mm_xor_ps(a, b); }
+inline __m128 CmpGe(__m128 a, __m128 b) { return _mm_cmpge_ps(a, b); }
+inline __m128 CmpLe(__m128 a, __m128 b) { return _mm_cmple_ps(a, b); }
+
+inline __m128i SetInt(__m128, int value) { return _mm_set1_epi32(value); }
+inline __m128i ToInt(__m128 a) { return _mm_cvttps_epi32(a); }
+inline __m128 ToFloat(__m128i a) { return _mm_cvtepi32_ps(a); }
+inline __m128 AsFloat(__m128i a) { return _mm_castsi128_ps(a); }
+inline __m128i AddInt(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+inline __m128i SubInt(__m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+inline __m128i AndInt(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+inline __m128i AndNotInt(__m128i a, __m128i b) {
+  return _mm_andnot_si128(a, b);
+}
+inline __m128i CmpEqInt(__m128i a, __m128i b) {
+  return _mm_cmpeq_epi32(a, b);
+}
+template <int kShift>
+inline __m128i ShiftLeft(__m128i a) { return _mm_slli_epi32(a, kShift); }
+
+// Записывает матрицы 4 экземпляров: elements[e] содержит e-й элемент
+// матрицы каждого экземпляра.
+inline void StoreMatrices(const __m128 (&elements)[16], float* matrices) {
+  for (int e { 0 }; e < 16; e += 4) {
+    __m128 r0 { elements[e] };
+    __m128 r1 { elements[e + 1] };
+    __m128 r2 { elements[e + 2] };
+    __m128 r3 { elements[e + 3] };
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(matrices + e, r0);
+    _mm_storeu_ps(matrices + 16 + e, r1);
+    _mm_storeu_ps(matrices + 32 + e, r2);
+    _mm_storeu_ps(matrices + 48 + e, r3);
+  }
+}
+
+#if defined(__AVX2__)
+template <>
+inline __m256 Set<__m256>(float value) {
+  return _mm256_set1_ps(value);
+}
+
+template <>
+inline __m256 Load<__m256>(const float* data) {
+  return _mm256_loadu_ps(data);
+}
+
+inline void Store(float* data, __m256 a) { _mm256_storeu_ps(data, a); }
+inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+inline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+inline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+inline __m256 And(__m256 a, __m256 b) { return _mm256_and_ps(a, b); }
+inline __m256 AndNot(__m256 a, __m256 b) { return _mm256_andnot_ps(a, b); }
+inline __m256 Or(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+inline __m256 Xor(__m256 a, __m256 b) { return _mm256_xor_ps(a, b); }
+inline __m256 CmpGe(__m256 a, __m256 b) {
+  return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+}
+inline __m256 CmpLe(__m256 a, __m256 b) {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+
+inline __m256i SetInt(__m256, int value) { return _mm256_set1_epi32(value); }
+inline __m256i ToInt(__m256 a) { return _mm256_cvttps_epi32(a); }
+inline __m256 ToFloat(__m256i a) { return _mm256_cvtepi32_ps(a); }
+inline __m256 AsFloat(__m256i a) { return _mm256_castsi256_ps(a); }
+inline __m256i AddInt(__m256i a, __m256i b) {
+  return _mm256_add_epi32(a, b);
+}
+inline __m256i SubInt(__m256i a, __m256i b) {
+  return _mm256_sub_epi32(a, b);
+}
+inline __m256i AndInt(__m256i a, __m256i b) {
+  return _mm256_and_si256(a, b);
+}
+inline __m256i AndNotInt(__m256i a, __m256i b) {
+  return _mm256_andnot_si256(a, b);
+}
+inline __m256i CmpEqInt(__m256i a, __m256i b) {
+  return _mm256_cmpeq_epi32(a, b);
+}
+template <int kShift>
+inline __m256i ShiftLeft(__m256i a) { return _mm256_slli_epi32(a, kShift); }
+
+// Транспонирование 4x4 внутри каждой 128-битной половины: младшие половины
+// относятся к экземплярам 0-3, старшие -- к экземплярам 4-7.
+inline void StoreMatrices(const __m256 (&elements)[16], float* matrices) {
+  for (int e { 0 }; e < 16; e += 4) {
+    const __m256 kT0 { _mm256_unpacklo_ps(elements[e], elements[e + 1]) };
+    const __m256 kT1 { _mm256_unpackhi_ps(elements[e], elements[e + 1]) };
+    const __m256 kT2 { _mm256_unpacklo_ps(elements[e + 2], elements[e + 3]) };
+    const __m256 kT3 { _mm256_unpackhi_ps(elements[e + 2], elements[e + 3]) };
+
+    const __m256 kRows[4] {
+      _mm256_shuffle_ps(kT0, kT2, 0x44),
+      _mm256_shuffle_ps(kT0, kT2, 0xee),
+      _mm256_shuffle_ps(kT1, kT3, 0x44),
+      _mm256_shuffle_ps(kT1, kT3, 0xee),
+    };
+
+    for (int i { 0 }; i < 4; i++) {
+      _mm_storeu_ps(matrices + 16 * i + e, _mm256_castps256_ps128(kRows[i]));
+      _mm_storeu_ps(matrices + 16 * (i + 4) + e,
+                    _mm256_extractf128_ps(kRows[i], 1));
+    }
+  }
+}
+#endif
+
+template <typename Float>
+constexpr std::size_t kWidth { sizeof(Float) / sizeof(float) };
+
+// Синус и косинус с точностью около 1 ULP для |x| < 8192 (алгоритм из
+// библиотеки Cephes: приведение к [-pi/4; pi/4] и многочлены).
+template <typename Float>
+void SinCos(Float x, Float& sin_value, Float& cos_value) {
+  const Float kSignMask { AsFloat(SetInt(x, static_cast<int>(0x80000000u))) };
+
+  Float sin_sign { And(x, kSignMask) };
+  x = AndNot(kSignMask, x);
+
+  // номер октанта, округлённый вверх до чётного
+  auto octant = AddInt(ToInt(Mul(x, Set<Float>(1.27323954473516f))),
+                       SetInt(x, 1));
+  octant = AndInt(octant, SetInt(x, ~1));
+  const Float kY { ToFloat(octant) };
+
+  const Float kSwapSinSign {
+    AsFloat(ShiftLeft<29>(AndInt(octant, SetInt(x, 4))))
+  };
+  const Float kPolynomialMask {
+    AsFloat(CmpEqInt(AndInt(octant, SetInt(x, 2)), SetInt(x, 0)))
+  };
+  const Float kCosSign {
+    AsFloat(ShiftLeft<29>(AndNotInt(SubInt(octant, SetInt(x, 2)),
+                                    SetInt(x, 4))))
+  };
+  sin_sign = Xor(sin_sign, kSwapSinSign);
+
+  // x - y * pi / 4 с представлением pi / 4 суммой трёх чисел
+  x = Add(x, Mul(kY, Set<Float>(-0.78515625f)));
+  x = Add(x, Mul(kY, Set<Float>(-2.4187564849853515625e-4f)));
+  x = Add(x, Mul(kY, Set<Float>(-3.77489497744594108e-8f)));
+
+  const Float kZ { Mul(x, x) };
+
+  Float cos_polynomial { Set<Float>(2.443315711809948e-5f) };
+  cos_polynomial = Add(Mul(cos_polynomial, kZ),
+                       Set<Float>(-1.388731625493765e-3f));
+  cos_polynomial = Add(Mul(cos_polynomial, kZ),
+                       Set<Float>(4.166664568298827e-2f));
+  cos_polynomial = Mul(Mul(cos_polynomial, kZ), kZ);
+  cos_polynomial = Sub(cos_polynomial, Mul(kZ, Set<Float>(0.5f)));
+  cos_polynomial = Add(cos_polynomial, Set<Float>(1.0f));
+
+  Float sin_polynomial { Set<Float>(-1.9515295891e-4f) };
+  sin_polynomial = Add(Mul(sin_polynomial, kZ),
+                       Set<Float>(8.3321608736e-3f));
+  sin_polynomial = Add(Mul(sin_polynomial, kZ),
+                       Set<Float>(-1.6666654611e-1f));
+  sin_polynomial = Add(Mul(Mul(sin_polynomial, kZ), x), x);
+
+  const Float kSin {
+    Or(And(kPolynomialMask, sin_polynomial),
+       AndNot(kPolynomialMask, cos_polynomial))
+  };
+  const Float kCos {
+    Or(And(kPolynomialMask, cos_polynomial),
+       AndNot(kPolynomialMask, sin_polynomial))
+  };
+
+  sin_value = Xor(kSin, sin_sign);
+  cos_value = Xor(kCos, kCosSign);
+}
+
+// Шаг UpdatePosition по одной оси для экземпляров [0; count), где count
+// кратно ширине вектора.
+template <typename Float>
+void UpdateAxis(float* offsets, float* directions, std::size_t count,
+                float velocity, float limit) {
+  const Float kVelocity { Set<Float>(velocity) };
+  const Float kLimit { Set<Float>(limit) };
+  const Float kNegativeLimit { Set<Float>(-limit) };
+  const Float kSignMask { Set<Float>(-0.0f) };
+
+  for (std::size_t i { 0 }; i < count; i += kWidth<Float>) {
+    const Float kOffset {
+      Add(Load<Float>(offsets + i), Mul(Load<Float>(directions + i), kVelocity))
+    };
+    Store(offsets + i, kOffset);
+
+    // на границе направление меняет знак
+    const Float kBounce {
+      Or(CmpGe(kOffset, kLimit), CmpLe(kOffset, kNegativeLimit))
+    };
+    Store(directions + i,
+          Xor(Load<Float>(directions + i), And(kBounce, kSignMask)));
+  }
+}
+
+// Матрицы translate(x, y, 0) * rotate(alpha, x) * rotate(beta, y) *
+// scale(s) в порядке хранения glm (по столбцам) для экземпляров [0; count),
+// где count кратно ширине вектора.
+template <typename Float>
+void BuildTransforms(const float* x_offsets, const float* y_offsets,
+                     const float* alphas, const float* betas,
+                     const float* scales, std::size_t count,
+                     float* transforms) {
+  const Float kZero { Set<Float>(0.0f) };
+  const Float kOne { Set<Float>(1.0f) };
+
+  for (std::size_t i { 0 }; i < count; i += kWidth<Float>) {
+    Float sin_alpha { }, cos_alpha { }, sin_beta { }, cos_beta { };
+    SinCos(Load<Float>(alphas + i), sin_alpha, cos_alpha);
+    SinCos(Load<Float>(betas + i), sin_beta, cos_beta);
+
+    const Float kScale { Load<Float>(scales + i) };
+    const Float kScaledSinAlpha { Mul(kScale, sin_alpha) };
+    const Float kScaledCosAlpha { Mul(kScale, cos_alpha) };
+
+    const Float kElements[16] {
+      Mul(kScale, cos_beta),
+      Mul(kScaledSinAlpha, sin_beta),
+      Sub(kZero, Mul(kScaledCosAlpha, sin_beta)),
+      kZero,
+
+      kZero,
+      kScaledCosAlpha,
+      kScaledSinAlpha,
+      kZero,
+
+      Mul(kScale, sin_beta),
+      Sub(kZero, Mul(kScaledSinAlpha, cos_beta)),
+      Mul(kScaledCosAlpha, cos_beta),
+      kZero,
+
+      Load<Float>(x_offsets + i),
+      Load<Float>(y_offsets + i),
+      kZero,
+      kOne,
+    };
+
+    StoreMatrices(kElements, transforms + 16 * i);
+  }
+}
+
+}  // namespace
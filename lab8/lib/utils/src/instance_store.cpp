@@ -0,0 +1,267 @@
+#include "instance_store.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+#include "utils.hpp"
+
+#if defined(__SSE2__)
+#include "instance_kernels.hpp"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+// instance_store_avx2.cpp
+void UpdateInstanceAxisAvx2(float* offsets, float* directions,
+                            std::size_t count, float velocity, float limit);
+void BuildInstanceTransformsAvx2(const float* x_offsets,
+                                 const float* y_offsets, const float* alphas,
+                                 const float* betas, const float* scales,
+                                 std::size_t count, float* transforms);
+#endif
+
+namespace {
+
+bool HasAvx2() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const bool kHasAvx2 { __builtin_cpu_supports("avx2") != 0 };
+  return kHasAvx2;
+#else
+  return false;
+#endif
+}
+
+// Обрабатывает векторными ядрами наибольшее возможное число первых
+// экземпляров и возвращает их количество; остальные обрабатываются
+// скалярным кодом.
+std::size_t UpdateAxisVectorized(float* offsets, float* directions,
+                                 std::size_t count, float velocity,
+                                 float limit) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (HasAvx2()) {
+    const std::size_t kCount { count & ~std::size_t { 7 } };
+    UpdateInstanceAxisAvx2(offsets, directions, kCount, velocity, limit);
+    return kCount;
+  }
+#endif
+#if defined(__SSE2__)
+  const std::size_t kCount { count & ~std::size_t { 3 } };
+  UpdateAxis<__m128>(offsets, directions, kCount, velocity, limit);
+  return kCount;
+#else
+  return 0;
+#endif
+}
+
+std::size_t BuildTransformsVectorized(const InstanceStore& store,
+                                      std::size_t first,
+                                      std::size_t instance_count,
+                                      float* transforms) {
+  const float* x_offsets { store.x_offsets.data() + first };
+  const float* y_offsets { store.y_offsets.data() + first };
+  const float* alphas { store.alphas.data() + first };
+  const float* betas { store.betas.data() + first };
+  const float* scales { store.scales.data() + first };
+  float* destination { transforms + kInstanceTransformSize * first };
+
+#if defined(__x86_64__) || defined(__i386__)
+  if (HasAvx2()) {
+    const std::size_t kCount { instance_count & ~std::size_t { 7 } };
+    BuildInstanceTransformsAvx2(x_offsets, y_offsets, alphas, betas, scales,
+                                kCount, destination);
+    return kCount;
+  }
+#endif
+#if defined(__SSE2__)
+  const std::size_t kCount { instance_count & ~std::size_t { 3 } };
+  BuildTransforms<__m128>(x_offsets, y_offsets, alphas, betas, scales,
+                          kCount, destination);
+  return kCount;
+#else
+  return 0;
+#endif
+}
+
+void UpdateAxisScalar(float& offset, float& direction, float velocity,
+                      float limit) {
+  offset += direction * velocity;
+  if (offset >= limit || offset <= -limit) {
+    direction = -direction;
+  }
+}
+
+// Приводит угол к [-pi; pi], чтобы векторный синус сохранял точность при
+// длительном вращении. Углы меняются за кадр на малую величину, поэтому
+// достаточно одного сдвига на период; в отличие от std::remainder цикл с
+// такой функцией векторизуется компилятором.
+float WrapAngle(float angle) {
+  const float kPi { static_cast<float>(M_PI) };
+  const float kTwoPi { static_cast<float>(2.0 * M_PI) };
+  angle -= angle > kPi ? kTwoPi : 0.0f;
+  angle += angle < -kPi ? kTwoPi : 0.0f;
+  return angle;
+}
+
+}  // namespace
+
+std::size_t InstanceStore::GetCount() const {
+  return x_offsets.size();
+}
+
+void InstanceStore::Resize(std::size_t count) {
+  x_offsets.resize(count);
+  y_offsets.resize(count);
+  x_directions.resize(count);
+  y_directions.resize(count);
+  alphas.resize(count);
+  betas.resize(count);
+  scales.resize(count, 1.0f);
+}
+
+InstanceStore CreateInstanceStore(std::size_t count, unsigned int seed) {
+  InstanceStore store { };
+  store.Resize(count);
+
+  std::mt19937 generator { seed };
+  std::uniform_real_distribution<float> offset_distribution {
+    -kCylinderHalfHeight, kCylinderHalfHeight
+  };
+  std::uniform_real_distribution<float> angle_distribution {
+    static_cast<float>(-M_PI), static_cast<float>(M_PI)
+  };
+  std::bernoulli_distribution direction_distribution { };
+  std::uniform_real_distribution<float> scale_distribution {
+    std::log(kMinInstanceScale), 0.0f
+  };
+
+  for (std::size_t i { 0 }; i < count; i++) {
+    if (i == 0) {
+      store.x_offsets[i] = 0.0f;
+      store.y_offsets[i] = 0.0f;
+      store.x_directions[i] = 1.0f;
+      store.y_directions[i] = 1.0f;
+      store.alphas[i] = 0.0f;
+      store.betas[i] = 0.0f;
+      store.scales[i] = 1.0f;
+      continue;
+    }
+
+    store.x_offsets[i] = offset_distribution(generator);
+    store.y_offsets[i] = offset_distribution(generator);
+    store.x_directions[i] = direction_distribution(generator) ? 1.0f : -1.0f;
+    store.y_directions[i] = direction_distribution(generator) ? 1.0f : -1.0f;
+    store.alphas[i] = angle_distribution(generator);
+    store.betas[i] = angle_distribution(generator);
+    store.scales[i] = std::exp(scale_distribution(generator));
+  }
+
+  return store;
+}
+
+void UpdateInstancePositions(InstanceStore& store) {
+  const std::size_t kCount { store.GetCount() };
+
+  const std::size_t kXVectorized {
+    UpdateAxisVectorized(store.x_offsets.data(), store.x_directions.data(),
+                         kCount, kXVelocity, kCylinderHalfHeight)
+  };
+  for (std::size_t i { kXVectorized }; i < kCount; i++) {
+    UpdateAxisScalar(store.x_offsets[i], store.x_directions[i], kXVelocity,
+                     kCylinderHalfHeight);
+  }
+
+  const std::size_t kYVectorized {
+    UpdateAxisVectorized(store.y_offsets.data(), store.y_directions.data(),
+                         kCount, kYVelocity, kCylinderHalfHeight)
+  };
+  for (std::size_t i { kYVectorized }; i < kCount; i++) {
+    UpdateAxisScalar(store.y_offsets[i], store.y_directions[i], kYVelocity,
+                     kCylinderHalfHeight);
+  }
+}
+
+void RotateInstances(InstanceStore& store, float alpha_changing,
+                     float beta_changing) {
+  if (alpha_changing == 0.0f && beta_changing == 0.0f) {
+    return;
+  }
+
+  for (std::size_t i { 0 }; i < store.GetCount(); i++) {
+    store.alphas[i] = WrapAngle(store.alphas[i] + alpha_changing);
+    store.betas[i] = WrapAngle(store.betas[i] + beta_changing);
+  }
+}
+
+void InterpolateInstances(const InstanceStore& previous,
+                          const InstanceStore& current, float factor,
+                          InstanceStore& result) {
+  result.Resize(current.GetCount());
+  InterpolateInstances(previous, current, factor, 0, current.GetCount(),
+                       result);
+}
+
+void InterpolateInstances(const InstanceStore& previous,
+                          const InstanceStore& current, float factor,
+                          std::size_t first, std::size_t count,
+                          InstanceStore& result) {
+  const std::size_t kEnd { first + count };
+
+  for (std::size_t i { first }; i < kEnd; i++) {
+    result.x_offsets[i] = previous.x_offsets[i] +
+        (current.x_offsets[i] - previous.x_offsets[i]) * factor;
+    result.y_offsets[i] = previous.y_offsets[i] +
+        (current.y_offsets[i] - previous.y_offsets[i]) * factor;
+  }
+  std::copy(current.x_directions.begin() + first,
+            current.x_directions.begin() + kEnd,
+            result.x_directions.begin() + first);
+  std::copy(current.y_directions.begin() + first,
+            current.y_directions.begin() + kEnd,
+            result.y_directions.begin() + first);
+  std::copy(current.scales.begin() + first, current.scales.begin() + kEnd,
+            result.scales.begin() + first);
+
+  // угол мог перейти через -pi, поэтому берётся кратчайшая разность
+  for (std::size_t i { first }; i < kEnd; i++) {
+    result.alphas[i] = WrapAngle(
+        previous.alphas[i] +
+        WrapAngle(current.alphas[i] - previous.alphas[i]) * factor);
+    result.betas[i] = WrapAngle(
+        previous.betas[i] +
+        WrapAngle(current.betas[i] - previous.betas[i]) * factor);
+  }
+}
+
+void BuildInstanceTransforms(const InstanceStore& store, float* transforms) {
+  BuildInstanceTransforms(store, 0, store.GetCount(), transforms);
+}
+
+void BuildInstanceTransforms(const InstanceStore& store, std::size_t first,
+                             std::size_t count, float* transforms) {
+  const std::size_t kVectorized {
+    BuildTransformsVectorized(store, first, count, transforms)
+  };
+
+  for (std::size_t i { first + kVectorized }; i < first + count; i++) {
+    const float kSinAlpha { std::sin(store.alphas[i]) };
+    const float kCosAlpha { std::cos(store.alphas[i]) };
+    const float kSinBeta { std::sin(store.betas[i]) };
+    const float kCosBeta { std::cos(store.betas[i]) };
+    const float kScale { store.scales[i] };
+
+    const float kTransform[kInstanceTransformSize] {
+      kScale * kCosBeta, kScale * kSinAlpha * kSinBeta,
+      -kScale * kCosAlpha * kSinBeta, 0.0f,
+      0.0f, kScale * kCosAlpha, kScale * kSinAlpha, 0.0f,
+      kScale * kSinBeta, -kScale * kSinAlpha * kCosBeta,
+      kScale * kCosAlpha * kCosBeta, 0.0f,
+      store.x_offsets[i], store.y_offsets[i], 0.0f, 1.0f,
+    };
+
+    float* transform { transforms + kInstanceTransformSize * i };
+    for (std::size_t k { 0 }; k < kInstanceTransformSize; k++) {
+      transform[k] = kTransform[k];
+    }
+  }
+}
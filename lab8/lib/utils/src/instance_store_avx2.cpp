@@ -0,0 +1,21 @@
+// Компилируется с -mavx2 (см. CMakeLists.txt) и вызывается только после
+// проверки поддержки AVX2 процессором.
+
+#if defined(__AVX2__)
+
+#include "instance_kernels.hpp"
+
+void UpdateInstanceAxisAvx2(float* offsets, float* directions,
+                            std::size_t count, float velocity, float limit) {
+  UpdateAxis<__m256>(offsets, directions, count, velocity, limit);
+}
+
+void BuildInstanceTransformsAvx2(const float* x_offsets,
+                                 const float* y_offsets, const float* alphas,
+                                 const float* betas, const float* scales,
+                                 std::size_t count, float* transforms) {
+  BuildTransforms<__m256>(x_offsets, y_offsets, alphas, betas, scales, count,
+                          transforms);
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// планировщик, которому принадлежит текущий рабочий поток, и его очередь
+thread_local const JobSystem* tls_job_system { nullptr };
+thread_local std::size_t tls_queue_index { 0 };
+
+}  // namespace
+
+JobCounter::JobCounter() : value_ { 0 } {
+}
+
+bool JobCounter::IsDone() const {
+  if (value_.load(std::memory_order_acquire) != 0) {
+    return false;
+  }
+  // Счётчик обнуляется под мьютексом; захват дожидается, пока завершившее
+  // задание его отпустит.
+  std::lock_guard<std::mutex> lock { mutex_ };
+  return true;
+}
+
+JobSystem::JobSystem(unsigned int thread_count)
+    : queued_count_ { 0 },
+      stopping_ { false },
+      job_count_ { 0 },
+      steal_count_ { 0 } {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // нулевая очередь -- внешняя, остальные принадлежат рабочим потокам
+  for (unsigned int i { 0 }; i < thread_count; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (unsigned int i { 1 }; i < thread_count; i++) {
+    workers_.emplace_back(&JobSystem::WorkerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock { sleep_mutex_ };
+    stopping_ = true;
+  }
+  sleep_condition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* counter,
+                    JobCounter* dependency) {
+  if (counter) {
+    counter->value_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Job job { std::move(function), counter };
+  if (dependency) {
+    std::lock_guard<std::mutex> lock { dependency->mutex_ };
+    if (dependency->value_.load(std::memory_order_acquire) != 0) {
+      dependency->continuations_.push_back(std::move(job));
+      return;
+    }
+  }
+  Push(std::move(job));
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+  while (!counter.IsDone()) {
+    if (!TryRunJob()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::ParallelFor(
+    std::size_t count, std::size_t grain_size,
+    const std::function<void(std::size_t, std::size_t)>& function) {
+  if (count == 0) {
+    return;
+  }
+
+  // Частей в несколько раз больше, чем потоков, чтобы освободившиеся
+  // потоки могли забрать работу у отстающих. Границы частей кратны
+  // grain_size.
+  grain_size = std::max<std::size_t>(1, grain_size);
+  const std::size_t kGrainCount { (count + grain_size - 1) / grain_size };
+  const std::size_t kPartCount {
+    std::min(kGrainCount, std::size_t { 4 } * GetThreadCount())
+  };
+  if (kPartCount <= 1 || workers_.empty()) {
+    function(0, count);
+    return;
+  }
+
+  auto get_part_begin = [count, grain_size, kGrainCount,
+                         kPartCount](std::size_t part) {
+    return std::min(count, kGrainCount * part / kPartCount * grain_size);
+  };
+
+  JobCounter counter { };
+  for (std::size_t part { 1 }; part < kPartCount; part++) {
+    const std::size_t kBegin { get_part_begin(part) };
+    const std::size_t kEnd { get_part_begin(part + 1) };
+    Run([&function, kBegin, kEnd] { function(kBegin, kEnd); }, &counter);
+  }
+  // первую часть выполняет вызывающий поток
+  function(0, get_part_begin(1));
+  Wait(counter);
+}
+
+unsigned int JobSystem::GetThreadCount() const {
+  return static_cast<unsigned int>(workers_.size()) + 1;
+}
+
+std::size_t JobSystem::GetJobCount() const {
+  return job_count_.load(std::memory_order_relaxed);
+}
+
+std::size_t JobSystem::GetStealCount() const {
+  return steal_count_.load(std::memory_order_relaxed);
+}
+
+void JobSystem::Push(Job job) {
+  Queue& queue { *queues_[GetQueueIndex()] };
+  {
+    std::lock_guard<std::mutex> lock { queue.mutex };
+    queue.jobs.push_back(std::move(job));
+  }
+  queued_count_.fetch_add(1, std::memory_order_release);
+
+  // Захват мьютекса не даёт уведомлению проскочить между проверкой
+  // условия и засыпанием рабочего потока.
+  { std::lock_guard<std::mutex> lock { sleep_mutex_ }; }
+  sleep_condition_.notify_one();
+}
+
+bool JobSystem::TryRunJob() {
+  const std::size_t kOwnIndex { GetQueueIndex() };
+  Job job { };
+  bool found { false };
+
+  {
+    Queue& queue { *queues_[kOwnIndex] };
+    std::lock_guard<std::mutex> lock { queue.mutex };
+    if (!queue.jobs.empty()) {
+      job = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+      found = true;
+    }
+  }
+
+  // чужие очереди просматриваются, начиная со следующей за своей
+  for (std::size_t i { 1 }; !found && i < queues_.size(); i++) {
+    Queue& queue { *queues_[(kOwnIndex + i) % queues_.size()] };
+    std::lock_guard<std::mutex> lock { queue.mutex };
+    if (!queue.jobs.empty()) {
+      job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      found = true;
+      steal_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  if (!found) {
+    return false;
+  }
+  queued_count_.fetch_sub(1, std::memory_order_relaxed);
+  Execute(job);
+  return true;
+}
+
+void JobSystem::Execute(Job& job) {
+  job.function();
+  job_count_.fetch_add(1, std::memory_order_relaxed);
+  if (job.counter) {
+    Finish(*job.counter);
+  }
+}
+
+void JobSystem::Finish(JobCounter& counter) {
+  std::vector<Job> ready { };
+  {
+    std::lock_guard<std::mutex> lock { counter.mutex_ };
+    if (counter.value_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ready.swap(counter.continuations_);
+    }
+  }
+  // после обнуления счётчик может быть уже уничтожен
+  for (Job& job : ready) {
+    Push(std::move(job));
+  }
+}
+
+void JobSystem::WorkerLoop(std::size_t queue_index) {
+  tls_job_system = this;
+  tls_queue_index = queue_index;
+
+  while (true) {
+    if (TryRunJob()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock { sleep_mutex_ };
+    sleep_condition_.wait(lock, [this] {
+      return stopping_ || queued_count_.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping_ && queued_count_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+std::size_t JobSystem::GetQueueIndex() const {
+  return tls_job_system == this ? tls_queue_index : 0;
+}
@@ -0,0 +1,363 @@
+#include "mesh_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+std::size_t GetIndexSize(GLenum index_type) {
+  switch (index_type) {
+    case GL_UNSIGNED_BYTE:
+      return 1;
+    case GL_UNSIGNED_SHORT:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+// Ёмкость, в которую уместятся ещё size единиц после дефрагментации.
+// Свободный участок в конце должен быть не меньше GetFitSize(size), а не
+// size, иначе распределитель его не найдёт.
+std::size_t GetRequiredCapacity(const TlsfAllocator& allocator,
+                                std::size_t size) {
+  const std::size_t kRequired {
+    allocator.GetUsedSize() + TlsfAllocator::GetFitSize(size)
+  };
+  if (kRequired <= allocator.GetCapacity()) {
+    return allocator.GetCapacity();
+  }
+  return std::max(2 * allocator.GetCapacity(), kRequired);
+}
+
+// Копирует занятые участки буфера source в destination по перемещениям
+// дефрагментации. Участки до первого перемещения остаются на месте.
+void CopyBlocks(GlStateCache& state, GLuint source, GLuint destination,
+                std::size_t used_size, const std::vector<TlsfMove>& moves,
+                std::size_t unit_size) {
+  state.BindBuffer(GL_COPY_READ_BUFFER, source);
+  state.BindBuffer(GL_COPY_WRITE_BUFFER, destination);
+
+  const std::size_t kPrefix {
+    moves.empty() ? used_size : moves.front().destination
+  };
+  if (kPrefix > 0) {
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        kPrefix * unit_size);
+  }
+  for (const TlsfMove& kMove : moves) {
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        kMove.source * unit_size,
+                        kMove.destination * unit_size,
+                        kMove.size * unit_size);
+  }
+}
+
+GLuint CreateBuffer(GlStateCache& state, std::size_t size) {
+  GLuint buffer { 0 };
+  glGenBuffers(1, &buffer);
+  state.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+  return buffer;
+}
+
+void DeleteBuffer(GlStateCache& state, GLuint buffer) {
+  state.ForgetBuffer(buffer);
+  glDeleteBuffers(1, &buffer);
+}
+
+}  // namespace
+
+MeshArena::MeshArena(GlStateCache& state, std::size_t vertex_size,
+                     SetupAttributes setup_attributes, GLenum index_type,
+                     GLuint instance_location,
+                     std::size_t max_instance_count,
+                     std::size_t vertex_capacity, std::size_t index_capacity)
+    : state_ { state },
+      vertex_size_ { vertex_size },
+      setup_attributes_ { setup_attributes },
+      index_type_ { index_type },
+      index_size_ { GetIndexSize(index_type) },
+      instance_location_ { instance_location },
+      max_instance_count_ { max_instance_count },
+      indirect_ { GLAD_GL_VERSION_4_3 != 0 },
+      vertex_allocator_ { vertex_capacity },
+      index_allocator_ { index_capacity },
+      vertex_array_ { 0 },
+      command_buffer_ { 0 },
+      command_capacity_ { 0 },
+      draw_call_count_ { 0 },
+      command_count_ { 0 },
+      defragment_count_ { 0 } {
+  vertex_buffer_ = CreateBuffer(state_, vertex_capacity * vertex_size_);
+  index_buffer_ = CreateBuffer(state_, index_capacity * index_size_);
+
+  std::vector<GLuint> instances(max_instance_count_);
+  std::iota(instances.begin(), instances.end(), 0u);
+  instance_buffer_ = CreateBuffer(state_, instances.size() * sizeof(GLuint));
+  glBufferSubData(GL_COPY_WRITE_BUFFER, 0, instances.size() * sizeof(GLuint),
+                  instances.data());
+
+  if (indirect_) {
+    glGenBuffers(1, &command_buffer_);
+  }
+
+  SetupVertexArray();
+}
+
+MeshArena::~MeshArena() {
+  state_.Invalidate();
+  glDeleteVertexArrays(1, &vertex_array_);
+  const GLuint kBuffers[] {
+    vertex_buffer_, index_buffer_, instance_buffer_, command_buffer_
+  };
+  glDeleteBuffers(command_buffer_ != 0 ? 4 : 3, kBuffers);
+}
+
+MeshHandle MeshArena::AddMesh(const void* vertices, std::size_t vertex_count,
+                              const IndexBuffer& indices) {
+  // индексы переводятся в тип арены с её индексом перезапуска
+  const GLuint kRestartIndex { GetRestartIndex() };
+  std::vector<unsigned char> index_data(indices.count * index_size_);
+  for (std::size_t i { 0 }; i < static_cast<std::size_t>(indices.count);
+       i++) {
+    unsigned int index { indices.GetIndex(i) };
+    if (indices.mode == GL_TRIANGLE_STRIP &&
+        index == indices.restart_index) {
+      index = kRestartIndex;
+    } else if (index >= kRestartIndex) {
+      return kInvalidMeshHandle;
+    }
+
+    unsigned char* destination { index_data.data() + i * index_size_ };
+    if (index_size_ == 1) {
+      *destination = static_cast<unsigned char>(index);
+    } else if (index_size_ == 2) {
+      const std::uint16_t kIndex { static_cast<std::uint16_t>(index) };
+      std::memcpy(destination, &kIndex, sizeof(kIndex));
+    } else {
+      const std::uint32_t kIndex { index };
+      std::memcpy(destination, &kIndex, sizeof(kIndex));
+    }
+  }
+
+  const std::size_t kIndexCount { static_cast<std::size_t>(indices.count) };
+  TlsfHandle vertex_block { vertex_allocator_.Allocate(vertex_count) };
+  TlsfHandle index_block { index_allocator_.Allocate(kIndexCount) };
+  if (vertex_block == kInvalidTlsfHandle ||
+      index_block == kInvalidTlsfHandle) {
+    if (vertex_block != kInvalidTlsfHandle) {
+      vertex_allocator_.Free(vertex_block);
+    }
+    if (index_block != kInvalidTlsfHandle) {
+      index_allocator_.Free(index_block);
+    }
+
+    // после переноса всё свободное место -- один участок в конце
+    Reallocate(GetRequiredCapacity(vertex_allocator_, vertex_count),
+               GetRequiredCapacity(index_allocator_, kIndexCount));
+    vertex_block = vertex_allocator_.Allocate(vertex_count);
+    index_block = index_allocator_.Allocate(kIndexCount);
+    if (vertex_block == kInvalidTlsfHandle ||
+        index_block == kInvalidTlsfHandle) {
+      if (vertex_block != kInvalidTlsfHandle) {
+        vertex_allocator_.Free(vertex_block);
+      }
+      if (index_block != kInvalidTlsfHandle) {
+        index_allocator_.Free(index_block);
+      }
+      return kInvalidMeshHandle;
+    }
+  }
+
+  state_.BindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer_);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  vertex_allocator_.GetOffset(vertex_block) * vertex_size_,
+                  vertex_count * vertex_size_, vertices);
+  state_.BindBuffer(GL_COPY_WRITE_BUFFER, index_buffer_);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  index_allocator_.GetOffset(index_block) * index_size_,
+                  index_data.size(), index_data.data());
+
+  const Mesh kMesh {
+    vertex_block, index_block, static_cast<GLuint>(kIndexCount), indices.mode
+  };
+  if (!spare_meshes_.empty()) {
+    const MeshHandle kHandle { spare_meshes_.back() };
+    spare_meshes_.pop_back();
+    meshes_[kHandle] = kMesh;
+    return kHandle;
+  }
+
+  meshes_.push_back(kMesh);
+  return static_cast<MeshHandle>(meshes_.size() - 1);
+}
+
+void MeshArena::RemoveMesh(MeshHandle mesh) {
+  vertex_allocator_.Free(meshes_[mesh].vertices);
+  index_allocator_.Free(meshes_[mesh].indices);
+  spare_meshes_.push_back(mesh);
+}
+
+void MeshArena::Defragment() {
+  Reallocate(vertex_allocator_.GetCapacity(),
+             index_allocator_.GetCapacity());
+}
+
+GLenum MeshArena::GetMode(MeshHandle mesh) const {
+  return meshes_[mesh].mode;
+}
+
+GLuint MeshArena::GetRestartIndex() const {
+  return static_cast<GLuint>((std::uint64_t { 1 } << (8 * index_size_)) - 1);
+}
+
+DrawElementsIndirectCommand MeshArena::GetDrawCommand(
+    MeshHandle mesh, GLuint instance_count, GLuint base_instance) const {
+  const Mesh& kMesh { meshes_[mesh] };
+  return DrawElementsIndirectCommand {
+    kMesh.index_count, instance_count,
+    static_cast<GLuint>(index_allocator_.GetOffset(kMesh.indices)),
+    static_cast<GLint>(vertex_allocator_.GetOffset(kMesh.vertices)),
+    base_instance
+  };
+}
+
+void MeshArena::Draw(const DrawCommandBuilder& builder) {
+  const std::vector<DrawElementsIndirectCommand>& kCommands {
+    builder.GetCommands()
+  };
+  if (kCommands.empty()) {
+    return;
+  }
+  command_count_ += kCommands.size();
+
+  state_.BindVertexArray(vertex_array_);
+
+  if (indirect_) {
+    const std::size_t kSize {
+      kCommands.size() * sizeof(DrawElementsIndirectCommand)
+    };
+    state_.BindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+    // буфер команд каждый раз заменяется новым, чтобы не ждать GPU
+    command_capacity_ = std::max(command_capacity_, kSize);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, command_capacity_, nullptr,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, kSize, kCommands.data());
+
+    for (const DrawCommandRun& kRun : builder.GetRuns()) {
+      glMultiDrawElementsIndirect(
+          kRun.mode, index_type_,
+          reinterpret_cast<const void*>(kRun.first *
+                                        sizeof(DrawElementsIndirectCommand)),
+          static_cast<GLsizei>(kRun.count), 0);
+      draw_call_count_++;
+    }
+    return;
+  }
+
+  for (const DrawCommandRun& kRun : builder.GetRuns()) {
+    for (std::size_t i { kRun.first }; i < kRun.first + kRun.count; i++) {
+      const DrawElementsIndirectCommand& kCommand { kCommands[i] };
+      assert(kCommand.base_instance + kCommand.instance_count <=
+             max_instance_count_);
+
+      SetBaseInstance(kCommand.base_instance);
+      glDrawElementsInstancedBaseVertex(
+          kRun.mode, static_cast<GLsizei>(kCommand.count), index_type_,
+          reinterpret_cast<const void*>(kCommand.first_index * index_size_),
+          static_cast<GLsizei>(kCommand.instance_count),
+          kCommand.base_vertex);
+      draw_call_count_++;
+    }
+  }
+}
+
+bool MeshArena::IsIndirect() const {
+  return indirect_;
+}
+
+std::size_t MeshArena::GetDrawCallCount() const {
+  return draw_call_count_;
+}
+
+std::size_t MeshArena::GetCommandCount() const {
+  return command_count_;
+}
+
+std::size_t MeshArena::GetDefragmentCount() const {
+  return defragment_count_;
+}
+
+const TlsfAllocator& MeshArena::GetVertexAllocator() const {
+  return vertex_allocator_;
+}
+
+const TlsfAllocator& MeshArena::GetIndexAllocator() const {
+  return index_allocator_;
+}
+
+void MeshArena::Reallocate(std::size_t vertex_capacity,
+                           std::size_t index_capacity) {
+  defragment_count_++;
+
+  // Буфер OpenGL нельзя увеличить на месте, а перекрывающиеся диапазоны
+  // нельзя копировать внутри одного буфера, поэтому сетки переносятся в
+  // новые буферы.
+  std::vector<TlsfMove> moves { };
+
+  vertex_allocator_.Defragment(moves);
+  vertex_allocator_.Grow(vertex_capacity);
+  const GLuint kVertexBuffer {
+    CreateBuffer(state_, vertex_capacity * vertex_size_)
+  };
+  CopyBlocks(state_, vertex_buffer_, kVertexBuffer,
+             vertex_allocator_.GetUsedSize(), moves, vertex_size_);
+  DeleteBuffer(state_, vertex_buffer_);
+  vertex_buffer_ = kVertexBuffer;
+
+  index_allocator_.Defragment(moves);
+  index_allocator_.Grow(index_capacity);
+  const GLuint kIndexBuffer {
+    CreateBuffer(state_, index_capacity * index_size_)
+  };
+  CopyBlocks(state_, index_buffer_, kIndexBuffer,
+             index_allocator_.GetUsedSize(), moves, index_size_);
+  DeleteBuffer(state_, index_buffer_);
+  index_buffer_ = kIndexBuffer;
+
+  SetupVertexArray();
+}
+
+void MeshArena::SetupVertexArray() {
+  // Новый массив создаётся до удаления старого, чтобы его имя не совпало
+  // с именем, которое помнит кэш состояния.
+  const GLuint kPrevious { vertex_array_ };
+  glGenVertexArrays(1, &vertex_array_);
+  state_.BindVertexArray(vertex_array_);
+
+  state_.BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  setup_attributes_();
+
+  state_.BindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+  glVertexAttribIPointer(instance_location_, 1, GL_UNSIGNED_INT, 0, nullptr);
+  glVertexAttribDivisor(instance_location_, 1);
+  glEnableVertexAttribArray(instance_location_);
+
+  state_.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+
+  if (kPrevious != 0) {
+    glDeleteVertexArrays(1, &kPrevious);
+  }
+}
+
+void MeshArena::SetBaseInstance(GLuint base_instance) {
+  // Без base_instance в вызове отрисовки атрибут номера экземпляра
+  // читается со смещением.
+  state_.BindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+  glVertexAttribIPointer(
+      instance_location_, 1, GL_UNSIGNED_INT, 0,
+      reinterpret_cast<const void*>(base_instance * sizeof(GLuint)));
+}
@@ -0,0 +1,499 @@
+#include "mesh_generator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "job_system.hpp"
+
+namespace {
+
+// число углов в блоке TrigKernel::kAngleAddition
+constexpr std::size_t kAngleBlockSize { 64 };
+
+// Число элементов в части при распределении работы между потоками. Кратно
+// kAngleBlockSize, чтобы блоки углов TrigKernel::kAngleAddition, а значит и
+// результат, не зависели от числа потоков.
+constexpr std::size_t kGrainSize { 1 << 15 };
+
+static_assert(kGrainSize % kAngleBlockSize == 0);
+
+// Число строк по row_size элементов в части. Если строки соответствуют
+// углам из AngleTable, оно кратно kAngleBlockSize.
+std::size_t GetRowGrainSize(std::size_t row_size, bool is_angle) {
+  const std::size_t kRowCount {
+    std::max<std::size_t>(1, kGrainSize / row_size)
+  };
+  if (!is_angle) {
+    return kRowCount;
+  }
+  return (kRowCount + kAngleBlockSize - 1) / kAngleBlockSize *
+         kAngleBlockSize;
+}
+
+// Вызывает function(begin, end) для непересекающихся диапазонов,
+// покрывающих [0; count): без планировщика -- для всего диапазона сразу, с
+// планировщиком -- параллельно для частей с границами, кратными
+// grain_size.
+template <typename Function>
+void ParallelFor(JobSystem* jobs, std::size_t count, std::size_t grain_size,
+                 const Function& function) {
+  if (!jobs) {
+    function(std::size_t { 0 }, count);
+    return;
+  }
+  jobs->ParallelFor(count, grain_size, function);
+}
+
+// Синусы и косинусы углов i * step.
+class AngleTable {
+ public:
+  AngleTable(double step, TrigKernel kernel)
+      : step_ { step },
+        kernel_ { kernel } {
+    if (kernel_ == TrigKernel::kAngleAddition) {
+      for (std::size_t i { 0 }; i < kAngleBlockSize; i++) {
+        cos_[i] = std::cos(i * step_);
+        sin_[i] = std::sin(i * step_);
+      }
+    }
+  }
+
+  // Вычисляет значения для углов с номерами [begin; begin + count), где
+  // count не превышает kAngleBlockSize.
+  void Compute(std::size_t begin, std::size_t count, double* cos_values,
+               double* sin_values) const {
+    assert(count <= kAngleBlockSize);
+
+    if (kernel_ == TrigKernel::kExact) {
+      for (std::size_t i { 0 }; i < count; i++) {
+        const double kAngle { (begin + i) * step_ };
+        cos_values[i] = std::cos(kAngle);
+        sin_values[i] = std::sin(kAngle);
+      }
+      return;
+    }
+
+    // cos(a + b) = cos a cos b - sin a sin b,
+    // sin(a + b) = sin a cos b + cos a sin b;
+    // итерации независимы и векторизуются компилятором
+    const double kBaseAngle { begin * step_ };
+    const double kBaseCos { std::cos(kBaseAngle) };
+    const double kBaseSin { std::sin(kBaseAngle) };
+    for (std::size_t i { 0 }; i < count; i++) {
+      cos_values[i] = kBaseCos * cos_[i] - kBaseSin * sin_[i];
+      sin_values[i] = kBaseSin * cos_[i] + kBaseCos * sin_[i];
+    }
+  }
+
+ private:
+  double step_;
+  TrigKernel kernel_;
+  double cos_[kAngleBlockSize];
+  double sin_[kAngleBlockSize];
+};
+
+// Вызывает function(i, cos, sin) для углов с номерами [begin; end).
+template <typename Function>
+void ForEachAngle(const AngleTable& table, std::size_t begin, std::size_t end,
+                  Function function) {
+  double cos_values[kAngleBlockSize];
+  double sin_values[kAngleBlockSize];
+
+  for (std::size_t block { begin }; block < end; block += kAngleBlockSize) {
+    const std::size_t kCount { std::min(kAngleBlockSize, end - block) };
+    table.Compute(block, kCount, cos_values, sin_values);
+
+    for (std::size_t i { 0 }; i < kCount; i++) {
+      function(block + i, cos_values[i], sin_values[i]);
+    }
+  }
+}
+
+void WriteVertex(double* vertex, double x, double y, double z, double u,
+                 double v) {
+  vertex[0] = x;
+  vertex[1] = y;
+  vertex[2] = z;
+  vertex[3] = u;
+  vertex[4] = v;
+}
+
+void WriteTriangle(unsigned int* triangle, unsigned int a, unsigned int b,
+                   unsigned int c) {
+  triangle[0] = a;
+  triangle[1] = b;
+  triangle[2] = c;
+}
+
+}  // namespace
+
+MeshSize GetCylinderMeshSize(unsigned int sector_count) {
+  // Для каждой вершины последовательно записываются 3 позиционные и 2
+  // текстурные координаты. Для каждого сектора (и замыкающего повтора
+  // первого) записываются две вершины с одинаковыми x и y, но
+  // противоположными z. Отсюда 10 = 2 * (3 + 2). Грань цилиндра строится из
+  // двух треугольников, каждый из которых задаётся тремя индексами. Отсюда
+  // 6 = 2 * 3.
+  return { 10 * (std::size_t { sector_count } + 1),
+           6 * std::size_t { sector_count } };
+}
+
+bool GenerateCylinderCoordinates(unsigned int sector_count, double radius,
+                                 double height, double* coordinates,
+                                 std::size_t coordinate_count,
+                                 TrigKernel kernel, JobSystem* jobs) {
+  const MeshSize kSize { GetCylinderMeshSize(sector_count) };
+  if (sector_count < 3 || coordinate_count < kSize.coordinate_count) {
+    return false;
+  }
+
+  const AngleTable kTable { 2.0f * M_PI / sector_count, kernel };
+
+  ParallelFor(jobs, std::size_t { sector_count } + 1, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    ForEachAngle(kTable, begin, end, [&](std::size_t i, double cos_value,
+                                         double sin_value) {
+      const double kPositionX { radius * cos_value };
+      const double kPositionY { radius * sin_value };
+      const double kTextureX { static_cast<double>(i) / sector_count };
+
+      // верхняя и нижняя вершины
+      double* vertex { coordinates + 10 * i };
+      WriteVertex(vertex, kPositionX, kPositionY, 0.5f * height, kTextureX,
+                  1.0f);
+      WriteVertex(vertex + 5, kPositionX, kPositionY, -0.5f * height,
+                  kTextureX, 0.0f);
+    });
+  });
+
+  return true;
+}
+
+bool GenerateCylinderIndices(unsigned int sector_count, unsigned int* indices,
+                             std::size_t index_count, JobSystem* jobs) {
+  const MeshSize kSize { GetCylinderMeshSize(sector_count) };
+  if (sector_count < 3 || index_count < kSize.index_count) {
+    return false;
+  }
+
+  ParallelFor(jobs, sector_count, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i { begin }; i < end; i++) {
+      const unsigned int kDoubleI { static_cast<unsigned int>(2 * i) };
+
+      // верхняя левая, нижняя левая и верхняя правая вершины
+      WriteTriangle(indices + 6 * i, kDoubleI, kDoubleI + 1, kDoubleI + 2);
+      // нижняя левая, верхняя правая и нижняя правая вершины
+      WriteTriangle(indices + 6 * i + 3, kDoubleI + 1, kDoubleI + 2,
+                    kDoubleI + 3);
+    }
+  });
+
+  return true;
+}
+
+MeshSize GetCappedCylinderMeshSize(unsigned int sector_count) {
+  const MeshSize kSide { GetCylinderMeshSize(sector_count) };
+
+  // каждое основание -- центр и sector_count + 1 вершин окружности,
+  // sector_count треугольников
+  return { kSide.coordinate_count + 2 * 5 * (std::size_t { sector_count } + 2),
+           kSide.index_count + 2 * 3 * std::size_t { sector_count } };
+}
+
+bool GenerateCappedCylinderCoordinates(unsigned int sector_count,
+                                       double radius, double height,
+                                       double* coordinates,
+                                       std::size_t coordinate_count,
+                                       TrigKernel kernel, JobSystem* jobs) {
+  const MeshSize kSize { GetCappedCylinderMeshSize(sector_count) };
+  if (sector_count < 3 || coordinate_count < kSize.coordinate_count) {
+    return false;
+  }
+
+  const std::size_t kSideCount {
+    GetCylinderMeshSize(sector_count).coordinate_count
+  };
+  GenerateCylinderCoordinates(sector_count, radius, height, coordinates,
+                              kSideCount, kernel, jobs);
+
+  double* top { coordinates + kSideCount };
+  double* bottom { top + 5 * (std::size_t { sector_count } + 2) };
+  WriteVertex(top, 0.0, 0.0, 0.5 * height, 0.5, 0.5);
+  WriteVertex(bottom, 0.0, 0.0, -0.5 * height, 0.5, 0.5);
+
+  const AngleTable kTable { 2.0 * M_PI / sector_count, kernel };
+
+  ParallelFor(jobs, std::size_t { sector_count } + 1, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    ForEachAngle(kTable, begin, end, [&](std::size_t i, double cos_value,
+                                         double sin_value) {
+      const double kPositionX { radius * cos_value };
+      const double kPositionY { radius * sin_value };
+
+      // нижнее основание отражается по v, чтобы при взгляде снизу текстура
+      // не выглядела зеркальной
+      WriteVertex(top + 5 * (i + 1), kPositionX, kPositionY, 0.5 * height,
+                  0.5 + 0.5 * cos_value, 0.5 + 0.5 * sin_value);
+      WriteVertex(bottom + 5 * (i + 1), kPositionX, kPositionY, -0.5 * height,
+                  0.5 + 0.5 * cos_value, 0.5 - 0.5 * sin_value);
+    });
+  });
+
+  return true;
+}
+
+bool GenerateCappedCylinderIndices(unsigned int sector_count,
+                                   unsigned int* indices,
+                                   std::size_t index_count, JobSystem* jobs) {
+  const MeshSize kSize { GetCappedCylinderMeshSize(sector_count) };
+  if (sector_count < 3 || index_count < kSize.index_count) {
+    return false;
+  }
+
+  const MeshSize kSide { GetCylinderMeshSize(sector_count) };
+  GenerateCylinderIndices(sector_count, indices, kSide.index_count, jobs);
+
+  const unsigned int kTopCenter {
+    static_cast<unsigned int>(kSide.coordinate_count / 5)
+  };
+  const unsigned int kBottomCenter { kTopCenter + sector_count + 2 };
+
+  unsigned int* top { indices + kSide.index_count };
+  unsigned int* bottom { top + 3 * std::size_t { sector_count } };
+
+  ParallelFor(jobs, sector_count, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i { begin }; i < end; i++) {
+      const unsigned int kRing { static_cast<unsigned int>(i) + 1 };
+
+      // обход оснований выбран так, чтобы их лицевые стороны смотрели наружу
+      WriteTriangle(top + 3 * i, kTopCenter, kTopCenter + kRing,
+                    kTopCenter + kRing + 1);
+      WriteTriangle(bottom + 3 * i, kBottomCenter, kBottomCenter + kRing + 1,
+                    kBottomCenter + kRing);
+    }
+  });
+
+  return true;
+}
+
+MeshSize GetConeMeshSize(unsigned int sector_count) {
+  // Вершина конуса повторяется для каждого сектора, чтобы у каждой боковой
+  // грани была своя текстурная координата u вершины.
+  return { 10 * (std::size_t { sector_count } + 1),
+           3 * std::size_t { sector_count } };
+}
+
+bool GenerateConeCoordinates(unsigned int sector_count, double radius,
+                             double height, double* coordinates,
+                             std::size_t coordinate_count,
+                             TrigKernel kernel, JobSystem* jobs) {
+  const MeshSize kSize { GetConeMeshSize(sector_count) };
+  if (sector_count < 3 || coordinate_count < kSize.coordinate_count) {
+    return false;
+  }
+
+  const AngleTable kTable { 2.0 * M_PI / sector_count, kernel };
+
+  ParallelFor(jobs, std::size_t { sector_count } + 1, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    ForEachAngle(kTable, begin, end, [&](std::size_t i, double cos_value,
+                                         double sin_value) {
+      const double kTextureX { static_cast<double>(i) / sector_count };
+
+      double* vertex { coordinates + 10 * i };
+      WriteVertex(vertex, 0.0, 0.0, 0.5 * height, kTextureX, 1.0);
+      WriteVertex(vertex + 5, radius * cos_value, radius * sin_value,
+                  -0.5 * height, kTextureX, 0.0);
+    });
+  });
+
+  return true;
+}
+
+bool GenerateConeIndices(unsigned int sector_count, unsigned int* indices,
+                         std::size_t index_count, JobSystem* jobs) {
+  const MeshSize kSize { GetConeMeshSize(sector_count) };
+  if (sector_count < 3 || index_count < kSize.index_count) {
+    return false;
+  }
+
+  ParallelFor(jobs, sector_count, kGrainSize,
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i { begin }; i < end; i++) {
+      const unsigned int kDoubleI { static_cast<unsigned int>(2 * i) };
+
+      // вершина конуса, левая и правая вершины основания
+      WriteTriangle(indices + 3 * i, kDoubleI, kDoubleI + 1, kDoubleI + 3);
+    }
+  });
+
+  return true;
+}
+
+MeshSize GetSphereMeshSize(unsigned int sector_count,
+                           unsigned int stack_count) {
+  // Полюсные пояса состоят из одного треугольника на сектор, остальные --
+  // из двух.
+  return { 5 * (std::size_t { sector_count } + 1) * (stack_count + 1),
+           6 * std::size_t { sector_count } * (stack_count - 1) };
+}
+
+bool GenerateSphereCoordinates(unsigned int sector_count,
+                               unsigned int stack_count, double radius,
+                               double* coordinates,
+                               std::size_t coordinate_count,
+                               TrigKernel kernel, JobSystem* jobs) {
+  const MeshSize kSize { GetSphereMeshSize(sector_count, stack_count) };
+  if (sector_count < 3 || stack_count < 2 ||
+      coordinate_count < kSize.coordinate_count) {
+    return false;
+  }
+
+  const AngleTable kSectorTable { 2.0 * M_PI / sector_count, kernel };
+  const double kStackStep { M_PI / stack_count };
+  const std::size_t kRowSize { std::size_t { sector_count } + 1 };
+
+  ParallelFor(jobs, std::size_t { stack_count } + 1,
+              GetRowGrainSize(kRowSize, false),
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t stack { begin }; stack < end; stack++) {
+      // угол между радиусом и плоскостью xy, от pi / 2 до -pi / 2
+      const double kStackAngle { M_PI / 2 - stack * kStackStep };
+      const double kRingRadius { radius * std::cos(kStackAngle) };
+      const double kZ { radius * std::sin(kStackAngle) };
+      const double kTextureY {
+        1.0 - static_cast<double>(stack) / stack_count
+      };
+
+      double* row { coordinates + 5 * kRowSize * stack };
+      ForEachAngle(kSectorTable, 0, kRowSize, [&](std::size_t i,
+                                                  double cos_value,
+                                                  double sin_value) {
+        WriteVertex(row + 5 * i, kRingRadius * cos_value,
+                    kRingRadius * sin_value, kZ,
+                    static_cast<double>(i) / sector_count, kTextureY);
+      });
+    }
+  });
+
+  return true;
+}
+
+bool GenerateSphereIndices(unsigned int sector_count, unsigned int stack_count,
+                           unsigned int* indices, std::size_t index_count,
+                           JobSystem* jobs) {
+  const MeshSize kSize { GetSphereMeshSize(sector_count, stack_count) };
+  if (sector_count < 3 || stack_count < 2 || index_count < kSize.index_count) {
+    return false;
+  }
+
+  const std::size_t kRowSize { std::size_t { sector_count } + 1 };
+
+  ParallelFor(jobs, stack_count, GetRowGrainSize(sector_count, false),
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t stack { begin }; stack < end; stack++) {
+      // верхний пояс содержит 3 * sector_count индексов, следующие -- по
+      // 6 * sector_count
+      unsigned int* triangle {
+        indices + (stack == 0 ? 0 : 3 * sector_count +
+                                    6 * sector_count * (stack - 1))
+      };
+
+      const unsigned int kTop { static_cast<unsigned int>(stack * kRowSize) };
+      const unsigned int kBottom {
+        static_cast<unsigned int>(kTop + kRowSize)
+      };
+
+      for (unsigned int i { 0 }; i < sector_count; i++) {
+        if (stack != 0) {
+          WriteTriangle(triangle, kTop + i, kBottom + i, kTop + i + 1);
+          triangle += 3;
+        }
+        if (stack != stack_count - 1) {
+          WriteTriangle(triangle, kTop + i + 1, kBottom + i, kBottom + i + 1);
+          triangle += 3;
+        }
+      }
+    }
+  });
+
+  return true;
+}
+
+MeshSize GetTorusMeshSize(unsigned int sector_count, unsigned int side_count) {
+  return { 5 * (std::size_t { sector_count } + 1) * (side_count + 1),
+           6 * std::size_t { sector_count } * side_count };
+}
+
+bool GenerateTorusCoordinates(unsigned int sector_count,
+                              unsigned int side_count, double major_radius,
+                              double minor_radius, double* coordinates,
+                              std::size_t coordinate_count,
+                              TrigKernel kernel, JobSystem* jobs) {
+  const MeshSize kSize { GetTorusMeshSize(sector_count, side_count) };
+  if (sector_count < 3 || side_count < 3 ||
+      coordinate_count < kSize.coordinate_count) {
+    return false;
+  }
+
+  const AngleTable kSectorTable { 2.0 * M_PI / sector_count, kernel };
+  const AngleTable kSideTable { 2.0 * M_PI / side_count, kernel };
+  const std::size_t kRowSize { std::size_t { side_count } + 1 };
+
+  ParallelFor(jobs, std::size_t { sector_count } + 1,
+              GetRowGrainSize(kRowSize, true),
+              [&](std::size_t begin, std::size_t end) {
+    ForEachAngle(kSectorTable, begin, end, [&](std::size_t sector,
+                                               double sector_cos,
+                                               double sector_sin) {
+      const double kTextureX { static_cast<double>(sector) / sector_count };
+
+      double* row { coordinates + 5 * kRowSize * sector };
+      ForEachAngle(kSideTable, 0, kRowSize, [&](std::size_t side,
+                                                double side_cos,
+                                                double side_sin) {
+        const double kRingRadius { major_radius + minor_radius * side_cos };
+        WriteVertex(row + 5 * side, kRingRadius * sector_cos,
+                    kRingRadius * sector_sin, minor_radius * side_sin,
+                    kTextureX, static_cast<double>(side) / side_count);
+      });
+    });
+  });
+
+  return true;
+}
+
+bool GenerateTorusIndices(unsigned int sector_count, unsigned int side_count,
+                          unsigned int* indices, std::size_t index_count,
+                          JobSystem* jobs) {
+  const MeshSize kSize { GetTorusMeshSize(sector_count, side_count) };
+  if (sector_count < 3 || side_count < 3 || index_count < kSize.index_count) {
+    return false;
+  }
+
+  const unsigned int kRowSize { side_count + 1 };
+
+  ParallelFor(jobs, sector_count, GetRowGrainSize(side_count, false),
+              [&](std::size_t begin, std::size_t end) {
+    for (std::size_t sector { begin }; sector < end; sector++) {
+      unsigned int* triangle { indices + 6 * side_count * sector };
+      const unsigned int kLeft {
+        static_cast<unsigned int>(sector * kRowSize)
+      };
+      const unsigned int kRight { kLeft + kRowSize };
+
+      for (unsigned int side { 0 }; side < side_count; side++) {
+        WriteTriangle(triangle, kLeft + side, kRight + side,
+                      kLeft + side + 1);
+        WriteTriangle(triangle + 3, kLeft + side + 1, kRight + side,
+                      kRight + side + 1);
+        triangle += 6;
+      }
+    }
+  });
+
+  return true;
+}
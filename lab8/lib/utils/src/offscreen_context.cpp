@@ -0,0 +1,147 @@
+#include "offscreen_context.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace {
+
+bool HasExtension(const char* extensions, const char* name) {
+  if (!extensions) {
+    return false;
+  }
+
+  const std::size_t kLength { std::strlen(name) };
+  for (const char* c { std::strstr(extensions, name) }; c;
+       c = std::strstr(c + 1, name)) {
+    const bool kStarts { c == extensions || c[-1] == ' ' };
+    const bool kEnds { c[kLength] == '\0' || c[kLength] == ' ' };
+    if (kStarts && kEnds) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+EGLDisplay GetDisplay() {
+  const char* kClientExtensions {
+    eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS)
+  };
+
+  if (HasExtension(kClientExtensions, "EGL_MESA_platform_surfaceless")) {
+    const auto kGetPlatformDisplay {
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"))
+    };
+    if (kGetPlatformDisplay) {
+      const EGLDisplay kDisplay {
+        kGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY,
+                            nullptr)
+      };
+      if (kDisplay != EGL_NO_DISPLAY) {
+        return kDisplay;
+      }
+    }
+  }
+
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+}  // namespace
+
+OffscreenContext::OffscreenContext()
+    : display_ { EGL_NO_DISPLAY },
+      surface_ { EGL_NO_SURFACE },
+      context_ { EGL_NO_CONTEXT } { }
+
+OffscreenContext::~OffscreenContext() {
+  if (display_ == EGL_NO_DISPLAY) {
+    return;
+  }
+
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context_ != EGL_NO_CONTEXT) {
+    eglDestroyContext(display_, context_);
+  }
+  if (surface_ != EGL_NO_SURFACE) {
+    eglDestroySurface(display_, surface_);
+  }
+  eglTerminate(display_);
+}
+
+bool OffscreenContext::Create() {
+  display_ = GetDisplay();
+  if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr,
+                                                   nullptr)) {
+    std::cerr << "Failed to initialize EGL" << std::endl;
+    display_ = EGL_NO_DISPLAY;
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cerr << "EGL does not support OpenGL" << std::endl;
+    return false;
+  }
+
+  // Поверхность не нужна: кадры рисуются в свой кадровый буфер. Если
+  // контекст без поверхности не поддерживается, создаётся pbuffer 1x1.
+  const bool kSurfaceless {
+    HasExtension(eglQueryString(display_, EGL_EXTENSIONS),
+                 "EGL_KHR_surfaceless_context")
+  };
+
+  const EGLint kConfigAttributes[] {
+    EGL_SURFACE_TYPE, kSurfaceless ? 0 : EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config { nullptr };
+  EGLint config_count { 0 };
+  if (!eglChooseConfig(display_, kConfigAttributes, &config, 1,
+                       &config_count) ||
+      config_count == 0) {
+    std::cerr << "Failed to choose an EGL config" << std::endl;
+    return false;
+  }
+
+  if (!kSurfaceless) {
+    const EGLint kSurfaceAttributes[] { EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                        EGL_NONE };
+    surface_ = eglCreatePbufferSurface(display_, config, kSurfaceAttributes);
+    if (surface_ == EGL_NO_SURFACE) {
+      std::cerr << "Failed to create an EGL pbuffer" << std::endl;
+      return false;
+    }
+  }
+
+  const EGLint kContextAttributes[] {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT,
+                              kContextAttributes);
+  if (context_ == EGL_NO_CONTEXT) {
+    std::cerr << "Failed to create an EGL context" << std::endl;
+    return false;
+  }
+
+  if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+    std::cerr << "Failed to make the EGL context current" << std::endl;
+    return false;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cerr << "Failed to initialize GLAD" << std::endl;
+    return false;
+  }
+
+  return true;
+}
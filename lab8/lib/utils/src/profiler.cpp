@@ -0,0 +1,400 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include <glad/glad.h>
+
+namespace {
+
+// дорожка трассы для участков GPU
+constexpr std::uint32_t kGpuThreadId { 0 };
+
+const std::chrono::steady_clock::time_point kStartTime {
+  std::chrono::steady_clock::now()
+};
+
+double ToMilliseconds(std::int64_t nanoseconds) {
+  return nanoseconds * 1e-6;
+}
+
+// Экранирует строку для JSON.
+void WriteJsonString(std::ostream& stream, const char* text) {
+  stream << '"';
+  for (const char* c { text }; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      stream << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      stream << ' ';
+    } else {
+      stream << *c;
+    }
+  }
+  stream << '"';
+}
+
+}  // namespace
+
+Profiler& Profiler::GetInstance() {
+  static Profiler profiler { };
+  return profiler;
+}
+
+Profiler::Profiler()
+    : frame_start_ { 0 },
+      frame_count_ { 0 },
+      trace_enabled_ { false },
+      max_trace_event_count_ { 0 },
+      dropped_trace_event_count_ { 0 },
+      gpu_timers_enabled_ { false },
+      gpu_time_offset_ { 0 } { }
+
+void Profiler::EnableTrace(std::size_t max_event_count) {
+  trace_enabled_ = true;
+  max_trace_event_count_ = max_event_count;
+  trace_events_.reserve(std::min<std::size_t>(max_event_count, 1 << 16));
+}
+
+bool Profiler::EnableGpuTimers() {
+  if (!GLAD_GL_VERSION_3_3) {
+    return false;
+  }
+
+  // сопоставление часов GPU с часами CPU
+  GLint64 gpu_time { 0 };
+  glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+  gpu_time_offset_ = GetTime() - static_cast<std::int64_t>(gpu_time);
+
+  gpu_timers_enabled_ = true;
+  return true;
+}
+
+void Profiler::DisableGpuTimers() {
+  if (!all_queries_.empty()) {
+    glDeleteQueries(static_cast<GLsizei>(all_queries_.size()),
+                    all_queries_.data());
+  }
+
+  all_queries_.clear();
+  free_queries_.clear();
+  gpu_events_.clear();
+  gpu_timers_enabled_ = false;
+}
+
+void Profiler::BeginFrame() {
+  frame_start_ = GetTime();
+}
+
+void Profiler::EndFrame() {
+  const std::int64_t kFrameEnd { GetTime() };
+
+  CollectCpuEvents();
+  CollectGpuEvents();
+  AddEvent("Frame", true, frame_start_, kFrameEnd,
+           GetThreadBuffer().thread_id);
+
+  for (auto& [name, zone] : zones_) {
+    if (zone.in_frame) {
+      if (zone.frame_totals.size() < kMaxZoneFrameCount) {
+        zone.frame_totals.push_back(zone.frame_total);
+      } else {
+        zone.frame_totals[zone.frame_count % kMaxZoneFrameCount] =
+            zone.frame_total;
+      }
+      zone.frame_count++;
+      zone.frame_total = 0;
+      zone.in_frame = false;
+    }
+  }
+
+  frame_count_++;
+}
+
+void Profiler::Reset() {
+  // события, записанные до сброса, тоже забываются
+  CollectCpuEvents();
+
+  frame_count_ = 0;
+  zones_.clear();
+  zone_order_.clear();
+
+  trace_enabled_ = false;
+  max_trace_event_count_ = 0;
+  trace_events_.clear();
+  dropped_trace_event_count_ = 0;
+}
+
+std::size_t Profiler::GetFrameCount() const {
+  return frame_count_;
+}
+
+std::vector<ZoneStatistics> Profiler::GetStatistics() const {
+  std::vector<ZoneStatistics> statistics { };
+
+  for (const std::string& name : zone_order_) {
+    const Zone& kZone { zones_.at(name) };
+    if (kZone.frame_totals.empty()) {
+      continue;
+    }
+
+    std::vector<std::int64_t> totals { kZone.frame_totals };
+    std::sort(totals.begin(), totals.end());
+
+    double sum { 0.0 };
+    for (std::int64_t total : totals) {
+      sum += total;
+    }
+
+    // ближайший ранг: не меньше 99% значений не превосходят p99
+    const std::size_t kP99Index {
+      static_cast<std::size_t>(std::ceil(0.99 * totals.size())) - 1
+    };
+
+    statistics.push_back(ZoneStatistics {
+      name, kZone.cpu, totals.size(), ToMilliseconds(totals.front()),
+      ToMilliseconds(static_cast<std::int64_t>(sum / totals.size())),
+      ToMilliseconds(totals[kP99Index])
+    });
+  }
+
+  return statistics;
+}
+
+void Profiler::PrintStatistics(std::ostream& stream) const {
+  stream << "Profile of " << frame_count_ << " frames (ms per frame";
+  if (frame_count_ > kMaxZoneFrameCount) {
+    stream << ", last " << kMaxZoneFrameCount << " frames";
+  }
+  stream << ")\n";
+  stream << std::left << std::setw(28) << "zone" << std::right
+         << std::setw(8) << "frames" << std::setw(10) << "min"
+         << std::setw(10) << "avg" << std::setw(10) << "p99" << '\n';
+
+  stream << std::fixed << std::setprecision(3);
+  for (const ZoneStatistics& zone : GetStatistics()) {
+    stream << std::left << std::setw(28) << zone.name << std::right
+           << std::setw(8) << zone.frame_count << std::setw(10)
+           << zone.min_ms << std::setw(10) << zone.average_ms
+           << std::setw(10) << zone.p99_ms << '\n';
+  }
+  stream << std::defaultfloat;
+
+  std::uint32_t dropped_count { 0 };
+  {
+    std::lock_guard<std::mutex> lock { buffers_mutex_ };
+    for (const auto& buffer : buffers_) {
+      dropped_count += buffer->dropped_count.load(std::memory_order_relaxed);
+    }
+  }
+  if (dropped_count > 0 || dropped_trace_event_count_ > 0) {
+    stream << "Dropped events: " << dropped_count << " (ring buffers), "
+           << dropped_trace_event_count_ << " (trace)\n";
+  }
+
+  stream.flush();
+}
+
+bool Profiler::WriteChromeTrace(const char* path) const {
+  std::ofstream file { path };
+  if (!file) {
+    return false;
+  }
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+       << kGpuThreadId << ",\"args\":{\"name\":\"GPU\"}}";
+
+  // время в микросекундах
+  file << std::fixed << std::setprecision(3);
+  for (const TraceEvent& event : trace_events_) {
+    file << ",\n{\"name\":";
+    WriteJsonString(file, event.name);
+    file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_id
+         << ",\"ts\":" << event.start * 1e-3
+         << ",\"dur\":" << (event.end - event.start) * 1e-3 << '}';
+  }
+  file << "\n]}\n";
+
+  return static_cast<bool>(file);
+}
+
+std::int64_t Profiler::GetTime() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - kStartTime)
+      .count();
+}
+
+void Profiler::RecordCpuEvent(const char* name, std::int64_t start,
+                              std::int64_t end) {
+  ThreadBuffer& buffer { GetThreadBuffer() };
+
+  const std::uint32_t kWriteIndex {
+    buffer.write_index.load(std::memory_order_relaxed)
+  };
+  if (kWriteIndex - buffer.read_index.load(std::memory_order_acquire) >=
+      ThreadBuffer::kCapacity) {
+    // EndFrame давно не вызывался; старые события не затираются
+    buffer.dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  buffer.events[kWriteIndex % ThreadBuffer::kCapacity] =
+      Event { name, start, end };
+  buffer.write_index.store(kWriteIndex + 1, std::memory_order_release);
+}
+
+int Profiler::BeginGpuEvent(const char* name) {
+  if (!gpu_timers_enabled_) {
+    return -1;
+  }
+
+  if (free_queries_.size() < 2) {
+    unsigned int queries[16] { };
+    glGenQueries(16, queries);
+    free_queries_.insert(free_queries_.end(), queries, queries + 16);
+    all_queries_.insert(all_queries_.end(), queries, queries + 16);
+  }
+
+  GpuEvent event { name, free_queries_.back(), 0, false };
+  free_queries_.pop_back();
+  event.end_query = free_queries_.back();
+  free_queries_.pop_back();
+
+  glQueryCounter(event.begin_query, GL_TIMESTAMP);
+  gpu_events_.push_back(event);
+
+  return static_cast<int>(gpu_events_.size()) - 1;
+}
+
+void Profiler::EndGpuEvent(int event) {
+  if (event < 0 || static_cast<std::size_t>(event) >= gpu_events_.size()) {
+    return;
+  }
+
+  glQueryCounter(gpu_events_[event].end_query, GL_TIMESTAMP);
+  gpu_events_[event].ended = true;
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer { };
+
+  if (!buffer) {
+    buffer = std::make_shared<ThreadBuffer>();
+
+    // буфер остаётся в списке и после завершения потока, чтобы EndFrame
+    // успел забрать его события
+    std::lock_guard<std::mutex> lock { buffers_mutex_ };
+    buffer->thread_id = static_cast<std::uint32_t>(buffers_.size()) + 1;
+    buffers_.push_back(buffer);
+  }
+
+  return *buffer;
+}
+
+void Profiler::AddEvent(const char* name, bool cpu, std::int64_t start,
+                        std::int64_t end, std::uint32_t thread_id) {
+  // участки CPU и GPU с одинаковыми именами учитываются отдельно
+  auto [iterator, inserted] = zones_.try_emplace(
+      cpu ? std::string { name } : std::string { "GPU " } + name);
+  Zone& zone { iterator->second };
+  if (inserted) {
+    zone.cpu = cpu;
+    zone.frame_total = 0;
+    zone.in_frame = false;
+    zone.frame_count = 0;
+    zone_order_.push_back(iterator->first);
+  }
+
+  zone.frame_total += end - start;
+  zone.in_frame = true;
+
+  if (!trace_enabled_) {
+    return;
+  }
+  if (trace_events_.size() >= max_trace_event_count_) {
+    dropped_trace_event_count_++;
+    return;
+  }
+  trace_events_.push_back(TraceEvent { name, start, end, thread_id });
+}
+
+void Profiler::CollectCpuEvents() {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers { };
+  {
+    std::lock_guard<std::mutex> lock { buffers_mutex_ };
+    buffers = buffers_;
+  }
+
+  for (const auto& buffer : buffers) {
+    const std::uint32_t kWriteIndex {
+      buffer->write_index.load(std::memory_order_acquire)
+    };
+    std::uint32_t read_index {
+      buffer->read_index.load(std::memory_order_relaxed)
+    };
+
+    for (; read_index != kWriteIndex; read_index++) {
+      const Event& kEvent {
+        buffer->events[read_index % ThreadBuffer::kCapacity]
+      };
+      AddEvent(kEvent.name, true, kEvent.start, kEvent.end,
+               buffer->thread_id);
+    }
+
+    buffer->read_index.store(read_index, std::memory_order_release);
+  }
+}
+
+void Profiler::CollectGpuEvents() {
+  // Результаты запросов приходят с задержкой в несколько кадров; события
+  // обрабатываются по порядку, пока результаты доступны.
+  std::size_t collected_count { 0 };
+
+  for (const GpuEvent& event : gpu_events_) {
+    if (!event.ended) {
+      break;
+    }
+
+    GLint available { 0 };
+    glGetQueryObjectiv(event.end_query, GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+      break;
+    }
+
+    GLuint64 begin_time { 0 };
+    GLuint64 end_time { 0 };
+    glGetQueryObjectui64v(event.begin_query, GL_QUERY_RESULT, &begin_time);
+    glGetQueryObjectui64v(event.end_query, GL_QUERY_RESULT, &end_time);
+
+    AddEvent(event.name, false,
+             static_cast<std::int64_t>(begin_time) + gpu_time_offset_,
+             static_cast<std::int64_t>(end_time) + gpu_time_offset_,
+             kGpuThreadId);
+
+    free_queries_.push_back(event.begin_query);
+    free_queries_.push_back(event.end_query);
+    collected_count++;
+  }
+
+  gpu_events_.erase(gpu_events_.begin(),
+                    gpu_events_.begin() + collected_count);
+}
+
+ScopedCpuTimer::ScopedCpuTimer(const char* name)
+    : name_ { name },
+      start_ { Profiler::GetTime() } { }
+
+ScopedCpuTimer::~ScopedCpuTimer() {
+  Profiler::GetInstance().RecordCpuEvent(name_, start_, Profiler::GetTime());
+}
+
+ScopedGpuTimer::ScopedGpuTimer(const char* name)
+    : event_ { Profiler::GetInstance().BeginGpuEvent(name) } { }
+
+ScopedGpuTimer::~ScopedGpuTimer() {
+  Profiler::GetInstance().EndGpuEvent(event_);
+}
@@ -0,0 +1,360 @@
+#include "shader_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Разбирает строку вида #include "имя"; для других строк возвращает false.
+bool ParseInclude(std::string_view line, std::string& name) {
+  auto skip_spaces = [&line] {
+    const std::size_t kFirst { line.find_first_not_of(" \t") };
+    line.remove_prefix(std::min(kFirst, line.size()));
+  };
+
+  skip_spaces();
+  if (line.empty() || line.front() != '#') {
+    return false;
+  }
+  line.remove_prefix(1);
+  skip_spaces();
+  constexpr std::string_view kInclude { "include" };
+  if (line.substr(0, kInclude.size()) != kInclude) {
+    return false;
+  }
+  line.remove_prefix(kInclude.size());
+  skip_spaces();
+  if (line.empty() || line.front() != '"') {
+    return false;
+  }
+  line.remove_prefix(1);
+
+  const std::size_t kEnd { line.find('"') };
+  if (kEnd == std::string_view::npos || kEnd == 0) {
+    return false;
+  }
+  name.assign(line.data(), kEnd);
+  return true;
+}
+
+std::string GetDirectory(const std::string& path) {
+  const std::size_t kSlash { path.find_last_of('/') };
+  return kSlash == std::string::npos ? std::string { } :
+                                       path.substr(0, kSlash + 1);
+}
+
+// Дописывает в source текст файла file_index из included, раскрывая
+// включения.
+bool AppendShaderFile(std::size_t file_index,
+                      std::vector<std::string>& included,
+                      std::string& source) {
+  const std::string kPath { included[file_index] };
+  std::string text { };
+  if (!ReadFile(kPath, text)) {
+    std::cerr << "Failed to read shader file " << kPath << std::endl;
+    return false;
+  }
+
+  std::string name { };
+  std::size_t line_number { 1 };
+  for (std::size_t begin { 0 }; begin < text.size(); line_number++) {
+    const std::size_t kEnd {
+      std::min(text.find('\n', begin), text.size())
+    };
+    const std::string_view kLine { text.data() + begin, kEnd - begin };
+    begin = kEnd + 1;
+
+    if (!ParseInclude(kLine, name)) {
+      source.append(kLine.data(), kLine.size());
+      source += '\n';
+      continue;
+    }
+
+    const std::string kIncludePath { GetDirectory(kPath) + name };
+    if (std::find(included.begin(), included.end(), kIncludePath) !=
+        included.end()) {
+      // пустая строка сохраняет нумерацию
+      source += '\n';
+      continue;
+    }
+
+    included.push_back(kIncludePath);
+    source += "#line 1 " + std::to_string(included.size() - 1) + '\n';
+    if (!AppendShaderFile(included.size() - 1, included, source)) {
+      std::cerr << "  included from " << kPath << ':' << line_number
+                << std::endl;
+      return false;
+    }
+    source += "#line " + std::to_string(line_number + 1) + ' ' +
+              std::to_string(file_index) + '\n';
+  }
+
+  return true;
+}
+
+std::string GetShaderInfoLog(GLuint shader) {
+  GLint length { 0 };
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+  std::string log(static_cast<std::size_t>(std::max(length, 1)), '\0');
+  glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+  log.resize(std::strlen(log.c_str()));
+  return log;
+}
+
+std::string GetProgramInfoLog(GLuint program) {
+  GLint length { 0 };
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+  std::string log(static_cast<std::size_t>(std::max(length, 1)), '\0');
+  glGetProgramInfoLog(program, length, nullptr, &log[0]);
+  log.resize(std::strlen(log.c_str()));
+  return log;
+}
+
+// Возвращает 0, если шейдер не скомпилировался.
+GLuint CompileShader(GLenum type, const std::string& source,
+                     const std::string& path) {
+  const GLuint kShader { glCreateShader(type) };
+  const char* text { source.c_str() };
+  glShaderSource(kShader, 1, &text, nullptr);
+  glCompileShader(kShader);
+
+  GLint success { 0 };
+  glGetShaderiv(kShader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    std::cerr << "Failed to compile " << path << '\n'
+              << GetShaderInfoLog(kShader) << std::endl;
+    glDeleteShader(kShader);
+    return 0;
+  }
+  return kShader;
+}
+
+bool IsLinked(GLuint program) {
+  GLint success { 0 };
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success != 0;
+}
+
+}  // namespace
+
+bool ReadFile(const std::string& path, std::string& contents) {
+  std::ifstream file { path, std::ios::binary | std::ios::ate };
+  if (!file) {
+    return false;
+  }
+
+  contents.resize(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0);
+  return static_cast<bool>(file.read(&contents[0], contents.size()));
+}
+
+bool PreprocessShader(const std::string& path, std::string& source) {
+  source.clear();
+  std::vector<std::string> included { path };
+  return AppendShaderFile(0, included, source);
+}
+
+std::uint64_t HashBytes(const void* data, std::size_t size,
+                        std::uint64_t hash) {
+  constexpr std::uint64_t kFnvPrime { 1099511628211ull };
+  const unsigned char* bytes { static_cast<const unsigned char*>(data) };
+  for (std::size_t i { 0 }; i < size; i++) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+ShaderCache::ShaderCache(std::string directory)
+    : directory_ { std::move(directory) },
+      enabled_ { false },
+      hit_count_ { 0 },
+      miss_count_ { 0 } {
+  for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+    const GLubyte* value { glGetString(name) };
+    if (value) {
+      driver_ += reinterpret_cast<const char*>(value);
+    }
+    driver_ += '\n';
+  }
+
+  GLint format_count { 0 };
+  if (!directory_.empty() && GLAD_GL_VERSION_4_1) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  }
+  enabled_ = format_count > 0;
+}
+
+GLuint ShaderCache::CreateProgram(const std::string& vertex_path,
+                                  const std::string& fragment_path) {
+  std::string vertex_source { };
+  std::string fragment_source { };
+  if (!PreprocessShader(vertex_path, vertex_source) ||
+      !PreprocessShader(fragment_path, fragment_source)) {
+    return 0;
+  }
+
+  // нулевой байт разделяет исходники, чтобы их граница входила в ключ
+  std::uint64_t key {
+    HashBytes(vertex_source.c_str(), vertex_source.size() + 1)
+  };
+  key = HashBytes(fragment_source.c_str(), fragment_source.size() + 1, key);
+  key = HashBytes(driver_.data(), driver_.size(), key);
+
+  if (enabled_) {
+    const GLuint kProgram { LoadBinary(key) };
+    if (kProgram != 0) {
+      hit_count_++;
+      return kProgram;
+    }
+    miss_count_++;
+  }
+
+  const GLuint kVertexShader {
+    CompileShader(GL_VERTEX_SHADER, vertex_source, vertex_path)
+  };
+  if (kVertexShader == 0) {
+    return 0;
+  }
+  const GLuint kFragmentShader {
+    CompileShader(GL_FRAGMENT_SHADER, fragment_source, fragment_path)
+  };
+  if (kFragmentShader == 0) {
+    glDeleteShader(kVertexShader);
+    return 0;
+  }
+
+  const GLuint kProgram { glCreateProgram() };
+  glAttachShader(kProgram, kVertexShader);
+  glAttachShader(kProgram, kFragmentShader);
+  if (enabled_) {
+    glProgramParameteri(kProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+  glLinkProgram(kProgram);
+
+  // после компоновки шейдеры не нужны
+  glDetachShader(kProgram, kVertexShader);
+  glDetachShader(kProgram, kFragmentShader);
+  glDeleteShader(kVertexShader);
+  glDeleteShader(kFragmentShader);
+
+  if (!IsLinked(kProgram)) {
+    std::cerr << "Failed to link the shader program\n"
+              << GetProgramInfoLog(kProgram) << std::endl;
+    glDeleteProgram(kProgram);
+    return 0;
+  }
+
+  if (enabled_) {
+    StoreBinary(kProgram, key);
+  }
+  return kProgram;
+}
+
+bool ShaderCache::IsEnabled() const {
+  return enabled_;
+}
+
+std::size_t ShaderCache::GetHitCount() const {
+  return hit_count_;
+}
+
+std::size_t ShaderCache::GetMissCount() const {
+  return miss_count_;
+}
+
+std::string ShaderCache::GetBinaryPath(std::uint64_t key) const {
+  char name[32] { };
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return directory_ + '/' + name;
+}
+
+GLuint ShaderCache::LoadBinary(std::uint64_t key) const {
+  std::string data { };
+  if (!ReadFile(GetBinaryPath(key), data) ||
+      data.size() < sizeof(ShaderBinaryHeader)) {
+    return 0;
+  }
+
+  ShaderBinaryHeader header { };
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, kShaderBinaryMagic, 4) != 0 ||
+      header.version != kShaderBinaryVersion || header.key != key ||
+      header.binary_size != data.size() - sizeof(header)) {
+    return 0;
+  }
+
+  // драйвер может отвергнуть представление, например после обновления
+  const GLuint kProgram { glCreateProgram() };
+  glProgramBinary(kProgram, header.format, data.data() + sizeof(header),
+                  static_cast<GLsizei>(header.binary_size));
+  if (!IsLinked(kProgram)) {
+    glDeleteProgram(kProgram);
+    return 0;
+  }
+  return kProgram;
+}
+
+void ShaderCache::StoreBinary(GLuint program, std::uint64_t key) const {
+  GLint length { 0 };
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::string data(sizeof(ShaderBinaryHeader) + length, '\0');
+  GLsizei binary_size { 0 };
+  GLenum format { 0 };
+  glGetProgramBinary(program, length, &binary_size, &format,
+                     &data[sizeof(ShaderBinaryHeader)]);
+  if (binary_size <= 0) {
+    return;
+  }
+  data.resize(sizeof(ShaderBinaryHeader) + binary_size);
+
+  ShaderBinaryHeader header { };
+  std::memcpy(header.magic, kShaderBinaryMagic, 4);
+  header.version = kShaderBinaryVersion;
+  header.key = key;
+  header.format = format;
+  header.binary_size = static_cast<std::uint32_t>(binary_size);
+  std::memcpy(&data[0], &header, sizeof(header));
+
+  std::error_code error { };
+  std::filesystem::create_directories(directory_, error);
+
+  // Файл появляется под своим именем только дописанным, поэтому другой
+  // запущенный процесс не прочитает его наполовину. Случайный суффикс
+  // отделяет временные файлы процессов, одновременно сохраняющих одну
+  // программу.
+  std::random_device random { };
+  char suffix[32] { };
+  std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", random(), random());
+  const std::string kPath { GetBinaryPath(key) };
+  const std::string kTemporaryPath { kPath + suffix };
+  {
+    std::ofstream file { kTemporaryPath, std::ios::binary };
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+      std::cerr << "Failed to write the shader cache " << kTemporaryPath
+                << std::endl;
+      file.close();
+      std::filesystem::remove(kTemporaryPath, error);
+      return;
+    }
+  }
+  std::filesystem::rename(kTemporaryPath, kPath, error);
+  if (error) {
+    std::filesystem::remove(kTemporaryPath, error);
+    std::cerr << "Failed to write the shader cache " << kPath << std::endl;
+  }
+}
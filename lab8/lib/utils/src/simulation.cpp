@@ -0,0 +1,146 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+#include "profiler.hpp"
+
+namespace {
+
+// Наибольшее число пропущенных шагов, выполняемых подряд. Если поток
+// отстал сильнее (например, процесс был остановлен), время шагов
+// сдвигается, чтобы не пытаться догнать его бесконечно.
+constexpr int kMaxCatchUpTicks { 32 };
+
+}  // namespace
+
+void StepSimulation(InstanceStore& store, float alpha_changing,
+                    float beta_changing) {
+  UpdateInstancePositions(store);
+  RotateInstances(store, alpha_changing, beta_changing);
+}
+
+SimulationThread::SimulationThread(InstanceStore initial_state,
+                                   double tick_rate)
+    : tick_duration_ {
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double> { 1.0 / tick_rate })
+      },
+      stopping_ { false } {
+  // снимок нулевого шага доступен сразу
+  const auto kNow { std::chrono::steady_clock::now() };
+  SimulationSnapshot& snapshot { snapshots_.GetWriteBuffer() };
+  snapshot.tick = 0;
+  snapshot.time = kNow;
+  snapshot.publish_time = kNow;
+  snapshot.late_input_count = 0;
+  snapshot.previous = initial_state;
+  snapshot.current = initial_state;
+  snapshots_.Publish();
+  snapshots_.Update();
+
+  thread_ = std::thread { &SimulationThread::Run, this,
+                          std::move(initial_state), kNow };
+}
+
+SimulationThread::~SimulationThread() {
+  Stop();
+}
+
+void SimulationThread::SetRotation(std::uint64_t tick, float alpha_changing,
+                                   float beta_changing) {
+  const std::lock_guard<std::mutex> kLock { input_mutex_ };
+  inputs_.push_back(RotationInput { tick, alpha_changing, beta_changing });
+}
+
+bool SimulationThread::Update() {
+  return snapshots_.Update();
+}
+
+const SimulationSnapshot& SimulationThread::GetSnapshot() const {
+  return snapshots_.GetReadBuffer();
+}
+
+float SimulationThread::GetInterpolationFactor(
+    std::chrono::steady_clock::time_point now) const {
+  const std::chrono::duration<float> kElapsed { now - GetSnapshot().time };
+  const std::chrono::duration<float> kTick { tick_duration_ };
+
+  return std::clamp(kElapsed / kTick, 0.0f, 1.0f);
+}
+
+std::chrono::steady_clock::duration SimulationThread::GetTickDuration()
+    const {
+  return tick_duration_;
+}
+
+void SimulationThread::Stop() {
+  stopping_.store(true, std::memory_order_relaxed);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SimulationThread::Run(InstanceStore state,
+                           std::chrono::steady_clock::time_point start) {
+  InstanceStore previous { };
+  std::uint64_t tick { 0 };
+  auto tick_time { start };
+  std::deque<RotationInput> inputs { };
+  std::vector<RotationInput> received { };
+  RotationInput rotation { 0, 0.0f, 0.0f };
+  std::uint64_t late_input_count { 0 };
+
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    tick_time += tick_duration_;
+    std::this_thread::sleep_until(tick_time);
+
+    const auto kNow { std::chrono::steady_clock::now() };
+    if (kNow - tick_time > kMaxCatchUpTicks * tick_duration_) {
+      tick_time = kNow;
+    }
+
+    {
+      const std::lock_guard<std::mutex> kLock { input_mutex_ };
+      received.swap(inputs_);
+    }
+    inputs.insert(inputs.end(), received.begin(), received.end());
+    received.clear();
+
+    // Все шаги, время которых наступило, выполняются подряд; публикуется
+    // только последний.
+    {
+      LAB8_PROFILE_SCOPE("Simulation");
+      while (true) {
+        tick++;
+        while (!inputs.empty() && inputs.front().tick <= tick) {
+          if (inputs.front().tick < tick) {
+            late_input_count++;
+          }
+          rotation = inputs.front();
+          inputs.pop_front();
+        }
+
+        previous = state;
+        StepSimulation(state, rotation.alpha_changing,
+                       rotation.beta_changing);
+
+        if (kNow < tick_time + tick_duration_) {
+          break;
+        }
+        tick_time += tick_duration_;
+      }
+    }
+
+    SimulationSnapshot& snapshot { snapshots_.GetWriteBuffer() };
+    snapshot.tick = tick;
+    snapshot.time = tick_time;
+    snapshot.late_input_count = late_input_count;
+    // копирование не выделяет память после первых трёх снимков
+    snapshot.previous = previous;
+    snapshot.current = state;
+    snapshot.publish_time = std::chrono::steady_clock::now();
+    snapshots_.Publish();
+  }
+}
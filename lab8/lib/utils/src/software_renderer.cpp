@@ -0,0 +1,594 @@
+#include "software_renderer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "profiler.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+std::uint32_t PackColor(float red, float green, float blue, float alpha) {
+  auto to_byte = [](float value) {
+    return static_cast<std::uint32_t>(
+        std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+  };
+
+  return to_byte(red) | (to_byte(green) << 8) | (to_byte(blue) << 16) |
+         (to_byte(alpha) << 24);
+}
+
+// Линейная интерполяция двух цветов RGBA8 с весом weight из [0; 256].
+std::uint32_t LerpColor(std::uint32_t a, std::uint32_t b,
+                        std::uint32_t weight) {
+  // красный и синий каналы обрабатываются вместе, зелёный и альфа -- вместе
+  const std::uint32_t kRedBlueA { a & 0x00ff00ffu };
+  const std::uint32_t kGreenAlphaA { (a >> 8) & 0x00ff00ffu };
+  const std::uint32_t kRedBlueB { b & 0x00ff00ffu };
+  const std::uint32_t kGreenAlphaB { (b >> 8) & 0x00ff00ffu };
+
+  const std::uint32_t kRedBlue {
+    ((kRedBlueA * (256 - weight) + kRedBlueB * weight) >> 8) & 0x00ff00ffu
+  };
+  const std::uint32_t kGreenAlpha {
+    ((kGreenAlphaA * (256 - weight) + kGreenAlphaB * weight) >> 8) &
+    0x00ff00ffu
+  };
+
+  return kRedBlue | (kGreenAlpha << 8);
+}
+
+// Билинейная выборка с повторением текстуры (GL_REPEAT, GL_LINEAR).
+std::uint32_t SampleBilinear(const SoftwareTexture& texture, float u, float v) {
+  const float kX { u * texture.width - 0.5f };
+  const float kY { v * texture.height - 0.5f };
+  const float kFloorX { std::floor(kX) };
+  const float kFloorY { std::floor(kY) };
+
+  const std::uint32_t kWeightX {
+    static_cast<std::uint32_t>((kX - kFloorX) * 256.0f)
+  };
+  const std::uint32_t kWeightY {
+    static_cast<std::uint32_t>((kY - kFloorY) * 256.0f)
+  };
+
+  auto wrap = [](int value, int size) {
+    value %= size;
+    return value < 0 ? value + size : value;
+  };
+
+  const int kX0 { wrap(static_cast<int>(kFloorX), texture.width) };
+  const int kY0 { wrap(static_cast<int>(kFloorY), texture.height) };
+  const int kX1 { kX0 + 1 == texture.width ? 0 : kX0 + 1 };
+  const int kY1 { kY0 + 1 == texture.height ? 0 : kY0 + 1 };
+
+  const std::uint32_t* kRow0 { texture.texels.data() + kY0 * texture.width };
+  const std::uint32_t* kRow1 { texture.texels.data() + kY1 * texture.width };
+
+  const std::uint32_t kTop { LerpColor(kRow0[kX0], kRow0[kX1], kWeightX) };
+  const std::uint32_t kBottom { LerpColor(kRow1[kX0], kRow1[kX1], kWeightX) };
+
+  return LerpColor(kTop, kBottom, kWeightY);
+}
+
+}  // namespace
+
+SoftwareFramebuffer::SoftwareFramebuffer(int width, int height)
+    : width { width },
+      height { height },
+      stride { (width + 3) & ~3 },
+      color(stride * height),
+      depth(stride * height) {
+  assert(width > 0 && height > 0);
+}
+
+void SoftwareFramebuffer::Clear(float red, float green, float blue,
+                                float alpha) {
+  std::fill(color.begin(), color.end(), PackColor(red, green, blue, alpha));
+  std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+bool SoftwareFramebuffer::WritePpm(const char* path) const {
+  std::FILE* file { std::fopen(path, "wb") };
+  if (!file) {
+    std::cerr << "Failed to open the output image" << std::endl;
+    return false;
+  }
+
+  std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+  std::vector<unsigned char> row(3 * width);
+  for (int y { 0 }; y < height; y++) {
+    for (int x { 0 }; x < width; x++) {
+      const std::uint32_t kColor { color[y * stride + x] };
+      row[3 * x] = kColor & 0xff;
+      row[3 * x + 1] = (kColor >> 8) & 0xff;
+      row[3 * x + 2] = (kColor >> 16) & 0xff;
+    }
+    std::fwrite(row.data(), 1, row.size(), file);
+  }
+
+  const bool kSuccess { !std::ferror(file) };
+  std::fclose(file);
+
+  if (!kSuccess) {
+    std::cerr << "Failed to write the output image" << std::endl;
+  }
+
+  return kSuccess;
+}
+
+SoftwareTexture::SoftwareTexture(const Image& image)
+    : width { image.width },
+      height { image.height },
+      texels(image.width * image.height) {
+  assert(image.channels >= 1 && image.channels <= 4);
+
+  for (std::size_t i { 0 }; i < texels.size(); i++) {
+    const unsigned char* kTexel { image.pixels.data() + i * image.channels };
+
+    std::uint32_t red { kTexel[0] };
+    std::uint32_t green { red };
+    std::uint32_t blue { red };
+    std::uint32_t alpha { 255 };
+    if (image.channels == 2) {
+      alpha = kTexel[1];
+    } else if (image.channels >= 3) {
+      green = kTexel[1];
+      blue = kTexel[2];
+      if (image.channels == 4) {
+        alpha = kTexel[3];
+      }
+    }
+
+    texels[i] = red | (green << 8) | (blue << 16) | (alpha << 24);
+  }
+}
+
+SoftwareRenderer::SoftwareRenderer(unsigned int thread_count)
+    : thread_count_ { thread_count },
+      generation_ { 0 },
+      remaining_ { 0 },
+      stopping_ { false },
+      coordinates_ { nullptr },
+      indices_ { nullptr },
+      transform_ { 1.0f },
+      texture_ { nullptr },
+      framebuffer_ { nullptr },
+      tiles_x_ { 0 },
+      tiles_y_ { 0 } {
+  if (thread_count_ == 0) {
+    thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  bins_.resize(thread_count_);
+  tile_ranges_.reset(new TileRange[thread_count_]);
+
+  // нулевым рабочим потоком служит поток, вызывающий Draw
+  for (unsigned int i { 1 }; i < thread_count_; i++) {
+    workers_.emplace_back(&SoftwareRenderer::WorkerLoop, this, i);
+  }
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    stopping_ = true;
+  }
+  start_condition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned int SoftwareRenderer::GetThreadCount() const {
+  return thread_count_;
+}
+
+void SoftwareRenderer::Draw(const std::vector<double>& coordinates,
+                            const std::vector<unsigned int>& indices,
+                            const glm::mat4& transform,
+                            const SoftwareTexture& texture,
+                            SoftwareFramebuffer& framebuffer) {
+  assert(coordinates.size() % 5 == 0);
+  assert(indices.size() % 3 == 0);
+
+  coordinates_ = &coordinates;
+  indices_ = &indices;
+  transform_ = transform;
+  texture_ = &texture;
+  framebuffer_ = &framebuffer;
+
+  tiles_x_ = (framebuffer.width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (framebuffer.height + kTileSize - 1) / kTileSize;
+
+  vertices_.resize(coordinates.size() / 5);
+  triangles_.resize(indices.size() / 3);
+  for (auto& worker_bins : bins_) {
+    worker_bins.resize(tiles_x_ * tiles_y_);
+    for (auto& bin : worker_bins) {
+      bin.clear();
+    }
+  }
+
+  const int kTileCount { tiles_x_ * tiles_y_ };
+  for (unsigned int i { 0 }; i < thread_count_; i++) {
+    tile_ranges_[i].next.store(kTileCount * i / thread_count_,
+                               std::memory_order_relaxed);
+    tile_ranges_[i].end = kTileCount * (i + 1) / thread_count_;
+  }
+
+  RunParallel([this](unsigned int worker_index) {
+    LAB8_PROFILE_SCOPE("Transform");
+    TransformVertices(worker_index);
+  });
+  RunParallel([this](unsigned int worker_index) {
+    LAB8_PROFILE_SCOPE("Bin");
+    BinTriangles(worker_index);
+  });
+  RunParallel([this](unsigned int worker_index) {
+    LAB8_PROFILE_SCOPE("Rasterize");
+    RasterizeTiles(worker_index);
+  });
+}
+
+void SoftwareRenderer::RunParallel(
+    const std::function<void(unsigned int)>& task) {
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    task_ = task;
+    remaining_ = thread_count_ - 1;
+    generation_++;
+  }
+  start_condition_.notify_all();
+
+  task(0);
+
+  std::unique_lock<std::mutex> lock { mutex_ };
+  finish_condition_.wait(lock, [this] { return remaining_ == 0; });
+}
+
+void SoftwareRenderer::WorkerLoop(unsigned int worker_index) {
+  std::uint64_t generation { 0 };
+
+  while (true) {
+    std::function<void(unsigned int)> task { };
+    {
+      std::unique_lock<std::mutex> lock { mutex_ };
+      start_condition_.wait(lock, [this, generation] {
+        return stopping_ || generation_ != generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      generation = generation_;
+      task = task_;
+    }
+
+    task(worker_index);
+
+    {
+      std::lock_guard<std::mutex> lock { mutex_ };
+      remaining_--;
+    }
+    finish_condition_.notify_one();
+  }
+}
+
+void SoftwareRenderer::TransformVertices(unsigned int worker_index) {
+  const std::size_t kBegin { vertices_.size() * worker_index / thread_count_ };
+  const std::size_t kEnd {
+    vertices_.size() * (worker_index + 1) / thread_count_
+  };
+
+  const float kWidth { static_cast<float>(framebuffer_->width) };
+  const float kHeight { static_cast<float>(framebuffer_->height) };
+  const double* kCoordinates { coordinates_->data() };
+
+  for (std::size_t i { kBegin }; i < kEnd; i++) {
+    const double* kVertex { kCoordinates + 5 * i };
+    const glm::vec4 kClip {
+      transform_ * glm::vec4(kVertex[0], kVertex[1], kVertex[2], 1.0f)
+    };
+
+    ScreenVertex& screen { vertices_[i] };
+
+    // Треугольники не отсекаются плоскостями пирамиды видимости, поэтому
+    // отбрасываются треугольники с вершинами позади наблюдателя.
+    screen.visible = kClip.w > 1e-6f;
+    if (!screen.visible) {
+      continue;
+    }
+
+    screen.inv_w = 1.0f / kClip.w;
+    // строки буфера кадра идут сверху вниз, поэтому ось y отражается
+    screen.x = (kClip.x * screen.inv_w * 0.5f + 0.5f) * kWidth;
+    screen.y = (0.5f - kClip.y * screen.inv_w * 0.5f) * kHeight;
+    screen.z = kClip.z * screen.inv_w * 0.5f + 0.5f;
+    screen.u_w = static_cast<float>(kVertex[3]) * screen.inv_w;
+    screen.v_w = static_cast<float>(kVertex[4]) * screen.inv_w;
+  }
+}
+
+void SoftwareRenderer::BinTriangles(unsigned int worker_index) {
+  const std::size_t kBegin { triangles_.size() * worker_index / thread_count_ };
+  const std::size_t kEnd {
+    triangles_.size() * (worker_index + 1) / thread_count_
+  };
+
+  const unsigned int* kIndices { indices_->data() };
+  auto& worker_bins = bins_[worker_index];
+
+  for (std::size_t i { kBegin }; i < kEnd; i++) {
+    TriangleSetup& triangle { triangles_[i] };
+
+    const ScreenVertex* screen[3] { };
+    bool visible { true };
+    for (int k { 0 }; k < 3; k++) {
+      triangle.vertices[k] = kIndices[3 * i + k];
+      screen[k] = &vertices_[triangle.vertices[k]];
+      visible = visible && screen[k]->visible;
+    }
+    if (!visible) {
+      continue;
+    }
+
+    const float kArea {
+      (screen[1]->x - screen[0]->x) * (screen[2]->y - screen[0]->y) -
+      (screen[2]->x - screen[0]->x) * (screen[1]->y - screen[0]->y)
+    };
+    if (kArea == 0.0f || !std::isfinite(kArea)) {
+      continue;
+    }
+
+    // Отсечение нелицевых граней выключено, как и в OpenGL-версии, поэтому
+    // знак площади лишь выбирает ориентацию функций рёбер.
+    const float kInverseArea { 1.0f / kArea };
+    for (int k { 0 }; k < 3; k++) {
+      const ScreenVertex& kFrom { *screen[(k + 1) % 3] };
+      const ScreenVertex& kTo { *screen[(k + 2) % 3] };
+
+      const float kA { kFrom.y - kTo.y };
+      const float kB { kTo.x - kFrom.x };
+      triangle.edge_a[k] = kA * kInverseArea;
+      triangle.edge_b[k] = kB * kInverseArea;
+      triangle.edge_c[k] = (kFrom.x * kTo.y - kFrom.y * kTo.x) * kInverseArea;
+
+      // правило верхнего левого ребра: пиксель на ребре принадлежит
+      // треугольнику, только если ребро левое или верхнее
+      triangle.top_left[k] =
+          triangle.edge_a[k] > 0.0f ||
+          (triangle.edge_a[k] == 0.0f && triangle.edge_b[k] > 0.0f);
+    }
+
+    const float kMinX {
+      std::min({ screen[0]->x, screen[1]->x, screen[2]->x })
+    };
+    const float kMinY {
+      std::min({ screen[0]->y, screen[1]->y, screen[2]->y })
+    };
+    const float kMaxX {
+      std::max({ screen[0]->x, screen[1]->x, screen[2]->x })
+    };
+    const float kMaxY {
+      std::max({ screen[0]->y, screen[1]->y, screen[2]->y })
+    };
+
+    // ограничивающий прямоугольник по центрам пикселей
+    triangle.min_x = std::max(0, static_cast<int>(std::ceil(kMinX - 0.5f)));
+    triangle.min_y = std::max(0, static_cast<int>(std::ceil(kMinY - 0.5f)));
+    triangle.max_x = std::min(framebuffer_->width - 1,
+                              static_cast<int>(std::floor(kMaxX - 0.5f)));
+    triangle.max_y = std::min(framebuffer_->height - 1,
+                              static_cast<int>(std::floor(kMaxY - 0.5f)));
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+      continue;
+    }
+
+    const int kTileMinX { triangle.min_x / kTileSize };
+    const int kTileMinY { triangle.min_y / kTileSize };
+    const int kTileMaxX { triangle.max_x / kTileSize };
+    const int kTileMaxY { triangle.max_y / kTileSize };
+    for (int tile_y { kTileMinY }; tile_y <= kTileMaxY; tile_y++) {
+      for (int tile_x { kTileMinX }; tile_x <= kTileMaxX; tile_x++) {
+        worker_bins[tile_y * tiles_x_ + tile_x].push_back(i);
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::RasterizeTiles(unsigned int worker_index) {
+  // сначала разбираются собственные тайлы, затем тайлы остальных потоков
+  for (unsigned int k { 0 }; k < thread_count_; k++) {
+    TileRange& range { tile_ranges_[(worker_index + k) % thread_count_] };
+
+    int tile_index { range.next.fetch_add(1, std::memory_order_relaxed) };
+    while (tile_index < range.end) {
+      RasterizeTile(tile_index);
+      tile_index = range.next.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void SoftwareRenderer::RasterizeTile(int tile_index) {
+  const int kTileMinX { (tile_index % tiles_x_) * kTileSize };
+  const int kTileMinY { (tile_index / tiles_x_) * kTileSize };
+  const int kTileMaxX {
+    std::min(kTileMinX + kTileSize, framebuffer_->width) - 1
+  };
+  const int kTileMaxY {
+    std::min(kTileMinY + kTileSize, framebuffer_->height) - 1
+  };
+
+  // порядок треугольников совпадает с порядком индексного буфера
+  for (const auto& worker_bins : bins_) {
+    for (unsigned int triangle_index : worker_bins[tile_index]) {
+      RasterizeTriangle(triangles_[triangle_index], kTileMinX, kTileMinY,
+                        kTileMaxX, kTileMaxY);
+    }
+  }
+}
+
+void SoftwareRenderer::RasterizeTriangle(const TriangleSetup& triangle,
+                                         int tile_min_x, int tile_min_y,
+                                         int tile_max_x, int tile_max_y) {
+  const int kMinX { std::max(triangle.min_x, tile_min_x) };
+  const int kMinY { std::max(triangle.min_y, tile_min_y) };
+  const int kMaxX { std::min(triangle.max_x, tile_max_x) };
+  const int kMaxY { std::min(triangle.max_y, tile_max_y) };
+
+  const float kZ0 { vertices_[triangle.vertices[0]].z };
+  const float kZ1 { vertices_[triangle.vertices[1]].z };
+  const float kZ2 { vertices_[triangle.vertices[2]].z };
+
+  const int kStride { framebuffer_->stride };
+  std::uint32_t* color { framebuffer_->color.data() };
+  float* depth { framebuffer_->depth.data() };
+
+#if defined(__SSE2__)
+  // Пиксели обрабатываются группами по 4, начиная с границы, кратной 4.
+  // Ширина строки буфера кадра кратна 4, поэтому группа не выходит за её
+  // пределы.
+  const int kAlignedMinX { kMinX & ~3 };
+
+  const __m128 kOffsets { _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+  const __m128 kZero { _mm_setzero_ps() };
+  const __m128 kOne { _mm_set1_ps(1.0f) };
+  const __m128 kZ0s { _mm_set1_ps(kZ0) };
+  const __m128 kZ1s { _mm_set1_ps(kZ1) };
+  const __m128 kZ2s { _mm_set1_ps(kZ2) };
+  const __m128 kMinXs { _mm_set1_ps(static_cast<float>(kMinX)) };
+  const __m128 kMaxXs { _mm_set1_ps(static_cast<float>(kMaxX + 1)) };
+
+  __m128 edge_a[3];
+  __m128 top_left[3];
+  for (int k { 0 }; k < 3; k++) {
+    edge_a[k] = _mm_set1_ps(triangle.edge_a[k]);
+    top_left[k] =
+        _mm_castsi128_ps(_mm_set1_epi32(triangle.top_left[k] ? -1 : 0));
+  }
+
+  for (int y { kMinY }; y <= kMaxY; y++) {
+    const float kPixelY { y + 0.5f };
+
+    __m128 row_edge[3];
+    for (int k { 0 }; k < 3; k++) {
+      row_edge[k] = _mm_set1_ps(triangle.edge_b[k] * kPixelY +
+                                triangle.edge_c[k]);
+    }
+
+    for (int x { kAlignedMinX }; x <= kMaxX; x += 4) {
+      const __m128 kX { _mm_set1_ps(static_cast<float>(x)) };
+      const __m128 kPixelX { _mm_add_ps(kX, kOffsets) };
+
+      // пиксели вне ограничивающего прямоугольника в пределах тайла
+      __m128 mask {
+        _mm_and_ps(_mm_cmpge_ps(kPixelX, kMinXs),
+                   _mm_cmplt_ps(kPixelX, kMaxXs))
+      };
+
+      __m128 lambda[3];
+      for (int k { 0 }; k < 3; k++) {
+        lambda[k] = _mm_add_ps(_mm_mul_ps(edge_a[k], kPixelX), row_edge[k]);
+        const __m128 kInside {
+          _mm_or_ps(_mm_cmpgt_ps(lambda[k], kZero),
+                    _mm_and_ps(_mm_cmpeq_ps(lambda[k], kZero), top_left[k]))
+        };
+        mask = _mm_and_ps(mask, kInside);
+      }
+
+      if (!_mm_movemask_ps(mask)) {
+        continue;
+      }
+
+      const __m128 kZ {
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(kZ0s, lambda[0]),
+                              _mm_mul_ps(kZ1s, lambda[1])),
+                   _mm_mul_ps(kZ2s, lambda[2]))
+      };
+
+      float* depth_row { depth + y * kStride + x };
+      const __m128 kDepth { _mm_loadu_ps(depth_row) };
+
+      // отсечение по ближней и дальней плоскостям и тест глубины GL_LESS
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(kZ, kZero));
+      mask = _mm_and_ps(mask, _mm_cmple_ps(kZ, kOne));
+      mask = _mm_and_ps(mask, _mm_cmplt_ps(kZ, kDepth));
+
+      const int kMask { _mm_movemask_ps(mask) };
+      if (!kMask) {
+        continue;
+      }
+
+      _mm_storeu_ps(depth_row, _mm_or_ps(_mm_and_ps(mask, kZ),
+                                         _mm_andnot_ps(mask, kDepth)));
+
+      alignas(16) float l0[4];
+      alignas(16) float l1[4];
+      alignas(16) float l2[4];
+      _mm_store_ps(l0, lambda[0]);
+      _mm_store_ps(l1, lambda[1]);
+      _mm_store_ps(l2, lambda[2]);
+
+      std::uint32_t* color_row { color + y * kStride + x };
+      for (int lane { 0 }; lane < 4; lane++) {
+        if (kMask & (1 << lane)) {
+          color_row[lane] = ShadePixel(triangle, l0[lane], l1[lane], l2[lane]);
+        }
+      }
+    }
+  }
+#else
+  for (int y { kMinY }; y <= kMaxY; y++) {
+    const float kPixelY { y + 0.5f };
+
+    for (int x { kMinX }; x <= kMaxX; x++) {
+      const float kPixelX { x + 0.5f };
+
+      float lambda[3];
+      bool inside { true };
+      for (int k { 0 }; k < 3; k++) {
+        lambda[k] = triangle.edge_a[k] * kPixelX +
+                    triangle.edge_b[k] * kPixelY + triangle.edge_c[k];
+        inside = inside && (lambda[k] > 0.0f ||
+                            (lambda[k] == 0.0f && triangle.top_left[k]));
+      }
+      if (!inside) {
+        continue;
+      }
+
+      const float kZ { kZ0 * lambda[0] + kZ1 * lambda[1] + kZ2 * lambda[2] };
+      float& pixel_depth { depth[y * kStride + x] };
+      if (kZ < 0.0f || kZ > 1.0f || kZ >= pixel_depth) {
+        continue;
+      }
+
+      pixel_depth = kZ;
+      color[y * kStride + x] = ShadePixel(triangle, lambda[0], lambda[1],
+                                          lambda[2]);
+    }
+  }
+#endif
+}
+
+std::uint32_t SoftwareRenderer::ShadePixel(const TriangleSetup& triangle,
+                                           float l0, float l1,
+                                           float l2) const {
+  const ScreenVertex& kV0 { vertices_[triangle.vertices[0]] };
+  const ScreenVertex& kV1 { vertices_[triangle.vertices[1]] };
+  const ScreenVertex& kV2 { vertices_[triangle.vertices[2]] };
+
+  // интерполяция текстурных координат с коррекцией перспективы
+  const float kInverseW { l0 * kV0.inv_w + l1 * kV1.inv_w + l2 * kV2.inv_w };
+  const float kU { (l0 * kV0.u_w + l1 * kV1.u_w + l2 * kV2.u_w) / kInverseW };
+  const float kV { (l0 * kV0.v_w + l1 * kV1.v_w + l2 * kV2.v_w) / kInverseW };
+
+  return SampleBilinear(*texture_, kU, kV);
+}
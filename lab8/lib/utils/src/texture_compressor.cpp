@@ -0,0 +1,696 @@
+#include "texture_compressor.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include <glad/glad.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Константа расширения GL_EXT_texture_compression_s3tc, не вошедшего в
+// сгенерированный glad.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+namespace {
+
+// Пиксели блока 4x4 по каналам, построчно.
+struct alignas(16) Block {
+  float red[16];
+  float green[16];
+  float blue[16];
+};
+
+struct Color {
+  float red;
+  float green;
+  float blue;
+};
+
+struct EncodedBlock {
+  std::uint16_t color0;
+  std::uint16_t color1;
+  std::uint32_t indices;
+  float error;
+};
+
+// Читает пиксель (x, y) как RGB; одно- и двухканальные изображения
+// считаются серыми.
+void ReadPixel(const ImageView& image, int x, int y, int* rgb) {
+  const unsigned char* pixel {
+    image.pixels +
+    (static_cast<std::size_t>(y) * image.width + x) * image.channels
+  };
+
+  rgb[0] = pixel[0];
+  rgb[1] = image.channels >= 3 ? pixel[1] : pixel[0];
+  rgb[2] = image.channels >= 3 ? pixel[2] : pixel[0];
+}
+
+void LoadBlock(const ImageView& image, int block_x, int block_y,
+               Block& block) {
+  for (int y { 0 }; y < 4; y++) {
+    const int kY { std::min(4 * block_y + y, image.height - 1) };
+    for (int x { 0 }; x < 4; x++) {
+      const int kX { std::min(4 * block_x + x, image.width - 1) };
+
+      int rgb[3] { };
+      ReadPixel(image, kX, kY, rgb);
+      block.red[4 * y + x] = static_cast<float>(rgb[0]);
+      block.green[4 * y + x] = static_cast<float>(rgb[1]);
+      block.blue[4 * y + x] = static_cast<float>(rgb[2]);
+    }
+  }
+}
+
+std::uint16_t PackColor565(const Color& color) {
+  auto quantize = [](float value, int max) {
+    return static_cast<std::uint16_t>(
+        std::lround(std::clamp(value, 0.0f, 255.0f) * max / 255.0f));
+  };
+
+  return static_cast<std::uint16_t>(quantize(color.red, 31) << 11 |
+                                    quantize(color.green, 63) << 5 |
+                                    quantize(color.blue, 31));
+}
+
+void UnpackColor565(std::uint16_t value, int* rgb) {
+  const int kRed { value >> 11 };
+  const int kGreen { (value >> 5) & 63 };
+  const int kBlue { value & 31 };
+
+  rgb[0] = (kRed << 3) | (kRed >> 2);
+  rgb[1] = (kGreen << 2) | (kGreen >> 4);
+  rgb[2] = (kBlue << 3) | (kBlue >> 2);
+}
+
+// Палитра блока BC1. При color0 > color1 блок четырёхцветный: элементы 2
+// и 3 делят отрезок между концами на трети. Иначе блок трёхцветный:
+// элемент 2 -- середина отрезка, элемент 3 -- чёрный (прозрачный в
+// форматах с альфа-каналом).
+void CreatePalette(std::uint16_t color0, std::uint16_t color1,
+                   int palette[4][3]) {
+  UnpackColor565(color0, palette[0]);
+  UnpackColor565(color1, palette[1]);
+
+  for (int c { 0 }; c < 3; c++) {
+    if (color0 > color1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+}
+
+// Выбирает для каждого пикселя ближайший цвет палитры. Возвращает индексы
+// по 2 бита на пиксель и записывает суммарную квадратичную ошибку.
+std::uint32_t SelectIndices(const Block& block, const int palette[4][3],
+                            float& error) {
+  alignas(16) float indices[16];
+
+#if defined(__SSE2__)
+  __m128 total_error { _mm_setzero_ps() };
+
+  for (int i { 0 }; i < 16; i += 4) {
+    const __m128 kRed { _mm_load_ps(block.red + i) };
+    const __m128 kGreen { _mm_load_ps(block.green + i) };
+    const __m128 kBlue { _mm_load_ps(block.blue + i) };
+
+    __m128 best_error { _mm_set1_ps(std::numeric_limits<float>::max()) };
+    __m128 best_index { _mm_setzero_ps() };
+
+    for (int k { 0 }; k < 4; k++) {
+      const __m128 kDeltaRed {
+        _mm_sub_ps(kRed, _mm_set1_ps(static_cast<float>(palette[k][0])))
+      };
+      const __m128 kDeltaGreen {
+        _mm_sub_ps(kGreen, _mm_set1_ps(static_cast<float>(palette[k][1])))
+      };
+      const __m128 kDeltaBlue {
+        _mm_sub_ps(kBlue, _mm_set1_ps(static_cast<float>(palette[k][2])))
+      };
+      const __m128 kError {
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(kDeltaRed, kDeltaRed),
+                              _mm_mul_ps(kDeltaGreen, kDeltaGreen)),
+                   _mm_mul_ps(kDeltaBlue, kDeltaBlue))
+      };
+
+      const __m128 kCloser { _mm_cmplt_ps(kError, best_error) };
+      best_error = _mm_min_ps(kError, best_error);
+      best_index = _mm_or_ps(
+          _mm_and_ps(kCloser, _mm_set1_ps(static_cast<float>(k))),
+          _mm_andnot_ps(kCloser, best_index));
+    }
+
+    total_error = _mm_add_ps(total_error, best_error);
+    _mm_store_ps(indices + i, best_index);
+  }
+
+  alignas(16) float errors[4];
+  _mm_store_ps(errors, total_error);
+  error = (errors[0] + errors[1]) + (errors[2] + errors[3]);
+#else
+  error = 0.0f;
+
+  for (int i { 0 }; i < 16; i++) {
+    float best_error { std::numeric_limits<float>::max() };
+    indices[i] = 0.0f;
+
+    for (int k { 0 }; k < 4; k++) {
+      const float kDeltaRed { block.red[i] - palette[k][0] };
+      const float kDeltaGreen { block.green[i] - palette[k][1] };
+      const float kDeltaBlue { block.blue[i] - palette[k][2] };
+      const float kError {
+        kDeltaRed * kDeltaRed + kDeltaGreen * kDeltaGreen +
+        kDeltaBlue * kDeltaBlue
+      };
+
+      if (kError < best_error) {
+        best_error = kError;
+        indices[i] = static_cast<float>(k);
+      }
+    }
+
+    error += best_error;
+  }
+#endif
+
+  std::uint32_t packed { 0 };
+  for (int i { 0 }; i < 16; i++) {
+    packed |= static_cast<std::uint32_t>(indices[i]) << (2 * i);
+  }
+
+  return packed;
+}
+
+// Проекции пикселей на прямую origin + t * axis: наименьшее и наибольшее t.
+void ProjectBlock(const Block& block, const Color& origin, const Color& axis,
+                  float& min_t, float& max_t) {
+#if defined(__SSE2__)
+  __m128 min_value { _mm_set1_ps(std::numeric_limits<float>::max()) };
+  __m128 max_value { _mm_set1_ps(std::numeric_limits<float>::lowest()) };
+
+  for (int i { 0 }; i < 16; i += 4) {
+    const __m128 kT {
+      _mm_add_ps(
+          _mm_add_ps(
+              _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.red + i),
+                                    _mm_set1_ps(origin.red)),
+                         _mm_set1_ps(axis.red)),
+              _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.green + i),
+                                    _mm_set1_ps(origin.green)),
+                         _mm_set1_ps(axis.green))),
+          _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.blue + i),
+                                _mm_set1_ps(origin.blue)),
+                     _mm_set1_ps(axis.blue)))
+    };
+    min_value = _mm_min_ps(min_value, kT);
+    max_value = _mm_max_ps(max_value, kT);
+  }
+
+  alignas(16) float min_values[4];
+  alignas(16) float max_values[4];
+  _mm_store_ps(min_values, min_value);
+  _mm_store_ps(max_values, max_value);
+  min_t = *std::min_element(min_values, min_values + 4);
+  max_t = *std::max_element(max_values, max_values + 4);
+#else
+  min_t = std::numeric_limits<float>::max();
+  max_t = std::numeric_limits<float>::lowest();
+
+  for (int i { 0 }; i < 16; i++) {
+    const float kT {
+      (block.red[i] - origin.red) * axis.red +
+      (block.green[i] - origin.green) * axis.green +
+      (block.blue[i] - origin.blue) * axis.blue
+    };
+    min_t = std::min(min_t, kT);
+    max_t = std::max(max_t, kT);
+  }
+#endif
+}
+
+Color GetMean(const Block& block) {
+  Color mean { 0.0f, 0.0f, 0.0f };
+  for (int i { 0 }; i < 16; i++) {
+    mean.red += block.red[i];
+    mean.green += block.green[i];
+    mean.blue += block.blue[i];
+  }
+
+  return Color { mean.red / 16.0f, mean.green / 16.0f, mean.blue / 16.0f };
+}
+
+// Ковариационная матрица цветов блока: rr, rg, rb, gg, gb, bb.
+void GetCovariance(const Block& block, const Color& mean,
+                   float covariance[6]) {
+  std::fill(covariance, covariance + 6, 0.0f);
+
+  for (int i { 0 }; i < 16; i++) {
+    const float kRed { block.red[i] - mean.red };
+    const float kGreen { block.green[i] - mean.green };
+    const float kBlue { block.blue[i] - mean.blue };
+
+    covariance[0] += kRed * kRed;
+    covariance[1] += kRed * kGreen;
+    covariance[2] += kRed * kBlue;
+    covariance[3] += kGreen * kGreen;
+    covariance[4] += kGreen * kBlue;
+    covariance[5] += kBlue * kBlue;
+  }
+}
+
+// Углы ограничивающего параллелепипеда, сдвинутые внутрь на 1/16 его
+// размера. Диагональ выбирается по знакам ковариации красного и синего
+// каналов с зелёным.
+void FindBoundingEndpoints(const Block& block, Color& first,
+                           Color& second) {
+  Color min_color {
+    *std::min_element(block.red, block.red + 16),
+    *std::min_element(block.green, block.green + 16),
+    *std::min_element(block.blue, block.blue + 16)
+  };
+  Color max_color {
+    *std::max_element(block.red, block.red + 16),
+    *std::max_element(block.green, block.green + 16),
+    *std::max_element(block.blue, block.blue + 16)
+  };
+
+  const Color kInset {
+    (max_color.red - min_color.red) / 16.0f,
+    (max_color.green - min_color.green) / 16.0f,
+    (max_color.blue - min_color.blue) / 16.0f
+  };
+  min_color = Color {
+    min_color.red + kInset.red, min_color.green + kInset.green,
+    min_color.blue + kInset.blue
+  };
+  max_color = Color {
+    max_color.red - kInset.red, max_color.green - kInset.green,
+    max_color.blue - kInset.blue
+  };
+
+  float covariance[6] { };
+  GetCovariance(block, GetMean(block), covariance);
+  if (covariance[1] < 0.0f) {
+    std::swap(min_color.red, max_color.red);
+  }
+  if (covariance[4] < 0.0f) {
+    std::swap(min_color.blue, max_color.blue);
+  }
+
+  first = max_color;
+  second = min_color;
+}
+
+// Концы отрезка на главной оси цветов блока, найденной степенным методом,
+// сдвинутые внутрь на 1/16 его длины.
+void FindPrincipalEndpoints(const Block& block, Color& first,
+                            Color& second) {
+  const Color kMean { GetMean(block) };
+  float covariance[6] { };
+  GetCovariance(block, kMean, covariance);
+
+  // начальное приближение -- столбец с наибольшим диагональным элементом
+  Color axis { covariance[0], covariance[1], covariance[2] };
+  if (covariance[3] > covariance[0] && covariance[3] >= covariance[5]) {
+    axis = Color { covariance[1], covariance[3], covariance[4] };
+  } else if (covariance[5] > covariance[0]) {
+    axis = Color { covariance[2], covariance[4], covariance[5] };
+  }
+
+  for (int iteration { 0 }; iteration < 8; iteration++) {
+    const Color kNext {
+      covariance[0] * axis.red + covariance[1] * axis.green +
+          covariance[2] * axis.blue,
+      covariance[1] * axis.red + covariance[3] * axis.green +
+          covariance[4] * axis.blue,
+      covariance[2] * axis.red + covariance[4] * axis.green +
+          covariance[5] * axis.blue
+    };
+    const float kScale {
+      std::max({ std::abs(kNext.red), std::abs(kNext.green),
+                 std::abs(kNext.blue) })
+    };
+    if (kScale == 0.0f) {
+      // все пиксели блока одного цвета
+      first = kMean;
+      second = kMean;
+      return;
+    }
+    axis = Color {
+      kNext.red / kScale, kNext.green / kScale, kNext.blue / kScale
+    };
+  }
+
+  const float kLength {
+    std::sqrt(axis.red * axis.red + axis.green * axis.green +
+              axis.blue * axis.blue)
+  };
+  axis = Color { axis.red / kLength, axis.green / kLength,
+                 axis.blue / kLength };
+
+  float min_t { 0.0f };
+  float max_t { 0.0f };
+  ProjectBlock(block, kMean, axis, min_t, max_t);
+
+  // как и в FindBoundingEndpoints, крайние пиксели приближаются лучше
+  // промежуточными цветами палитры, если сдвинуть концы внутрь
+  const float kInset { (max_t - min_t) / 16.0f };
+  min_t += kInset;
+  max_t -= kInset;
+
+  first = Color {
+    kMean.red + axis.red * max_t, kMean.green + axis.green * max_t,
+    kMean.blue + axis.blue * max_t
+  };
+  second = Color {
+    kMean.red + axis.red * min_t, kMean.green + axis.green * min_t,
+    kMean.blue + axis.blue * min_t
+  };
+}
+
+EncodedBlock EncodeEndpoints(const Block& block, const Color& first,
+                             const Color& second) {
+  EncodedBlock encoded { PackColor565(first), PackColor565(second), 0, 0.0f };
+  // четырёхцветный режим требует color0 > color1; индексы выбираются
+  // заново, поэтому концы можно переставить
+  if (encoded.color0 < encoded.color1) {
+    std::swap(encoded.color0, encoded.color1);
+  }
+  // Совпавшие концы разводятся на единицу младшего разряда. Один из концов
+  // остаётся прежним цветом, поэтому ошибка не растёт.
+  if (encoded.color0 == encoded.color1) {
+    if (encoded.color0 == 0) {
+      encoded.color0 = 1;
+    } else {
+      encoded.color1--;
+    }
+  }
+  assert(encoded.color0 > encoded.color1);
+
+  int palette[4][3] { };
+  CreatePalette(encoded.color0, encoded.color1, palette);
+  encoded.indices = SelectIndices(block, palette, encoded.error);
+
+  return encoded;
+}
+
+// Уточняет концы отрезка при фиксированных индексах методом наименьших
+// квадратов: пиксель с индексом k приближается цветом
+// weight[k] * first + (1 - weight[k]) * second.
+bool RefineEndpoints(const Block& block, const EncodedBlock& encoded,
+                     Color& first, Color& second) {
+  constexpr float kWeights[4] { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+  float aa { 0.0f };
+  float ab { 0.0f };
+  float bb { 0.0f };
+  Color ax { 0.0f, 0.0f, 0.0f };
+  Color bx { 0.0f, 0.0f, 0.0f };
+
+  for (int i { 0 }; i < 16; i++) {
+    const float kA { kWeights[(encoded.indices >> (2 * i)) & 3] };
+    const float kB { 1.0f - kA };
+
+    aa += kA * kA;
+    ab += kA * kB;
+    bb += kB * kB;
+    ax = Color { ax.red + kA * block.red[i], ax.green + kA * block.green[i],
+                 ax.blue + kA * block.blue[i] };
+    bx = Color { bx.red + kB * block.red[i], bx.green + kB * block.green[i],
+                 bx.blue + kB * block.blue[i] };
+  }
+
+  const float kDeterminant { aa * bb - ab * ab };
+  if (std::abs(kDeterminant) < 1e-6f) {
+    return false;
+  }
+
+  const float kScale { 1.0f / kDeterminant };
+  first = Color {
+    (bb * ax.red - ab * bx.red) * kScale,
+    (bb * ax.green - ab * bx.green) * kScale,
+    (bb * ax.blue - ab * bx.blue) * kScale
+  };
+  second = Color {
+    (aa * bx.red - ab * ax.red) * kScale,
+    (aa * bx.green - ab * ax.green) * kScale,
+    (aa * bx.blue - ab * ax.blue) * kScale
+  };
+
+  return true;
+}
+
+EncodedBlock EncodeBlock(const Block& block, CompressionQuality quality) {
+  Color first { };
+  Color second { };
+
+  if (quality == CompressionQuality::kFast) {
+    FindBoundingEndpoints(block, first, second);
+    return EncodeEndpoints(block, first, second);
+  }
+
+  FindPrincipalEndpoints(block, first, second);
+  EncodedBlock best { EncodeEndpoints(block, first, second) };
+
+  if (quality == CompressionQuality::kHigh) {
+    FindBoundingEndpoints(block, first, second);
+    const EncodedBlock kBounding { EncodeEndpoints(block, first, second) };
+    if (kBounding.error < best.error) {
+      best = kBounding;
+    }
+
+    for (int iteration { 0 }; iteration < 2 && best.error > 0.0f;
+         iteration++) {
+      if (!RefineEndpoints(block, best, first, second)) {
+        break;
+      }
+
+      const EncodedBlock kCandidate { EncodeEndpoints(block, first, second) };
+      if (kCandidate.error >= best.error) {
+        break;
+      }
+      best = kCandidate;
+    }
+  }
+
+  return best;
+}
+
+void WriteBlock(const EncodedBlock& encoded, unsigned char* destination) {
+  destination[0] = static_cast<unsigned char>(encoded.color0);
+  destination[1] = static_cast<unsigned char>(encoded.color0 >> 8);
+  destination[2] = static_cast<unsigned char>(encoded.color1);
+  destination[3] = static_cast<unsigned char>(encoded.color1 >> 8);
+  for (int i { 0 }; i < 4; i++) {
+    destination[4 + i] = static_cast<unsigned char>(encoded.indices >> 8 * i);
+  }
+}
+
+bool HasS3tcSupport() {
+  GLint extension_count { 0 };
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+  for (GLint i { 0 }; i < extension_count; i++) {
+    const char* name {
+      reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i))
+    };
+    if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace
+
+std::size_t GetBc1Size(int width, int height) {
+  return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) *
+         kBc1BlockSize;
+}
+
+std::vector<unsigned char> CompressBc1(const ImageView& image,
+                                       CompressionQuality quality,
+                                       unsigned int thread_count) {
+  const int kBlocksX { (image.width + 3) / 4 };
+  const int kBlocksY { (image.height + 3) / 4 };
+  std::vector<unsigned char> blocks(GetBc1Size(image.width, image.height));
+
+  auto compress_rows = [&](int begin, int end) {
+    Block block { };
+    for (int y { begin }; y < end; y++) {
+      for (int x { 0 }; x < kBlocksX; x++) {
+        LoadBlock(image, x, y, block);
+        WriteBlock(EncodeBlock(block, quality),
+                   blocks.data() +
+                       (static_cast<std::size_t>(y) * kBlocksX + x) *
+                           kBc1BlockSize);
+      }
+    }
+  };
+
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // маленькие уровни детализации не стоят запуска потоков
+  const int kThreadCount {
+    std::max(1, std::min({ static_cast<int>(thread_count), kBlocksY,
+                           kBlocksX * kBlocksY / 256 }))
+  };
+
+  std::vector<std::thread> threads { };
+  threads.reserve(kThreadCount - 1);
+  for (int i { 1 }; i < kThreadCount; i++) {
+    threads.emplace_back(compress_rows, kBlocksY * i / kThreadCount,
+                         kBlocksY * (i + 1) / kThreadCount);
+  }
+
+  compress_rows(0, kBlocksY / kThreadCount);
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  return blocks;
+}
+
+Image DecompressBc1(const unsigned char* blocks, int width, int height) {
+  Image image { width, height, 3, { } };
+  image.pixels.resize(static_cast<std::size_t>(width) * height * 3);
+
+  const int kBlocksX { (width + 3) / 4 };
+  const int kBlocksY { (height + 3) / 4 };
+
+  for (int block_y { 0 }; block_y < kBlocksY; block_y++) {
+    for (int block_x { 0 }; block_x < kBlocksX; block_x++) {
+      const unsigned char* block {
+        blocks +
+        (static_cast<std::size_t>(block_y) * kBlocksX + block_x) *
+            kBc1BlockSize
+      };
+      const std::uint16_t kColor0 {
+        static_cast<std::uint16_t>(block[0] | block[1] << 8)
+      };
+      const std::uint16_t kColor1 {
+        static_cast<std::uint16_t>(block[2] | block[3] << 8)
+      };
+      const std::uint32_t kIndices {
+        block[4] | block[5] << 8 | block[6] << 16 |
+        static_cast<std::uint32_t>(block[7]) << 24
+      };
+
+      int palette[4][3] { };
+      CreatePalette(kColor0, kColor1, palette);
+
+      for (int i { 0 }; i < 16; i++) {
+        const int kX { 4 * block_x + i % 4 };
+        const int kY { 4 * block_y + i / 4 };
+        if (kX >= width || kY >= height) {
+          continue;
+        }
+
+        const int* color { palette[(kIndices >> (2 * i)) & 3] };
+        unsigned char* pixel {
+          image.pixels.data() +
+          (static_cast<std::size_t>(kY) * width + kX) * 3
+        };
+        for (int c { 0 }; c < 3; c++) {
+          pixel[c] = static_cast<unsigned char>(color[c]);
+        }
+      }
+    }
+  }
+
+  return image;
+}
+
+double ComputePsnr(const ImageView& first, const ImageView& second) {
+  assert(first.width == second.width && first.height == second.height);
+
+  double squared_error { 0.0 };
+  for (int y { 0 }; y < first.height; y++) {
+    for (int x { 0 }; x < first.width; x++) {
+      int first_rgb[3] { };
+      int second_rgb[3] { };
+      ReadPixel(first, x, y, first_rgb);
+      ReadPixel(second, x, y, second_rgb);
+
+      for (int c { 0 }; c < 3; c++) {
+        const double kDelta { static_cast<double>(first_rgb[c]) -
+                              second_rgb[c] };
+        squared_error += kDelta * kDelta;
+      }
+    }
+  }
+
+  const double kMeanSquaredError {
+    squared_error / (3.0 * first.width * first.height)
+  };
+  if (kMeanSquaredError == 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  return 10.0 * std::log10(255.0 * 255.0 / kMeanSquaredError);
+}
+
+unsigned int CreateBc1Texture(const std::vector<ImageView>& levels) {
+  assert(!levels.empty());
+
+  if (!HasS3tcSupport()) {
+    std::vector<Image> images { };
+    std::vector<ImageView> views { };
+    images.reserve(levels.size());
+    for (const ImageView& level : levels) {
+      images.push_back(DecompressBc1(level.pixels, level.width, level.height));
+      views.push_back(ImageView {
+        images.back().width, images.back().height, images.back().channels,
+        images.back().pixels.data()
+      });
+    }
+
+    return CreateTexture(views);
+  }
+
+  unsigned int texture { 0 };
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                  GL_LINEAR);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  static_cast<GLint>(levels.size()) - 1);
+
+  for (std::size_t level { 0 }; level < levels.size(); level++) {
+    glCompressedTexImage2D(
+        GL_TEXTURE_2D, static_cast<GLint>(level),
+        GL_COMPRESSED_RGB_S3TC_DXT1_EXT, levels[level].width,
+        levels[level].height, 0,
+        static_cast<GLsizei>(
+            GetBc1Size(levels[level].width, levels[level].height)),
+        levels[level].pixels);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return texture;
+}
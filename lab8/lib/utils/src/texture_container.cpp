@@ -0,0 +1,329 @@
+#include "texture_container.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LAB8_HAS_MMAP 1
+#endif
+
+namespace {
+
+std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool IsLittleEndian() {
+  const std::uint32_t kValue { 1 };
+  unsigned char first_byte { 0 };
+  std::memcpy(&first_byte, &kValue, 1);
+  return first_byte == 1;
+}
+
+// Проверяет, что заголовок и таблица уровней согласованы с размером файла
+// и что данные уровней не выходят за его пределы.
+bool ValidateContainer(const unsigned char* data, std::size_t size) {
+  if (size < sizeof(TextureContainerHeader)) {
+    return false;
+  }
+
+  TextureContainerHeader header { };
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, kTextureContainerMagic, 4) != 0 ||
+      header.version != kTextureContainerVersion ||
+      (header.format != TextureContainerFormat::kUnorm8 &&
+       header.format != TextureContainerFormat::kBc1) ||
+      header.channels < 1 || header.channels > 4 ||
+      (header.format == TextureContainerFormat::kBc1 &&
+       header.channels != 3) ||
+      header.level_count == 0 || header.data_alignment == 0 ||
+      header.file_size != size) {
+    return false;
+  }
+
+  const std::uint64_t kTableEnd {
+    sizeof(TextureContainerHeader) +
+    std::uint64_t { header.level_count } * sizeof(TextureContainerLevel)
+  };
+  if (kTableEnd > size) {
+    return false;
+  }
+
+  for (std::uint32_t i { 0 }; i < header.level_count; i++) {
+    TextureContainerLevel level { };
+    std::memcpy(&level,
+                data + sizeof(TextureContainerHeader) +
+                    i * sizeof(TextureContainerLevel),
+                sizeof(level));
+
+    const std::uint64_t kExpectedSize {
+      header.format == TextureContainerFormat::kBc1
+          ? (std::uint64_t { level.width } + 3) / 4 *
+                ((std::uint64_t { level.height } + 3) / 4) * kBc1BlockSize
+          : std::uint64_t { level.width } * level.height * header.channels
+    };
+    if (level.width == 0 || level.height == 0 ||
+        level.size != kExpectedSize ||
+        level.offset % header.data_alignment != 0 ||
+        level.offset < kTableEnd || level.offset > size ||
+        level.size > size - level.offset) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+std::string GetTextureContainerPath(const std::string& image_path) {
+  const std::size_t kSlash { image_path.find_last_of("/\\") };
+  const std::size_t kDot { image_path.find_last_of('.') };
+
+  if (kDot == std::string::npos ||
+      (kSlash != std::string::npos && kDot < kSlash)) {
+    return image_path + ".l8tex";
+  }
+
+  return image_path.substr(0, kDot) + ".l8tex";
+}
+
+bool GetTextureSourceStamp(const std::string& image_path,
+                           TextureSourceStamp& stamp) {
+  std::error_code error { };
+  const std::uintmax_t kSize { std::filesystem::file_size(image_path, error) };
+  if (error) {
+    return false;
+  }
+  const std::filesystem::file_time_type kTime {
+    std::filesystem::last_write_time(image_path, error)
+  };
+  if (error) {
+    return false;
+  }
+
+  stamp.size = kSize;
+  stamp.modification_time =
+      static_cast<std::int64_t>(kTime.time_since_epoch().count());
+  return true;
+}
+
+bool WriteTextureContainer(const char* path, const std::vector<Image>& levels,
+                           const TextureSourceStamp& source,
+                           const TextureContainerOptions& options) {
+  // числа записываются в формате машины
+  if (!IsLittleEndian() || levels.empty()) {
+    std::cerr << "Failed to write the texture container" << std::endl;
+    return false;
+  }
+
+  // данные уровней в формате контейнера
+  std::vector<std::vector<unsigned char>> compressed_levels { };
+  if (options.format == TextureContainerFormat::kBc1) {
+    for (const Image& level : levels) {
+      compressed_levels.push_back(CompressBc1(
+          ImageView {
+            level.width, level.height, level.channels, level.pixels.data()
+          },
+          options.quality));
+    }
+  }
+  auto get_level_data = [&](std::size_t i) {
+    return compressed_levels.empty() ? levels[i].pixels.data()
+                                     : compressed_levels[i].data();
+  };
+  auto get_level_size = [&](std::size_t i) {
+    return compressed_levels.empty() ? levels[i].pixels.size()
+                                     : compressed_levels[i].size();
+  };
+
+  TextureContainerHeader header { };
+  std::memcpy(header.magic, kTextureContainerMagic, 4);
+  header.version = kTextureContainerVersion;
+  header.format = options.format;
+  header.channels = options.format == TextureContainerFormat::kBc1
+                        ? 3
+                        : static_cast<std::uint32_t>(levels.front().channels);
+  header.level_count = static_cast<std::uint32_t>(levels.size());
+  header.data_alignment = kTextureContainerAlignment;
+  header.row_alignment = 1;
+  header.source_size = source.size;
+  header.source_modification_time = source.modification_time;
+
+  std::vector<TextureContainerLevel> table(levels.size());
+  std::uint64_t offset {
+    sizeof(TextureContainerHeader) +
+    levels.size() * sizeof(TextureContainerLevel)
+  };
+  for (std::size_t i { 0 }; i < levels.size(); i++) {
+    offset = AlignUp(offset, kTextureContainerAlignment);
+    table[i].width = static_cast<std::uint32_t>(levels[i].width);
+    table[i].height = static_cast<std::uint32_t>(levels[i].height);
+    table[i].offset = offset;
+    table[i].size = get_level_size(i);
+    offset += table[i].size;
+  }
+  header.file_size = offset;
+
+  std::ofstream file { path, std::ios::binary };
+  if (!file) {
+    std::cerr << "Failed to write the texture container" << std::endl;
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(table.data()),
+             table.size() * sizeof(TextureContainerLevel));
+
+  std::uint64_t position {
+    sizeof(TextureContainerHeader) +
+    table.size() * sizeof(TextureContainerLevel)
+  };
+  const char kPadding[kTextureContainerAlignment] { };
+  for (std::size_t i { 0 }; i < levels.size(); i++) {
+    file.write(kPadding, table[i].offset - position);
+    file.write(reinterpret_cast<const char*>(get_level_data(i)),
+               get_level_size(i));
+    position = table[i].offset + table[i].size;
+  }
+
+  if (!file) {
+    std::cerr << "Failed to write the texture container" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+MappedTextureContainer::MappedTextureContainer()
+    : data_ { nullptr },
+      size_ { 0 } { }
+
+MappedTextureContainer::~MappedTextureContainer() {
+  Close();
+}
+
+bool MappedTextureContainer::Open(const char* path) {
+  Close();
+
+#if defined(LAB8_HAS_MMAP)
+  const int kFile { open(path, O_RDONLY) };
+  if (kFile == -1) {
+    return false;
+  }
+
+  struct stat file_stat { };
+  if (fstat(kFile, &file_stat) == -1 || file_stat.st_size == 0) {
+    close(kFile);
+    return false;
+  }
+
+  void* mapping {
+    mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ,
+         MAP_PRIVATE, kFile, 0)
+  };
+  // отображение остаётся действительным и после закрытия файла
+  close(kFile);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = static_cast<const unsigned char*>(mapping);
+  size_ = static_cast<std::size_t>(file_stat.st_size);
+#else
+  std::ifstream file { path, std::ios::binary | std::ios::ate };
+  if (!file) {
+    return false;
+  }
+
+  buffer_.resize(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+    buffer_.clear();
+    return false;
+  }
+
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#endif
+
+  if (!IsLittleEndian() || !ValidateContainer(data_, size_)) {
+    std::cerr << "Invalid texture container: " << path << std::endl;
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedTextureContainer::OpenForImage(const std::string& image_path) {
+  const std::string kPath { GetTextureContainerPath(image_path) };
+  if (!Open(kPath.c_str())) {
+    return false;
+  }
+
+  TextureSourceStamp stamp { };
+  if (GetTextureSourceStamp(image_path, stamp) &&
+      (stamp.size != GetHeader().source_size ||
+       stamp.modification_time != GetHeader().source_modification_time)) {
+    std::cerr << "Texture container " << kPath << " is out of date, loading "
+              << image_path << std::endl;
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedTextureContainer::Close() {
+#if defined(LAB8_HAS_MMAP)
+  if (data_) {
+    munmap(const_cast<unsigned char*>(data_), size_);
+  }
+#else
+  buffer_.clear();
+#endif
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+const TextureContainerHeader& MappedTextureContainer::GetHeader() const {
+  return *reinterpret_cast<const TextureContainerHeader*>(data_);
+}
+
+std::size_t MappedTextureContainer::GetLevelCount() const {
+  return GetHeader().level_count;
+}
+
+ImageView MappedTextureContainer::GetLevel(std::size_t level) const {
+  const TextureContainerLevel& kLevel {
+    reinterpret_cast<const TextureContainerLevel*>(
+        data_ + sizeof(TextureContainerHeader))[level]
+  };
+
+  return ImageView {
+    static_cast<int>(kLevel.width), static_cast<int>(kLevel.height),
+    static_cast<int>(GetHeader().channels), data_ + kLevel.offset
+  };
+}
+
+unsigned int CreateTexture(const MappedTextureContainer& container) {
+  std::vector<ImageView> levels(container.GetLevelCount());
+  for (std::size_t i { 0 }; i < levels.size(); i++) {
+    levels[i] = container.GetLevel(i);
+  }
+
+  if (container.GetHeader().format == TextureContainerFormat::kBc1) {
+    return CreateBc1Texture(levels);
+  }
+
+  return CreateTexture(levels);
+}
@@ -0,0 +1,177 @@
+#include "texture_decoder.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "profiler.hpp"
+
+namespace {
+
+// Уменьшает изображение вдвое по каждой оси с округлением вниз, как
+// glGenerateMipmap; пиксель результата -- округлённое среднее квадрата 2x2.
+// У стороны нечётной длины последние строка или столбец отбрасываются, а
+// сторона длины 1 не уменьшается: её единственная строка или столбец
+// входит в квадрат дважды.
+Image Downsample(const Image& image) {
+  Image result { };
+  result.width = std::max(1, image.width / 2);
+  result.height = std::max(1, image.height / 2);
+  result.channels = image.channels;
+  result.pixels.resize(static_cast<std::size_t>(result.width) *
+                       result.height * result.channels);
+
+  const std::size_t kRowSize {
+    static_cast<std::size_t>(image.width) * image.channels
+  };
+
+  for (int y { 0 }; y < result.height; y++) {
+    const int kY0 { std::min(2 * y, image.height - 1) };
+    const int kY1 { std::min(2 * y + 1, image.height - 1) };
+    const unsigned char* row0 { image.pixels.data() + kY0 * kRowSize };
+    const unsigned char* row1 { image.pixels.data() + kY1 * kRowSize };
+    unsigned char* destination {
+      result.pixels.data() +
+      static_cast<std::size_t>(y) * result.width * result.channels
+    };
+
+    for (int x { 0 }; x < result.width; x++) {
+      const int kX0 { std::min(2 * x, image.width - 1) * image.channels };
+      const int kX1 { std::min(2 * x + 1, image.width - 1) * image.channels };
+
+      for (int c { 0 }; c < image.channels; c++) {
+        const unsigned int kSum {
+          0u + row0[kX0 + c] + row0[kX1 + c] + row1[kX0 + c] + row1[kX1 + c]
+        };
+        *destination++ = static_cast<unsigned char>((kSum + 2) / 4);
+      }
+    }
+  }
+
+  return result;
+}
+
+}  // namespace
+
+std::vector<Image> CreateMipChain(Image image) {
+  std::vector<Image> levels { };
+  levels.push_back(std::move(image));
+
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    levels.push_back(Downsample(levels.back()));
+  }
+
+  return levels;
+}
+
+TextureDecoder::TextureDecoder(unsigned int thread_count,
+                               std::size_t queue_capacity)
+    : queue_capacity_ { std::max<std::size_t>(1, queue_capacity) },
+      pending_ { 0 },
+      stopping_ { false } {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    thread_count = std::max(1u, thread_count);
+  }
+
+  for (unsigned int i { 0 }; i < thread_count; i++) {
+    workers_.emplace_back(&TextureDecoder::WorkerLoop, this);
+  }
+}
+
+TextureDecoder::~TextureDecoder() {
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    stopping_ = true;
+  }
+  request_condition_.notify_all();
+  space_condition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void TextureDecoder::Submit(std::size_t id, const std::string& path) {
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    requests_.push_back(Request { id, path });
+    pending_++;
+  }
+  request_condition_.notify_one();
+}
+
+bool TextureDecoder::TryPop(DecodedTexture& texture) {
+  {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    if (results_.empty()) {
+      return false;
+    }
+    texture = std::move(results_.front());
+    results_.pop_front();
+    pending_--;
+  }
+  space_condition_.notify_one();
+
+  return true;
+}
+
+bool TextureDecoder::Pop(DecodedTexture& texture) {
+  {
+    std::unique_lock<std::mutex> lock { mutex_ };
+    result_condition_.wait(lock, [this] {
+      return !results_.empty() || pending_ == 0;
+    });
+    if (results_.empty()) {
+      return false;
+    }
+    texture = std::move(results_.front());
+    results_.pop_front();
+    pending_--;
+  }
+  space_condition_.notify_one();
+
+  return true;
+}
+
+unsigned int TextureDecoder::GetThreadCount() const {
+  return static_cast<unsigned int>(workers_.size());
+}
+
+void TextureDecoder::WorkerLoop() {
+  while (true) {
+    Request request { };
+    {
+      std::unique_lock<std::mutex> lock { mutex_ };
+      request_condition_.wait(lock, [this] {
+        return stopping_ || !requests_.empty();
+      });
+      if (stopping_) {
+        return;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+    }
+
+    DecodedTexture texture { request.id, false, { } };
+    {
+      LAB8_PROFILE_SCOPE("DecodeTexture");
+      Image image { };
+      if (LoadImage(request.path.c_str(), image)) {
+        texture.loaded = true;
+        texture.levels = CreateMipChain(std::move(image));
+      }
+    }
+
+    {
+      std::unique_lock<std::mutex> lock { mutex_ };
+      space_condition_.wait(lock, [this] {
+        return stopping_ || results_.size() < queue_capacity_;
+      });
+      if (stopping_) {
+        return;
+      }
+      results_.push_back(std::move(texture));
+    }
+    result_condition_.notify_one();
+  }
+}
@@ -0,0 +1,96 @@
+#include "texture_loader.hpp"
+
+#include <cassert>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "texture_container.hpp"
+
+TextureLoader::TextureLoader(unsigned int thread_count,
+                             std::size_t queue_capacity)
+    : decoder_ { thread_count, queue_capacity },
+      placeholder_ { 0 } {
+  // серая шахматная доска 2x2
+  Image placeholder { 2, 2, 3, { } };
+  placeholder.pixels = {
+    160, 160, 160,  96, 96, 96,
+     96,  96,  96, 160, 160, 160,
+  };
+
+  std::vector<Image> levels { };
+  levels.push_back(std::move(placeholder));
+  placeholder_ = Upload(levels);
+}
+
+TextureLoader::~TextureLoader() {
+  for (unsigned int texture : textures_) {
+    if (texture != 0) {
+      glDeleteTextures(1, &texture);
+    }
+  }
+  glDeleteTextures(1, &placeholder_);
+}
+
+TextureHandle TextureLoader::Load(const std::string& path) {
+  const TextureHandle kHandle { textures_.size() };
+  textures_.push_back(0);
+
+  // подготовленный контейнер загружается сразу: декодировать нечего
+  MappedTextureContainer container { };
+  if (container.OpenForImage(path)) {
+    textures_[kHandle] = CreateTexture(container);
+
+    return kHandle;
+  }
+
+  decoder_.Submit(kHandle, path);
+
+  return kHandle;
+}
+
+std::size_t TextureLoader::ProcessUploads(std::chrono::microseconds budget) {
+  const auto kDeadline { std::chrono::steady_clock::now() + budget };
+  std::size_t upload_count { 0 };
+
+  DecodedTexture texture { };
+  while (decoder_.TryPop(texture)) {
+    if (texture.loaded) {
+      assert(texture.id < textures_.size());
+      textures_[texture.id] = Upload(texture.levels);
+      upload_count++;
+    }
+
+    if (std::chrono::steady_clock::now() >= kDeadline) {
+      break;
+    }
+  }
+
+  return upload_count;
+}
+
+unsigned int TextureLoader::GetTexture(TextureHandle handle) const {
+  assert(handle < textures_.size());
+  return textures_[handle] != 0 ? textures_[handle] : placeholder_;
+}
+
+bool TextureLoader::IsReady(TextureHandle handle) const {
+  assert(handle < textures_.size());
+  return textures_[handle] != 0;
+}
+
+unsigned int TextureLoader::GetThreadCount() const {
+  return decoder_.GetThreadCount();
+}
+
+unsigned int TextureLoader::Upload(const std::vector<Image>& levels) {
+  std::vector<ImageView> views(levels.size());
+  for (std::size_t i { 0 }; i < levels.size(); i++) {
+    views[i] = ImageView {
+      levels[i].width, levels[i].height, levels[i].channels,
+      levels[i].pixels.data()
+    };
+  }
+
+  return CreateTexture(views);
+}
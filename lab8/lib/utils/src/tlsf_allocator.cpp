@@ -0,0 +1,321 @@
+#include "tlsf_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+unsigned int GetHighestBit(std::uint64_t value) {
+  return 63u - static_cast<unsigned int>(__builtin_clzll(value));
+}
+
+unsigned int GetLowestBit(std::uint64_t value) {
+  return static_cast<unsigned int>(__builtin_ctzll(value));
+}
+
+}  // namespace
+
+TlsfAllocator::TlsfAllocator(std::size_t capacity)
+    : first_level_map_ { 0 },
+      second_level_maps_ { },
+      first_block_ { kNone },
+      last_block_ { kNone },
+      capacity_ { 0 },
+      used_size_ { 0 },
+      allocation_count_ { 0 } {
+  std::fill(&free_lists_[0][0],
+            &free_lists_[0][0] + kFirstLevelCount * kSecondLevelCount,
+            kNone);
+  Grow(capacity);
+}
+
+TlsfHandle TlsfAllocator::Allocate(std::size_t size) {
+  assert(size > 0);
+
+  const std::uint32_t kIndex { FindFree(size) };
+  if (kIndex == kNone) {
+    return kInvalidTlsfHandle;
+  }
+  RemoveFree(kIndex);
+
+  // остаток участка возвращается в списки свободных
+  if (blocks_[kIndex].size > size) {
+    const std::uint32_t kRest {
+      CreateBlock(blocks_[kIndex].offset + size, blocks_[kIndex].size - size)
+    };
+    Block& block { blocks_[kIndex] };
+    Block& rest { blocks_[kRest] };
+    block.size = size;
+    rest.previous = kIndex;
+    rest.next = block.next;
+    if (block.next != kNone) {
+      blocks_[block.next].previous = kRest;
+    } else {
+      last_block_ = kRest;
+    }
+    block.next = kRest;
+    InsertFree(kRest);
+  }
+
+  blocks_[kIndex].free = false;
+  used_size_ += size;
+  allocation_count_++;
+
+  return kIndex;
+}
+
+void TlsfAllocator::Free(TlsfHandle handle) {
+  assert(handle < blocks_.size() && !blocks_[handle].free);
+
+  std::uint32_t index { handle };
+  used_size_ -= blocks_[index].size;
+  allocation_count_--;
+
+  // слияние со следующим и предыдущим свободными участками
+  const std::uint32_t kNext { blocks_[index].next };
+  if (kNext != kNone && blocks_[kNext].free) {
+    RemoveFree(kNext);
+    blocks_[index].size += blocks_[kNext].size;
+    blocks_[index].next = blocks_[kNext].next;
+    if (blocks_[kNext].next != kNone) {
+      blocks_[blocks_[kNext].next].previous = index;
+    } else {
+      last_block_ = index;
+    }
+    ReleaseBlock(kNext);
+  }
+
+  const std::uint32_t kPrevious { blocks_[index].previous };
+  if (kPrevious != kNone && blocks_[kPrevious].free) {
+    RemoveFree(kPrevious);
+    blocks_[kPrevious].size += blocks_[index].size;
+    blocks_[kPrevious].next = blocks_[index].next;
+    if (blocks_[index].next != kNone) {
+      blocks_[blocks_[index].next].previous = kPrevious;
+    } else {
+      last_block_ = kPrevious;
+    }
+    ReleaseBlock(index);
+    index = kPrevious;
+  }
+
+  InsertFree(index);
+}
+
+std::size_t TlsfAllocator::GetOffset(TlsfHandle handle) const {
+  return blocks_[handle].offset;
+}
+
+std::size_t TlsfAllocator::GetSize(TlsfHandle handle) const {
+  return blocks_[handle].size;
+}
+
+void TlsfAllocator::Defragment(std::vector<TlsfMove>& moves) {
+  moves.clear();
+
+  std::uint32_t previous { kNone };
+  std::size_t offset { 0 };
+  for (std::uint32_t index { first_block_ }; index != kNone;) {
+    const std::uint32_t kNext { blocks_[index].next };
+
+    if (blocks_[index].free) {
+      RemoveFree(index);
+      ReleaseBlock(index);
+    } else {
+      Block& block { blocks_[index] };
+      if (block.offset != offset) {
+        moves.push_back(TlsfMove { block.offset, offset, block.size });
+        block.offset = offset;
+      }
+      offset += block.size;
+
+      block.previous = previous;
+      if (previous != kNone) {
+        blocks_[previous].next = index;
+      } else {
+        first_block_ = index;
+      }
+      previous = index;
+    }
+
+    index = kNext;
+  }
+
+  if (previous != kNone) {
+    blocks_[previous].next = kNone;
+  } else {
+    first_block_ = kNone;
+  }
+  last_block_ = previous;
+
+  // весь диапазон после занятых участков -- один свободный участок
+  const std::size_t kCapacity { capacity_ };
+  capacity_ = offset;
+  Grow(kCapacity);
+}
+
+void TlsfAllocator::Grow(std::size_t capacity) {
+  assert(capacity >= capacity_);
+  if (capacity == capacity_) {
+    return;
+  }
+
+  const std::size_t kAdded { capacity - capacity_ };
+  if (last_block_ != kNone && blocks_[last_block_].free) {
+    RemoveFree(last_block_);
+    blocks_[last_block_].size += kAdded;
+    InsertFree(last_block_);
+  } else {
+    const std::uint32_t kIndex { CreateBlock(capacity_, kAdded) };
+    blocks_[kIndex].previous = last_block_;
+    if (last_block_ != kNone) {
+      blocks_[last_block_].next = kIndex;
+    } else {
+      first_block_ = kIndex;
+    }
+    last_block_ = kIndex;
+    InsertFree(kIndex);
+  }
+
+  capacity_ = capacity;
+}
+
+std::size_t TlsfAllocator::GetCapacity() const {
+  return capacity_;
+}
+
+std::size_t TlsfAllocator::GetUsedSize() const {
+  return used_size_;
+}
+
+std::size_t TlsfAllocator::GetAllocationCount() const {
+  return allocation_count_;
+}
+
+std::size_t TlsfAllocator::GetLargestFreeSize() const {
+  if (first_level_map_ == 0) {
+    return 0;
+  }
+
+  // наибольший участок лежит в самом старшем непустом списке
+  const unsigned int kFirst { GetHighestBit(first_level_map_) };
+  const unsigned int kSecond {
+    GetHighestBit(second_level_maps_[kFirst])
+  };
+  std::size_t size { 0 };
+  for (std::uint32_t index { free_lists_[kFirst][kSecond] }; index != kNone;
+       index = blocks_[index].next_free) {
+    size = std::max(size, blocks_[index].size);
+  }
+
+  return size;
+}
+
+std::size_t TlsfAllocator::GetFitSize(std::size_t size) {
+  if (size < kSecondLevelCount) {
+    return size;
+  }
+  return size +
+         (std::size_t { 1 } << (GetHighestBit(size) - kSecondLevelBits)) - 1;
+}
+
+void TlsfAllocator::GetClass(std::size_t size, unsigned int& first,
+                             unsigned int& second) {
+  if (size < kSecondLevelCount) {
+    first = 0;
+    second = static_cast<unsigned int>(size);
+    return;
+  }
+
+  const unsigned int kBit { GetHighestBit(size) };
+  first = kBit - kSecondLevelBits + 1;
+  second = static_cast<unsigned int>(size >> (kBit - kSecondLevelBits)) -
+           kSecondLevelCount;
+}
+
+std::uint32_t TlsfAllocator::CreateBlock(std::size_t offset,
+                                         std::size_t size) {
+  const Block kBlock { offset, size, kNone, kNone, kNone, kNone, true };
+
+  if (!spare_blocks_.empty()) {
+    const std::uint32_t kIndex { spare_blocks_.back() };
+    spare_blocks_.pop_back();
+    blocks_[kIndex] = kBlock;
+    return kIndex;
+  }
+
+  blocks_.push_back(kBlock);
+  return static_cast<std::uint32_t>(blocks_.size() - 1);
+}
+
+void TlsfAllocator::ReleaseBlock(std::uint32_t index) {
+  spare_blocks_.push_back(index);
+}
+
+void TlsfAllocator::InsertFree(std::uint32_t index) {
+  unsigned int first { 0 };
+  unsigned int second { 0 };
+  GetClass(blocks_[index].size, first, second);
+
+  Block& block { blocks_[index] };
+  block.free = true;
+  block.previous_free = kNone;
+  block.next_free = free_lists_[first][second];
+  if (block.next_free != kNone) {
+    blocks_[block.next_free].previous_free = index;
+  }
+  free_lists_[first][second] = index;
+
+  first_level_map_ |= std::uint64_t { 1 } << first;
+  second_level_maps_[first] |= 1u << second;
+}
+
+void TlsfAllocator::RemoveFree(std::uint32_t index) {
+  unsigned int first { 0 };
+  unsigned int second { 0 };
+  GetClass(blocks_[index].size, first, second);
+
+  const Block& kBlock { blocks_[index] };
+  if (kBlock.previous_free != kNone) {
+    blocks_[kBlock.previous_free].next_free = kBlock.next_free;
+  } else {
+    free_lists_[first][second] = kBlock.next_free;
+  }
+  if (kBlock.next_free != kNone) {
+    blocks_[kBlock.next_free].previous_free = kBlock.previous_free;
+  }
+
+  if (free_lists_[first][second] == kNone) {
+    second_level_maps_[first] &= ~(1u << second);
+    if (second_level_maps_[first] == 0) {
+      first_level_map_ &= ~(std::uint64_t { 1 } << first);
+    }
+  }
+}
+
+std::uint32_t TlsfAllocator::FindFree(std::size_t size) const {
+  // Размер округляется вверх до начала следующего класса: тогда любой
+  // участок найденного класса не меньше size и список не нужно обходить.
+  unsigned int first { 0 };
+  unsigned int second { 0 };
+  GetClass(GetFitSize(size), first, second);
+  if (first >= kFirstLevelCount) {
+    return kNone;
+  }
+
+  std::uint32_t second_map { second_level_maps_[first] & (~0u << second) };
+  if (second_map == 0) {
+    const std::uint64_t kFirstMap {
+      first + 1 < kFirstLevelCount
+          ? first_level_map_ & (~std::uint64_t { 0 } << (first + 1))
+          : 0
+    };
+    if (kFirstMap == 0) {
+      return kNone;
+    }
+    first = GetLowestBit(kFirstMap);
+    second_map = second_level_maps_[first];
+  }
+
+  return free_lists_[first][GetLowestBit(second_map)];
+}
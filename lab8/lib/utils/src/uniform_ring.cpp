@@ -0,0 +1,166 @@
+#include "uniform_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// ожидание барьера порциями по одной секунде
+constexpr GLuint64 kWaitTimeout { 1000000000 };
+
+std::size_t AlignUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+UniformRing::UniformRing(GlStateCache& state, std::size_t frame_capacity,
+                         unsigned int frame_count)
+    : state_ { state },
+      gl_ { state.GetDispatch() },
+      mapping_ { nullptr },
+      fences_(std::max(1u, frame_count), nullptr),
+      frame_ { static_cast<unsigned int>(fences_.size()) - 1 },
+      used_size_ { 0 },
+      flushed_size_ { 0 },
+      wait_count_ { 0 } {
+  GLint alignment { 0 };
+  gl_.get_integerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  alignment_ = static_cast<std::size_t>(std::max(1, alignment));
+  frame_capacity_ = AlignUp(std::max<std::size_t>(1, frame_capacity),
+                            alignment_);
+
+  const GLsizeiptr kBufferSize {
+    static_cast<GLsizeiptr>(frame_capacity_ * fences_.size())
+  };
+
+  gl_.gen_buffers(1, &buffer_);
+  state_.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+
+  if (gl_.buffer_storage) {
+    const GLbitfield kFlags {
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT
+    };
+    gl_.buffer_storage(GL_UNIFORM_BUFFER, kBufferSize, nullptr, kFlags);
+    mapping_ = static_cast<unsigned char*>(
+        gl_.map_buffer_range(GL_UNIFORM_BUFFER, 0, kBufferSize, kFlags));
+
+    if (!mapping_) {
+      // размер неизменяемого буфера нельзя задать повторно
+      state_.ForgetBuffer(buffer_);
+      gl_.delete_buffers(1, &buffer_);
+      gl_.gen_buffers(1, &buffer_);
+      state_.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    }
+  }
+
+  if (!mapping_) {
+    gl_.buffer_data(GL_UNIFORM_BUFFER, kBufferSize, nullptr, GL_STREAM_DRAW);
+    staging_.resize(frame_capacity_);
+  }
+}
+
+UniformRing::~UniformRing() {
+  for (GLsync fence : fences_) {
+    if (fence) {
+      gl_.delete_sync(fence);
+    }
+  }
+
+  if (mapping_) {
+    state_.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    gl_.unmap_buffer(GL_UNIFORM_BUFFER);
+  }
+
+  state_.ForgetBuffer(buffer_);
+  gl_.delete_buffers(1, &buffer_);
+}
+
+void UniformRing::BeginFrame() {
+  frame_ = (frame_ + 1) % fences_.size();
+  used_size_ = 0;
+  flushed_size_ = 0;
+
+  GLsync& fence { fences_[frame_] };
+  if (!fence) {
+    return;
+  }
+
+  GLenum result {
+    gl_.client_wait_sync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)
+  };
+  if (result == GL_TIMEOUT_EXPIRED) {
+    wait_count_++;
+    while (result == GL_TIMEOUT_EXPIRED) {
+      result = gl_.client_wait_sync(fence, 0, kWaitTimeout);
+    }
+  }
+
+  gl_.delete_sync(fence);
+  fence = nullptr;
+}
+
+UniformAllocation UniformRing::Allocate(std::size_t size) {
+  const std::size_t kOffset { AlignUp(used_size_, alignment_) };
+  if (kOffset + size > frame_capacity_) {
+    return UniformAllocation { nullptr, 0, 0 };
+  }
+  used_size_ = kOffset + size;
+
+  unsigned char* base {
+    mapping_ ? mapping_ + frame_ * frame_capacity_ : staging_.data()
+  };
+  return UniformAllocation {
+    base + kOffset,
+    static_cast<GLintptr>(frame_ * frame_capacity_ + kOffset),
+    static_cast<GLsizeiptr>(size)
+  };
+}
+
+void UniformRing::Flush() {
+  if (mapping_ || used_size_ == flushed_size_) {
+    flushed_size_ = used_size_;
+    return;
+  }
+
+  // Область кадра защищена барьером, поэтому драйверу не нужно ждать
+  // чтения буфера GPU.
+  state_.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  void* destination {
+    gl_.map_buffer_range(
+        GL_UNIFORM_BUFFER,
+        static_cast<GLintptr>(frame_ * frame_capacity_ + flushed_size_),
+        static_cast<GLsizeiptr>(used_size_ - flushed_size_),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT)
+  };
+  if (destination) {
+    std::memcpy(destination, staging_.data() + flushed_size_,
+                used_size_ - flushed_size_);
+    gl_.unmap_buffer(GL_UNIFORM_BUFFER);
+  }
+
+  flushed_size_ = used_size_;
+}
+
+void UniformRing::Bind(GLuint index, const UniformAllocation& allocation,
+                       GLintptr offset, GLsizeiptr size) {
+  state_.BindBufferRange(GL_UNIFORM_BUFFER, index, buffer_,
+                         allocation.offset + offset, size);
+}
+
+void UniformRing::EndFrame() {
+  fences_[frame_] = gl_.fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool UniformRing::IsPersistent() const {
+  return mapping_ != nullptr;
+}
+
+std::size_t UniformRing::GetAlignment() const {
+  return alignment_;
+}
+
+std::size_t UniformRing::GetWaitCount() const {
+  return wait_count_;
+}
@@ -0,0 +1,88 @@
+#include "vertex_format.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+std::uint16_t EncodeHalf(float value) {
+  std::uint32_t bits { 0 };
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const std::uint32_t kSign { (bits >> 16) & 0x8000u };
+  const std::uint32_t kExponent { (bits >> 23) & 0xffu };
+  std::uint32_t mantissa { bits & 0x7fffffu };
+
+  // бесконечность и NaN
+  if (kExponent == 0xffu) {
+    return kSign | 0x7c00u | (mantissa ? 0x200u : 0u);
+  }
+
+  // смещение порядка float равно 127, half -- 15
+  const int kHalfExponent { static_cast<int>(kExponent) - 127 + 15 };
+
+  // переполнение
+  if (kHalfExponent >= 0x1f) {
+    return kSign | 0x7c00u;
+  }
+
+  // денормализованное число или ноль
+  if (kHalfExponent <= 0) {
+    if (kHalfExponent < -10) {
+      return kSign;
+    }
+
+    mantissa |= 0x800000u;
+    const int kShift { 14 - kHalfExponent };
+    const std::uint32_t kHalfMantissa { mantissa >> kShift };
+    const std::uint32_t kRemainder { mantissa & ((1u << kShift) - 1) };
+    const std::uint32_t kHalfway { 1u << (kShift - 1) };
+
+    // округление к ближайшему чётному
+    std::uint32_t half { kSign | kHalfMantissa };
+    if (kRemainder > kHalfway ||
+        (kRemainder == kHalfway && (kHalfMantissa & 1u))) {
+      half++;
+    }
+    return half;
+  }
+
+  std::uint32_t half {
+    kSign | (static_cast<std::uint32_t>(kHalfExponent) << 10) | (mantissa >> 13)
+  };
+  const std::uint32_t kRemainder { mantissa & 0x1fffu };
+
+  // округление к ближайшему чётному; перенос в порядок корректен, в том числе
+  // при переполнении в бесконечность
+  if (kRemainder > 0x1000u || (kRemainder == 0x1000u && (half & 1u))) {
+    half++;
+  }
+
+  return half;
+}
+
+float DecodeHalf(std::uint16_t half) {
+  const std::uint32_t kSign { (half & 0x8000u) << 16 };
+  std::uint32_t exponent { (half >> 10) & 0x1fu };
+  std::uint32_t mantissa { half & 0x3ffu };
+
+  std::uint32_t bits { 0 };
+  if (exponent == 0x1fu) {
+    bits = kSign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = kSign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // нормализация денормализованного числа
+    exponent = 127 - 15 + 1;
+    while (!(mantissa & 0x400u)) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = kSign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+  } else {
+    bits = kSign;
+  }
+
+  float value { 0.0f };
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <glad/glad.h>
@@ -8,146 +14,766 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "cylinder_lod.hpp"
+#include "frame_readback.hpp"
+#include "gl_state.hpp"
+#include "image_writer.hpp"
+#include "index_buffer.hpp"
+#include "instance_bvh.hpp"
+#include "instance_store.hpp"
+#include "job_system.hpp"
+#include "mesh_arena.hpp"
+#include "offscreen_context.hpp"
+#include "profiler.hpp"
+#include "shader_cache.hpp"
+#include "simulation.hpp"
+#include "software_renderer.hpp"
+#include "texture_loader.hpp"
+#include "uniform_ring.hpp"
 #include "utils.hpp"
+#include "vertex_format.hpp"
 
-int main() {
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
+// время, отводимое за кадр на загрузку готовых текстур в OpenGL
+constexpr std::chrono::microseconds kTextureUploadBudget { 2000 };
+// частота шагов моделирования, Гц
+constexpr double kSimulationTickRate { 60.0 };
+// число матриц в блоке InstanceTransforms вершинного шейдера
+constexpr std::size_t kMaxInstancesPerDraw { 256 };
+constexpr GLuint kInstanceTransformsBinding { 0 };
+// атрибут номера экземпляра в вершинном шейдере
+constexpr GLuint kInstanceIndexLocation { 2 };
+// наибольшее по умолчанию отклонение силуэта фигуры от окружности, пикселей
+constexpr float kDefaultLodError { 0.5f };
+// Во сколько раз может вырасти стоимость обхода иерархии отсечения после
+// пересчёта границ, прежде чем иерархия будет построена заново.
+constexpr float kBvhRebuildCostRatio { 1.5f };
+// наименьшее число экземпляров в одном задании подготовки кадра
+constexpr std::size_t kJobGrainSize { 1024 };
+
+// Отрисовывает frame_count кадров программным растеризатором без контекста
+// OpenGL и сообщает достигнутую производительность. Последний кадр
+// сохраняется в output_path, если он задан.
+int RunSoftwareRenderer(int frame_count, const char* output_path) {
+  Image image { };
+  if (!LoadImage(kTexturePath.c_str(), image)) {
     return -1;
   }
+  const SoftwareTexture kTexture { image };
+
+  const std::vector<double> kCoordinates {
+    CreateCylinderCoordinates(kCylinderSectorCount, kCylinderRadius,
+                              kCylinderHeight)
+  };
+  const std::vector<unsigned int> kIndices {
+    CreateCylinderIndices(kCylinderSectorCount)
+  };
+
+  SoftwareRenderer renderer { };
+  SoftwareFramebuffer framebuffer { kViewportWidth, kViewportHeight };
+
+  // фигура вращается и движется так же, как в интерактивном режиме при
+  // зажатых клавишах
+  float alpha { 0 };
+  float beta { 0 };
+  float x_offset { 0 };
+  float y_offset { 0 };
+  int x_direction { 1 };
+  int y_direction { 1 };
+
+  const auto kStart { std::chrono::steady_clock::now() };
+
+  Profiler& profiler { Profiler::GetInstance() };
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); 
+  for (int frame { 0 }; frame < frame_count; frame++) {
+    profiler.BeginFrame();
 
-  GLFWwindow* window {
-    glfwCreateWindow(kWindowWidth, kWindowHeight, kWindowTitle,
-                     nullptr, nullptr)
+    alpha += kAlphaChanging;
+    beta += kBetaChanging;
+    UpdatePosition(x_offset, y_offset, x_direction, y_direction);
+
+    framebuffer.Clear(0.1f, 0.1f, 0.1f, 1.0f);
+    renderer.Draw(kCoordinates, kIndices,
+                  CreateTransform(x_offset, y_offset, alpha, beta), kTexture,
+                  framebuffer);
+
+    profiler.EndFrame();
+  }
+
+  const std::chrono::duration<double> kElapsed {
+    std::chrono::steady_clock::now() - kStart
   };
-  
-  if (!window) {
-    std::cerr << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
+  const double kTriangles {
+    static_cast<double>(kIndices.size() / 3) * frame_count
+  };
+
+  std::cout << "Software renderer: " << renderer.GetThreadCount()
+            << " threads, " << frame_count << " frames, "
+            << frame_count / kElapsed.count() << " frames/s, "
+            << kTriangles / kElapsed.count() * 1e-6 << " Mtris/s"
+            << std::endl;
+  profiler.PrintStatistics(std::cout);
+
+  if (output_path && !framebuffer.WritePpm(output_path)) {
     return -1;
   }
-  
-  glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
 
-  glfwMakeContextCurrent(window);
-  
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-    std::cerr << "Failed to initialize GLAD" << std::endl;
-    glfwTerminate();
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && std::strcmp(argv[1], "--software") == 0) {
+    return RunSoftwareRenderer(std::atoi(argv[2]),
+                               argc >= 4 ? argv[3] : nullptr);
+  }
+
+  // число одновременно движущихся фигур
+  std::size_t instance_count { 1 };
+  // число кадров до выхода с выводом профиля; 0 -- до закрытия окна
+  int frame_limit { 0 };
+  // файл для трассы Chrome trace event
+  const char* trace_path { nullptr };
+  // отрисовка без окна; кадры записываются по шаблону output_pattern (см.
+  // GetSequencePath), если он не пуст
+  bool offscreen { false };
+  std::string output_pattern { };
+  // допустимое отклонение силуэта при выборе уровня детализации, пикселей
+  float lod_error { kDefaultLodError };
+  // приближение камеры; при zoom > 1 часть фигур оказывается за кадром
+  float zoom { 1.0f };
+  // число потоков подготовки кадра вместе с основным; 0 -- по числу ядер
+  unsigned int thread_count { 0 };
+  // каталог кэша программ; пустой -- без кэша
+  std::string shader_cache_directory { kShaderCacheDirectory };
+
+  for (int i { 1 }; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << argv[i] << std::endl;
+      return -1;
+    }
+
+    if (std::strcmp(argv[i], "--instances") == 0) {
+      const int kInstanceCount { std::atoi(argv[i + 1]) };
+      if (kInstanceCount <= 0) {
+        std::cerr << "Invalid instance count" << std::endl;
+        return -1;
+      }
+      instance_count = static_cast<std::size_t>(kInstanceCount);
+    } else if (std::strcmp(argv[i], "--frames") == 0) {
+      frame_limit = std::atoi(argv[i + 1]);
+      if (frame_limit <= 0) {
+        std::cerr << "Invalid frame count" << std::endl;
+        return -1;
+      }
+    } else if (std::strcmp(argv[i], "--trace") == 0) {
+      trace_path = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--lod-error") == 0) {
+      lod_error = static_cast<float>(std::atof(argv[i + 1]));
+      if (lod_error <= 0.0f) {
+        std::cerr << "Invalid LOD error" << std::endl;
+        return -1;
+      }
+    } else if (std::strcmp(argv[i], "--zoom") == 0) {
+      zoom = static_cast<float>(std::atof(argv[i + 1]));
+      if (zoom <= 0.0f) {
+        std::cerr << "Invalid zoom" << std::endl;
+        return -1;
+      }
+    } else if (std::strcmp(argv[i], "--threads") == 0) {
+      const int kThreadCount { std::atoi(argv[i + 1]) };
+      if (kThreadCount <= 0) {
+        std::cerr << "Invalid thread count" << std::endl;
+        return -1;
+      }
+      thread_count = static_cast<unsigned int>(kThreadCount);
+    } else if (std::strcmp(argv[i], "--shader-cache") == 0) {
+      shader_cache_directory =
+          std::strcmp(argv[i + 1], "none") == 0 ? "" : argv[i + 1];
+    } else if (std::strcmp(argv[i], "--offscreen") == 0) {
+#ifdef LAB8_HEADLESS
+      offscreen = true;
+      if (std::strcmp(argv[i + 1], "none") != 0) {
+        output_pattern = argv[i + 1];
+      }
+#else
+      std::cerr << "Built without LAB8_ENABLE_HEADLESS" << std::endl;
+      return -1;
+#endif
+    } else {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      return -1;
+    }
+  }
+
+  if (offscreen && frame_limit == 0) {
+    std::cerr << "--offscreen requires --frames" << std::endl;
     return -1;
   }
+
+  Profiler& profiler { Profiler::GetInstance() };
+  if (trace_path) {
+    profiler.EnableTrace();
+  }
+
+  GLFWwindow* window { nullptr };
+  // Контекст без окна уничтожается последним, после всех объектов OpenGL.
+  std::unique_ptr<OffscreenContext> offscreen_context { };
+
+  if (offscreen) {
+#ifdef LAB8_HEADLESS
+    offscreen_context = std::make_unique<OffscreenContext>();
+    if (!offscreen_context->Create()) {
+      return -1;
+    }
+#endif
+  } else {
+    if (!glfwInit()) {
+      std::cerr << "Failed to initialize GLFW" << std::endl;
+      return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    window = glfwCreateWindow(kWindowWidth, kWindowHeight, kWindowTitle,
+                              nullptr, nullptr);
+
+    if (!window) {
+      std::cerr << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+
+    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cerr << "Failed to initialize GLAD" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+  }
   
   glViewport(0, 0, kViewportWidth, kViewportHeight);
 
-  unsigned int shader_program {
-    CreateShaderProgram(kVertexShaderPath.c_str(), kFragmentShaderPath.c_str())
+  // Скомпонованная программа берётся из кэша на диске, если шейдеры и
+  // драйвер не изменились с прошлого запуска.
+  const auto kShaderStart { std::chrono::steady_clock::now() };
+  ShaderCache shader_cache { shader_cache_directory };
+  const GLuint shader_program {
+    shader_cache.CreateProgram(kVertexShaderPath, kFragmentShaderPath)
   };
-  
-  if (shader_program == -1) {
+  const std::chrono::duration<double, std::milli> kShaderTime {
+    std::chrono::steady_clock::now() - kShaderStart
+  };
+
+  if (shader_program == 0) {
     glfwTerminate();
     return -1;
   }
   
   glUseProgram(shader_program);
+  glUniformBlockBinding(
+      shader_program,
+      glGetUniformBlockIndex(shader_program, "InstanceTransforms"),
+      kInstanceTransformsBinding);
 
-  int transform_loc {
-    glGetUniformLocation(shader_program, "transform")
+  // Текстура декодируется в фоне; до её готовности фигура рисуется с
+  // заглушкой. Загрузчик удаляет свои текстуры, поэтому он должен быть
+  // уничтожен до контекста.
+  std::unique_ptr<TextureLoader> texture_loader {
+    std::make_unique<TextureLoader>()
   };
-  
-  if (transform_loc == -1) {
-    std::cerr << "Failed to get transform uniform location" << std::endl;
-    glfwTerminate();
-    return -1;
-  }
-  
-  unsigned int texture { CreateTexture(kTexturePath.c_str()) };
-  if (texture == -1) {
-    glfwTerminate();
-    return -1;
-  }
-  
-  glBindTexture(GL_TEXTURE_2D, texture);
+  const TextureHandle kTexture { texture_loader->Load(kTexturePath) };
 
-  std::vector<double> coordinates {
-    CreateCylinderCoordinates(kCylinderSectorCount, kCylinderRadius,
-                              kCylinderHeight)
+  // Дальше привязки выполняются через кэш, пропускающий повторные.
+  GlStateCache gl_state { LoadGlDispatch() };
+
+  // Сетки лежат в общих буферах арены, а кадр рисуется командами,
+  // собранными по всем сеткам, по одному вызову на порцию экземпляров.
+  std::unique_ptr<MeshArena> mesh_arena {
+    std::make_unique<MeshArena>(
+        gl_state, sizeof(CylinderVertexFormat::Vertex),
+        CylinderVertexFormat::SetupAttributes, GL_UNSIGNED_SHORT,
+        kInstanceIndexLocation, kMaxInstancesPerDraw)
   };
 
-  std::vector<unsigned int> indices {
-    CreateCylinderIndices(kCylinderSectorCount)
+  // Уровни детализации от удвоенного числа секторов до 4.
+  const CylinderLod kLod {
+    CreateLodSectorCounts(2 * kCylinderSectorCount), kCylinderRadius,
+    lod_error
   };
 
-  unsigned int vao { 0 };
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
-
-  unsigned int vbo { 0 };
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, coordinates.size() * sizeof(double),
-               coordinates.data(), GL_DYNAMIC_DRAW);
-
-  unsigned int ebo { 0 };
-  glGenBuffers(1, &ebo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(double),
-               indices.data(), GL_DYNAMIC_DRAW);
-
-  const unsigned int kStride { 5 * sizeof(double) };
-  void* position_offset { reinterpret_cast<void*>(0) };
-  glVertexAttribPointer(0, 3, GL_DOUBLE, GL_FALSE, kStride, position_offset);
-  glEnableVertexAttribArray(0);
-
-  void* texture_offset { reinterpret_cast<void*>(3 * sizeof(double)) };
-  glVertexAttribPointer(1, 2, GL_DOUBLE, GL_FALSE, kStride, texture_offset);
-  glEnableVertexAttribArray(1); 
-  
-  // углы поворота вокруг векторов (1, 0, 0) и (0, 1, 0) соответственно
-  float alpha { 0 };
-  float beta { 0 };
-  
-  // центр фигуры
-  float x_offset { 0 };
-  float y_offset { 0 };
-  
-  // направление движения фигуры
-  int x_direction { 1 };
-  int y_direction { 1 };
-  
+  // Отсечение нелицевых граней выключено, поэтому порядок обхода вершин в
+  // полосах треугольников можно не сохранять.
+  IndexBufferOptions index_buffer_options { };
+  index_buffer_options.use_triangle_strips = true;
+  index_buffer_options.preserve_winding = false;
+
+  std::vector<MeshHandle> level_meshes { };
+  std::vector<std::size_t> level_triangle_counts { };
+
+  for (std::size_t level { 0 }; level < kLod.GetLevelCount(); level++) {
+    const unsigned int kSectorCount { kLod.GetSectorCount(level) };
+    const std::vector<CylinderVertexFormat::Vertex> kVertices {
+      CylinderVertexFormat::Encode(CreateCylinderCoordinates(
+          kSectorCount, kCylinderRadius, kCylinderHeight))
+    };
+    const std::vector<unsigned int> kIndices {
+      CreateCylinderIndices(kSectorCount)
+    };
+
+    level_meshes.push_back(mesh_arena->AddMesh(
+        kVertices.data(), kVertices.size(),
+        CreateIndexBuffer(kIndices, kVertices.size(), index_buffer_options)));
+    if (level_meshes.back() == kInvalidMeshHandle) {
+      std::cerr << "Failed to add the cylinder mesh to the arena"
+                << std::endl;
+      mesh_arena.reset();
+      glDeleteProgram(shader_program);
+      texture_loader.reset();
+      glfwTerminate();
+      return -1;
+    }
+    level_triangle_counts.push_back(kIndices.size() / 3);
+  }
+
+  // Фигуры движутся в отдельном потоке с постоянной частотой шагов, не
+  // зависящей от частоты кадров; кадр показывает состояние между двумя
+  // последними шагами. Нулевая фигура движется так же, как одиночная.
+  SimulationThread simulation {
+    CreateInstanceStore(instance_count, 0), kSimulationTickRate
+  };
+  InstanceStore instances { };
+
   glEnable(GL_DEPTH_TEST);
-  
-  while (!glfwWindowShouldClose(window)) {
-    ProcessInput(window, alpha, beta);
-    
+
+  glEnable(GL_PRIMITIVE_RESTART);
+  glPrimitiveRestartIndex(mesh_arena->GetRestartIndex());
+
+  // Матрицы экземпляров строятся каждый кадр, невидимые экземпляры
+  // отсекаются, по матрицам видимых выбираются уровни детализации, после
+  // чего матрицы записываются в кольцевой буфер по порядку уровней и
+  // рисуются порциями по kMaxInstancesPerDraw. Смещение каждой порции --
+  // 16 КБ, поэтому оно выровнено для любой реализации.
+  const GLsizeiptr kMatrixSize { kInstanceTransformSize * sizeof(float) };
+  const std::size_t kTransformsSize { instance_count * kMatrixSize };
+  std::unique_ptr<UniformRing> uniform_ring {
+    std::make_unique<UniformRing>(gl_state, kTransformsSize)
+  };
+
+  std::vector<float> transforms(instance_count * kInstanceTransformSize);
+
+  // Камера приближает сцену к центру. Матрицы экземпляров переводят фигуры
+  // в пространство сцены, поэтому плоскости пирамиды видимости берутся из
+  // матрицы камеры, а иерархия строится по границам в пространстве сцены.
+  const glm::mat4 kViewProjection {
+    glm::scale(glm::mat4(1.0f), glm::vec3(zoom, zoom, 1.0f))
+  };
+  const Frustum kFrustum {
+    ExtractFrustumPlanes(glm::value_ptr(kViewProjection))
+  };
+  InstanceBounds instance_bounds { };
+  InstanceBvh instance_bvh { };
+  float bvh_build_cost { 0.0f };
+  std::size_t bvh_build_count { 0 };
+  std::vector<std::uint32_t> visible_instances { };
+  // матрицы видимых экземпляров с учётом камеры, в порядке visible_instances
+  std::vector<float> visible_transforms { };
+  std::size_t visible_count { 0 };
+
+  // уровни прошлого кадра, от которых отсчитывается гистерезис
+  std::vector<unsigned char> instance_levels(instance_count, 0);
+  // первый экземпляр каждого уровня в кольцевом буфере и число экземпляров
+  std::vector<std::size_t> level_firsts(kLod.GetLevelCount());
+  std::vector<std::size_t> level_counts(kLod.GetLevelCount());
+  std::size_t triangle_count { 0 };
+
+  // Подготовка кадра выполняется заданиями в пуле потоков; OpenGL
+  // вызывается только из основного потока. Видимые экземпляры делятся на
+  // блоки, в каждом из которых уровни детализации выбираются и считаются
+  // независимо; block_level_counts хранит эти числа, а затем -- место
+  // следующего экземпляра блока в кольцевом буфере для каждого уровня.
+  JobSystem jobs { thread_count };
+  std::vector<std::size_t> block_level_counts { };
+  // Команды порций собираются заданиями в отдельные списки, которые
+  // основной поток выполняет по порядку.
+  std::vector<DrawCommandBuilder> batch_commands { };
+
+  // Без окна кадры рисуются в свой кадровый буфер и читаются через
+  // кольцо буферов пикселей, а кодируются и записываются в пуле потоков.
+  std::unique_ptr<FrameReadback> readback { };
+  std::unique_ptr<ImageWriter> image_writer { };
+  if (offscreen) {
+    readback = std::make_unique<FrameReadback>(kViewportWidth,
+                                               kViewportHeight);
+    if (!readback->IsComplete()) {
+      std::cerr << "Failed to create the offscreen framebuffer" << std::endl;
+      return -1;
+    }
+    if (!output_pattern.empty()) {
+      image_writer = std::make_unique<ImageWriter>();
+    }
+  }
+
+  // забирает самый старый прочитанный кадр и отдаёт его на запись
+  auto write_frame = [&readback, &image_writer, &output_pattern] {
+    Image image { };
+    std::uint64_t index { 0 };
+    if (readback->Pop(image, index) && image_writer) {
+      image_writer->Submit(GetSequencePath(output_pattern, index),
+                           std::move(image));
+    }
+  };
+
+  profiler.EnableGpuTimers();
+
+  const auto kStart { std::chrono::steady_clock::now() };
+
+  for (int frame { 0 };
+       (!window || !glfwWindowShouldClose(window)) &&
+       (frame_limit == 0 || frame < frame_limit);
+       frame++) {
+    profiler.BeginFrame();
+
+    // изменения углов поворота вокруг векторов (1, 0, 0) и (0, 1, 0)
+    // за шаг моделирования; без окна -- как при зажатых клавишах
+    float alpha_changing { 0 };
+    float beta_changing { 0 };
+    if (window) {
+      LAB8_PROFILE_SCOPE("ProcessInput");
+      ProcessInput(window, alpha_changing, beta_changing);
+    } else {
+      alpha_changing = kAlphaChanging;
+      beta_changing = kBetaChanging;
+    }
+    // ввод относится к шагу после показанного снимка; если моделирование
+    // уже прошло его, поворот начнётся с ближайшего шага
+    simulation.SetRotation(simulation.GetSnapshot().tick + 1, alpha_changing,
+                           beta_changing);
+
+    if (readback) {
+      readback->Bind();
+    }
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    {
+      LAB8_PROFILE_SCOPE("ProcessUploads");
+      if (texture_loader->ProcessUploads(kTextureUploadBudget) > 0) {
+        // загрузка привязывает новые текстуры в обход кэша
+        gl_state.Invalidate();
+      }
+    }
     
-    UpdatePosition(x_offset, y_offset, x_direction, y_direction);
-    
-    glm::mat4 transform { glm::mat4(1.0f) };
-    transform = glm::translate(transform, glm::vec3(x_offset, y_offset, 0.0f));
-    transform = glm::rotate(transform, alpha, glm::vec3(1.0f, 0.0f, 0.0f));
-    transform = glm::rotate(transform, beta, glm::vec3(0.0f, 1.0f, 0.0f));
-    
-    glUniformMatrix4fv(transform_loc, 1, GL_FALSE, glm::value_ptr(transform));
-    
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    {
+      LAB8_PROFILE_SCOPE("Interpolate");
+      simulation.Update();
+      const SimulationSnapshot& kSnapshot { simulation.GetSnapshot() };
+      const float kFactor {
+        simulation.GetInterpolationFactor(std::chrono::steady_clock::now())
+      };
+      instances.Resize(instance_count);
+      jobs.ParallelFor(
+          instance_count, kJobGrainSize,
+          [&](std::size_t first, std::size_t end) {
+            InterpolateInstances(kSnapshot.previous, kSnapshot.current,
+                                 kFactor, first, end - first, instances);
+          });
+    }
+    {
+      LAB8_PROFILE_SCOPE("WaitUniformRing");
+      uniform_ring->BeginFrame();
+    }
+
+    {
+      LAB8_PROFILE_SCOPE("BuildTransforms");
+      instance_bounds.Resize(instance_count);
+      jobs.ParallelFor(
+          instance_count, kJobGrainSize,
+          [&](std::size_t first, std::size_t end) {
+            BuildInstanceTransforms(instances, first, end - first,
+                                    transforms.data());
+            ComputeCylinderBounds(transforms.data(), first, end - first,
+                                  kCylinderRadius, kCylinderHalfHeight,
+                                  instance_bounds);
+          });
+    }
+    {
+      LAB8_PROFILE_SCOPE("Cull");
+      // Пересчёт границ дешевле построения, но фигуры разлетаются, и узлы
+      // разрастаются; тогда иерархия строится заново.
+      if (instance_bvh.GetInstanceCount() == instance_count) {
+        instance_bvh.Refit(instance_bounds);
+      }
+      if (instance_bvh.GetInstanceCount() != instance_count ||
+          instance_bvh.GetCost() > kBvhRebuildCostRatio * bvh_build_cost) {
+        instance_bvh.Build(instance_bounds);
+        bvh_build_cost = instance_bvh.GetCost();
+        bvh_build_count++;
+      }
+      instance_bvh.Cull(kFrustum, instance_bounds, visible_instances);
+      visible_count += visible_instances.size();
+    }
+
+    const std::size_t kVisibleCount { visible_instances.size() };
+    const std::size_t kLevelCount { level_meshes.size() };
+    const std::size_t kBlockCount {
+      std::max<std::size_t>(
+          1, std::min<std::size_t>(
+                 4 * jobs.GetThreadCount(),
+                 (kVisibleCount + kJobGrainSize - 1) / kJobGrainSize))
+    };
+    // первый видимый экземпляр блока
+    auto get_block_first = [kVisibleCount, kBlockCount](std::size_t block) {
+      return kVisibleCount * block / kBlockCount;
+    };
+    UniformAllocation sorted_transforms { };
+    {
+      LAB8_PROFILE_SCOPE("SelectLod");
+      visible_transforms.resize(kVisibleCount * kInstanceTransformSize);
+      block_level_counts.assign(kBlockCount * kLevelCount, 0);
+
+      jobs.ParallelFor(
+          kBlockCount, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t block { begin }; block < end; block++) {
+              const std::size_t kFirst { get_block_first(block) };
+              const std::size_t kEnd { get_block_first(block + 1) };
+              float* block_transforms {
+                visible_transforms.data() + kFirst * kInstanceTransformSize
+              };
+
+              for (std::size_t i { kFirst }; i < kEnd; i++) {
+                const glm::mat4 kTransform {
+                  kViewProjection *
+                      glm::make_mat4(transforms.data() +
+                                     visible_instances[i] *
+                                         kInstanceTransformSize)
+                };
+                std::copy_n(glm::value_ptr(kTransform),
+                            kInstanceTransformSize,
+                            visible_transforms.data() +
+                                i * kInstanceTransformSize);
+              }
+              kLod.SelectLevels(block_transforms,
+                                visible_instances.data() + kFirst,
+                                kEnd - kFirst,
+                                static_cast<float>(kViewportWidth),
+                                static_cast<float>(kViewportHeight),
+                                instance_levels);
+
+              std::size_t* counts {
+                block_level_counts.data() + block * kLevelCount
+              };
+              for (std::size_t i { kFirst }; i < kEnd; i++) {
+                counts[instance_levels[visible_instances[i]]]++;
+              }
+            }
+          });
+
+      // экземпляры каждого уровня идут подряд, внутри уровня -- по блокам
+      std::size_t first { 0 };
+      for (std::size_t level { 0 }; level < kLevelCount; level++) {
+        level_firsts[level] = first;
+        for (std::size_t block { 0 }; block < kBlockCount; block++) {
+          std::size_t& position {
+            block_level_counts[block * kLevelCount + level]
+          };
+          const std::size_t kCount { position };
+          position = first;
+          first += kCount;
+        }
+        level_counts[level] = first - level_firsts[level];
+        triangle_count += level_triangle_counts[level] * level_counts[level];
+      }
+
+      sorted_transforms = uniform_ring->Allocate(kVisibleCount * kMatrixSize);
+      jobs.ParallelFor(
+          kBlockCount, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t block { begin }; block < end; block++) {
+              std::size_t* positions {
+                block_level_counts.data() + block * kLevelCount
+              };
+              for (std::size_t i { get_block_first(block) };
+                   i < get_block_first(block + 1); i++) {
+                const unsigned char kLevel {
+                  instance_levels[visible_instances[i]]
+                };
+                std::copy_n(visible_transforms.data() +
+                                i * kInstanceTransformSize,
+                            kInstanceTransformSize,
+                            static_cast<float*>(sorted_transforms.data) +
+                                positions[kLevel]++ * kInstanceTransformSize);
+              }
+            }
+          });
+      uniform_ring->Flush();
+    }
+
+    const std::size_t kBatchCount {
+      (kVisibleCount + kMaxInstancesPerDraw - 1) / kMaxInstancesPerDraw
+    };
+    {
+      LAB8_PROFILE_SCOPE("BuildCommands");
+      if (batch_commands.size() < kBatchCount) {
+        batch_commands.resize(kBatchCount);
+      }
+
+      // команды уровней, экземпляры которых попали в порцию
+      jobs.ParallelFor(
+          kBatchCount, 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t batch { begin }; batch < end; batch++) {
+              const std::size_t kFirst { batch * kMaxInstancesPerDraw };
+              const std::size_t kEnd {
+                std::min(kFirst + kMaxInstancesPerDraw, kVisibleCount)
+              };
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+              DrawCommandBuilder& commands { batch_commands[batch] };
+              commands.Clear();
+              for (std::size_t level { 0 }; level < kLevelCount; level++) {
+                const std::size_t kBegin {
+                  std::max(kFirst, level_firsts[level])
+                };
+                const std::size_t kLevelEnd {
+                  std::min(kEnd, level_firsts[level] + level_counts[level])
+                };
+                if (kBegin >= kLevelEnd) {
+                  continue;
+                }
+                commands.Add(
+                    mesh_arena->GetMode(level_meshes[level]),
+                    mesh_arena->GetDrawCommand(
+                        level_meshes[level],
+                        static_cast<GLuint>(kLevelEnd - kBegin),
+                        static_cast<GLuint>(kBegin - kFirst)));
+              }
+            }
+          });
+    }
+
+    {
+      LAB8_PROFILE_SCOPE("Draw");
+      LAB8_PROFILE_GPU_SCOPE("Draw");
+
+      for (std::size_t batch { 0 }; batch < kBatchCount; batch++) {
+        const std::size_t kFirst { batch * kMaxInstancesPerDraw };
+        const std::size_t kEnd {
+          std::min(kFirst + kMaxInstancesPerDraw, kVisibleCount)
+        };
+
+        gl_state.UseProgram(shader_program);
+        gl_state.BindTexture(0, GL_TEXTURE_2D,
+                             texture_loader->GetTexture(kTexture));
+        uniform_ring->Bind(kInstanceTransformsBinding, sorted_transforms,
+                           kFirst * kMatrixSize,
+                           (kEnd - kFirst) * kMatrixSize);
+        mesh_arena->Draw(batch_commands[batch]);
+      }
+      uniform_ring->EndFrame();
+    }
+
+    if (readback) {
+      LAB8_PROFILE_SCOPE("Readback");
+      if (readback->IsFull()) {
+        write_frame();
+      }
+      readback->Queue(static_cast<std::uint64_t>(frame));
+    } else {
+      {
+        LAB8_PROFILE_SCOPE("SwapBuffers");
+        glfwSwapBuffers(window);
+      }
+      {
+        LAB8_PROFILE_SCOPE("PollEvents");
+        glfwPollEvents();
+      }
+    }
+
+    profiler.EndFrame();
+  }
+
+  simulation.Stop();
+
+  if (readback) {
+    while (readback->GetPendingCount() > 0) {
+      write_frame();
+    }
+    if (image_writer) {
+      image_writer->Wait();
+    }
+
+    const std::chrono::duration<double> kElapsed {
+      std::chrono::steady_clock::now() - kStart
+    };
+    const std::chrono::duration<double, std::milli> kStallTime {
+      readback->GetStallTime()
+    };
+
+    std::cout << "Offscreen: " << frame_limit << " frames, "
+              << frame_limit / kElapsed.count() << " frames/s, readback "
+              << "stall " << kStallTime.count() << " ms ("
+              << kStallTime.count() / frame_limit << " ms/frame)";
+    if (image_writer) {
+      std::cout << ", " << image_writer->GetThreadCount()
+                << " encoder threads, " << image_writer->GetFailureCount()
+                << " failed writes";
+    }
+    std::cout << std::endl;
+  }
+
+  if (frame_limit > 0) {
+    profiler.PrintStatistics(std::cout);
+    std::cout << "Shaders: program created in " << kShaderTime.count()
+              << " ms, binary cache "
+              << (shader_cache.IsEnabled()
+                      ? (shader_cache.GetHitCount() > 0 ? "hit" : "miss")
+                      : "disabled")
+              << std::endl;
+    std::cout << "GL state: " << gl_state.GetElidedCount() << " of "
+              << gl_state.GetRequestCount() << " binds elided, uniform "
+              << "ring " << (uniform_ring->IsPersistent() ? "persistent" :
+                                                             "mapped")
+              << ", " << uniform_ring->GetWaitCount() << " waits"
+              << std::endl;
+    std::cout << "LOD: " << kLod.GetLevelCount() << " levels ("
+              << kLod.GetSectorCount(0) << " to "
+              << kLod.GetSectorCount(kLod.GetLevelCount() - 1)
+              << " sectors), " << triangle_count / frame_limit
+              << " triangles per frame, "
+              << level_triangle_counts.front() * instance_count
+              << " at full detail" << std::endl;
+    std::cout << "Culling: " << visible_count / frame_limit << " of "
+              << instance_count << " instances visible per frame, "
+              << instance_bvh.GetNodeCount() << " BVH nodes, "
+              << bvh_build_count << " builds" << std::endl;
+    std::cout << "Jobs: " << jobs.GetThreadCount() << " threads, "
+              << jobs.GetJobCount() / frame_limit << " jobs per frame, "
+              << jobs.GetStealCount() << " steals" << std::endl;
+    std::cout << "Mesh arena: " << mesh_arena->GetDrawCallCount()
+              << " draw calls for " << mesh_arena->GetCommandCount()
+              << " commands, "
+              << (mesh_arena->IsIndirect() ? "multi-draw indirect" :
+                                             "direct draws")
+              << std::endl;
+  }
+  if (trace_path && !profiler.WriteChromeTrace(trace_path)) {
+    std::cerr << "Failed to write the trace" << std::endl;
   }
 
-  glDeleteVertexArrays(1, &vao);
-  glDeleteBuffers(1, &vbo);
-  glDeleteBuffers(1, &ebo);
+  profiler.DisableGpuTimers();
+  mesh_arena.reset();
+  uniform_ring.reset();
+  readback.reset();
   glDeleteProgram(shader_program);
+  texture_loader.reset();
 
   glfwTerminate();
+  offscreen_context.reset();
+
+  if (image_writer && image_writer->GetFailureCount() > 0) {
+    return -1;
+  }
 
   return 0;
 }
@@ -0,0 +1,106 @@
+// Подготавливает контейнер текстуры со всеми уровнями детализации:
+//   lab8_bake [--bc1 fast|normal|high] <изображение> [контейнер]
+// По умолчанию контейнер записывается рядом с изображением по пути
+// GetTextureContainerPath, где его ищут CreateTexture и TextureLoader.
+// После изменения изображения контейнер считается устаревшим, и они
+// загружают изображение, пока контейнер не подготовят заново.
+// С --bc1 уровни сжимаются в BC1 с заданным качеством.
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "texture_compressor.hpp"
+#include "texture_container.hpp"
+#include "texture_decoder.hpp"
+#include "utils.hpp"
+
+namespace {
+
+bool ParseQuality(const char* name, CompressionQuality& quality) {
+  if (std::strcmp(name, "fast") == 0) {
+    quality = CompressionQuality::kFast;
+  } else if (std::strcmp(name, "normal") == 0) {
+    quality = CompressionQuality::kNormal;
+  } else if (std::strcmp(name, "high") == 0) {
+    quality = CompressionQuality::kHigh;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  TextureContainerOptions options { };
+  int argument { 1 };
+
+  if (argc >= 3 && std::strcmp(argv[argument], "--bc1") == 0) {
+    if (!ParseQuality(argv[argument + 1], options.quality)) {
+      std::cerr << "Unknown quality: " << argv[argument + 1] << std::endl;
+      return -1;
+    }
+    options.format = TextureContainerFormat::kBc1;
+    argument += 2;
+  }
+
+  if (argc - argument < 1 || argc - argument > 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--bc1 fast|normal|high] <image> [container]" << std::endl;
+    return -1;
+  }
+
+  const std::string kImagePath { argv[argument] };
+  const std::string kContainerPath {
+    argc - argument == 2 ? argv[argument + 1]
+                         : GetTextureContainerPath(kImagePath)
+  };
+
+  // признаки снимаются до чтения, чтобы изменение изображения во время
+  // подготовки сделало контейнер устаревшим
+  TextureSourceStamp source { };
+  Image image { };
+  if (!GetTextureSourceStamp(kImagePath, source) ||
+      !LoadImage(kImagePath.c_str(), image)) {
+    return -1;
+  }
+
+  const std::vector<Image> kLevels { CreateMipChain(std::move(image)) };
+  if (!WriteTextureContainer(kContainerPath.c_str(), kLevels, source,
+                             options)) {
+    return -1;
+  }
+
+  std::cout << kImagePath << " -> " << kContainerPath << ": "
+            << kLevels.front().width << "x" << kLevels.front().height << ", "
+            << kLevels.front().channels << " channels, " << kLevels.size()
+            << " levels" << std::endl;
+
+  if (options.format == TextureContainerFormat::kBc1) {
+    MappedTextureContainer container { };
+    if (!container.Open(kContainerPath.c_str())) {
+      return -1;
+    }
+
+    const ImageView kSource {
+      kLevels.front().width, kLevels.front().height,
+      kLevels.front().channels, kLevels.front().pixels.data()
+    };
+    const Image kDecompressed {
+      DecompressBc1(container.GetLevel(0).pixels, kSource.width,
+                    kSource.height)
+    };
+    std::cout << "BC1 PSNR: "
+              << ComputePsnr(kSource, ImageView {
+                   kDecompressed.width, kDecompressed.height,
+                   kDecompressed.channels, kDecompressed.pixels.data()
+                 })
+              << " dB" << std::endl;
+  }
+
+  return 0;
+}